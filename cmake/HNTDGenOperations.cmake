@@ -0,0 +1,284 @@
+# Generate the hntestd operation dispatch from the OpenAPI spec.
+#
+# cmake -DSPEC_FILE=<spec.json> -DHANDLER_FILE=<HNTestDevicePrivate.h> -DOUTPUT_DIR=<dir> -P HNTDGenOperations.cmake
+#
+# Writes HNTDOperations.h and HNTDOperations.cpp to OUTPUT_DIR:
+#
+#   - an HNTD_OP_<NAME> id per operationId and HNTD_OPERATION_COUNT
+#   - g_HNTDOperations, binding each operationId to
+#     HNTestDevice::handle<OperationId>
+#   - hntdFindOperation(), the operationId lookup used by dispatchEP
+#   - for operations with parameters, an HNTD_<NAME>_PARAMS_T struct and
+#     an hntdExtract<OperationId>Params() that fills it from the path
+#     and query, returning false for a request that does not match the
+#     spec
+#   - g_HNode2TestRest, the spec itself
+#
+# Generation fails if an operation has no handler declared in
+# HANDLER_FILE.  Path parameters come from the path template, query
+# parameters from the parameters list; integer parameters are unsigned
+# 64 bit.  "x-hntd-faultable": false exempts an operation from fault
+# injection.
+#
+# The spec is read a line at a time and is expected in the layout of
+# HNTestRest.json, one key per line.
+
+if( NOT SPEC_FILE OR NOT HANDLER_FILE OR NOT OUTPUT_DIR )
+    message( FATAL_ERROR "SPEC_FILE, HANDLER_FILE and OUTPUT_DIR are required" )
+endif()
+
+file( READ ${SPEC_FILE} SPEC_TEXT )
+file( READ ${HANDLER_FILE} HANDLER_TEXT )
+
+if( SPEC_TEXT MATCHES ";" )
+    message( FATAL_ERROR "${SPEC_FILE}: ';' is not supported in the spec" )
+endif()
+
+if( SPEC_TEXT MATCHES "\\)HNTDSPEC\"" )
+    message( FATAL_ERROR "${SPEC_FILE}: the spec contains the raw string delimiter" )
+endif()
+
+# Brackets would group list elements, they are not needed to parse
+string( REPLACE "[" "<" SPEC_LINES "${SPEC_TEXT}" )
+string( REPLACE "]" ">" SPEC_LINES "${SPEC_LINES}" )
+string( REPLACE "\n" ";" SPEC_LINES "${SPEC_LINES}" )
+
+set( OPS "" )
+set( CUR_OP "" )
+set( CUR_PATH "" )
+set( IN_PARAMS FALSE )
+set( PARAM_NAME "" )
+
+# Add the parameter being read to the current operation
+macro( hntd_end_param )
+    if( PARAM_NAME )
+        if( PARAM_IN STREQUAL "query" )
+            list( APPEND OP_${CUR_OP}_QUERY ${PARAM_NAME} )
+            set( PARAM_${CUR_OP}_${PARAM_NAME}_TYPE ${PARAM_TYPE} )
+            set( PARAM_${CUR_OP}_${PARAM_NAME}_REQUIRED ${PARAM_REQUIRED} )
+        elseif( NOT PARAM_IN STREQUAL "path" )
+            message( FATAL_ERROR "${SPEC_FILE}: ${CUR_OP} parameter ${PARAM_NAME} is in '${PARAM_IN}', only path and query are supported" )
+        endif()
+    endif()
+
+    set( PARAM_NAME "" )
+endmacro()
+
+foreach( LINE ${SPEC_LINES} )
+    if( LINE MATCHES "^ *\"(/[^\"]*)\": *{" )
+        set( CUR_PATH ${CMAKE_MATCH_1} )
+    elseif( LINE MATCHES "\"operationId\": *\"([A-Za-z0-9_]+)\"" )
+        set( CUR_OP ${CMAKE_MATCH_1} )
+
+        list( FIND OPS ${CUR_OP} DUP )
+        if( NOT DUP EQUAL -1 )
+            message( FATAL_ERROR "${SPEC_FILE}: operationId ${CUR_OP} is used twice" )
+        endif()
+
+        list( APPEND OPS ${CUR_OP} )
+        set( OP_${CUR_OP}_PATH ${CUR_PATH} )
+        set( OP_${CUR_OP}_FAULTABLE true )
+        set( OP_${CUR_OP}_QUERY "" )
+
+        string( REGEX MATCHALL "{[A-Za-z0-9_]+}" PATH_PARAMS "${CUR_PATH}" )
+        string( REGEX REPLACE "[{}]" "" PATH_PARAMS "${PATH_PARAMS}" )
+        set( OP_${CUR_OP}_PATHPARAMS "${PATH_PARAMS}" )
+    elseif( LINE MATCHES "\"x-hntd-faultable\": *false" )
+        set( OP_${CUR_OP}_FAULTABLE false )
+    elseif( LINE MATCHES "\"parameters\": *<" )
+        set( IN_PARAMS TRUE )
+    elseif( IN_PARAMS AND LINE MATCHES "^ *>" )
+        hntd_end_param()
+        set( IN_PARAMS FALSE )
+    elseif( IN_PARAMS AND LINE MATCHES "\"name\": *\"([A-Za-z0-9_]+)\"" )
+        hntd_end_param()
+        set( PARAM_NAME ${CMAKE_MATCH_1} )
+        set( PARAM_IN "query" )
+        set( PARAM_TYPE "string" )
+        set( PARAM_REQUIRED false )
+    elseif( IN_PARAMS AND LINE MATCHES "\"in\": *\"([a-z]+)\"" )
+        set( PARAM_IN ${CMAKE_MATCH_1} )
+    elseif( IN_PARAMS AND LINE MATCHES "\"required\": *(true|false)" )
+        set( PARAM_REQUIRED ${CMAKE_MATCH_1} )
+    elseif( IN_PARAMS AND LINE MATCHES "\"type\": *\"([a-z]+)\"" )
+        set( PARAM_TYPE ${CMAKE_MATCH_1} )
+    endif()
+endforeach()
+
+if( NOT OPS )
+    message( FATAL_ERROR "${SPEC_FILE}: no operations found" )
+endif()
+
+# getWidgetInfo -> GetWidgetInfo
+macro( hntd_upper_first OUT NAME )
+    string( SUBSTRING ${NAME} 0 1 FIRST )
+    string( SUBSTRING ${NAME} 1 -1 REST )
+    string( TOUPPER ${FIRST} FIRST )
+    set( ${OUT} "${FIRST}${REST}" )
+endmacro()
+
+# getWidgetInfo -> GET_WIDGET_INFO
+macro( hntd_upper_snake OUT NAME )
+    string( REGEX REPLACE "([a-z0-9])([A-Z])" "\\1_\\2" ${OUT} ${NAME} )
+    string( TOUPPER ${${OUT}} ${OUT} )
+endmacro()
+
+set( GEN_NOTE "// Generated from HNTestRest.json by cmake/HNTDGenOperations.cmake, do not edit" )
+
+#
+# HNTDOperations.h
+#
+set( H "${GEN_NOTE}\n\n#ifndef __HNTD_OPERATIONS_H__\n#define __HNTD_OPERATIONS_H__\n\n" )
+set( H "${H}#include <stdint.h>\n#include <sys/types.h>\n\n#include <string>\n\n#include <hnode2/HNodeDevice.h>\n\n" )
+set( H "${H}class HNTestDevice;\n\n" )
+set( H "${H}typedef void (HNTestDevice::*HNTD_OP_HANDLER_T)( HNOperationData *opData );\n\n" )
+
+set( H "${H}typedef enum HNTDOperationIDEnum\n{\n" )
+foreach( OP ${OPS} )
+    hntd_upper_snake( OP_UPPER ${OP} )
+    set( H "${H}    HNTD_OP_${OP_UPPER},\n" )
+endforeach()
+set( H "${H}    HNTD_OPERATION_COUNT\n}HNTD_OPERATION_ID_T;\n\n" )
+
+set( H "${H}typedef struct HNTDOperationStruct\n{\n" )
+set( H "${H}    const char        *opID;\n    HNTD_OP_HANDLER_T  handler;\n\n" )
+set( H "${H}    // False for operations exempt from fault injection\n    bool               faultable;\n" )
+set( H "${H}}HNTD_OPERATION_T;\n\n" )
+set( H "${H}// Indexed by HNTD_OPERATION_ID_T\nextern const HNTD_OPERATION_T g_HNTDOperations[ HNTD_OPERATION_COUNT ];\n\n" )
+set( H "${H}// The id of an operationId, -1 if the spec has no such operation\nint hntdFindOperation( const std::string &opID );\n\n" )
+set( H "${H}extern const std::string g_HNode2TestRest;\n" )
+
+#
+# HNTDOperations.cpp
+#
+set( C "${GEN_NOTE}\n\n#include <Poco/URI.h>\n#include <Poco/NumberParser.h>\n#include <Poco/Exception.h>\n#include <Poco/Net/HTTPServerRequest.h>\n\n" )
+set( C "${C}#include \"HNTestDevicePrivate.h\"\n\n" )
+
+set( C "${C}const HNTD_OPERATION_T g_HNTDOperations[ HNTD_OPERATION_COUNT ] =\n{\n" )
+foreach( OP ${OPS} )
+    hntd_upper_first( OP_CAMEL ${OP} )
+
+    if( NOT HANDLER_TEXT MATCHES "void handle${OP_CAMEL}\\( HNOperationData \\*opData \\)" )
+        message( FATAL_ERROR "operationId ${OP} (${OP_${OP}_PATH}) has no handler, declare HNTestDevice::handle${OP_CAMEL}( HNOperationData *opData ) in ${HANDLER_FILE}" )
+    endif()
+
+    set( C "${C}    { \"${OP}\", &HNTestDevice::handle${OP_CAMEL}, ${OP_${OP}_FAULTABLE} },\n" )
+endforeach()
+set( C "${C}};\n\n" )
+
+# Compare only the operationIds of the request's length
+set( LENGTHS "" )
+foreach( OP ${OPS} )
+    # Zero padded so the sort is numeric
+    string( LENGTH ${OP} LEN )
+    string( LENGTH ${LEN} DIGITS )
+    if( DIGITS EQUAL 1 )
+        set( LEN "0${LEN}" )
+    endif()
+    list( APPEND LENGTHS ${LEN} )
+endforeach()
+list( REMOVE_DUPLICATES LENGTHS )
+list( SORT LENGTHS )
+
+set( C "${C}int\nhntdFindOperation( const std::string &opID )\n{\n    switch( opID.size() )\n    {\n" )
+foreach( LEN ${LENGTHS} )
+    math( EXPR LEN "${LEN}" )
+    set( C "${C}        case ${LEN}:\n" )
+    foreach( OP ${OPS} )
+        string( LENGTH ${OP} OP_LEN )
+        if( OP_LEN EQUAL LEN )
+            hntd_upper_snake( OP_UPPER ${OP} )
+            set( C "${C}            if( opID == \"${OP}\" )\n                return HNTD_OP_${OP_UPPER};\n" )
+        endif()
+    endforeach()
+    set( C "${C}        break;\n" )
+endforeach()
+set( C "${C}    }\n\n    return -1;\n}\n" )
+
+# Parameter structs and extractors
+foreach( OP ${OPS} )
+    if( OP_${OP}_PATHPARAMS OR OP_${OP}_QUERY )
+        hntd_upper_first( OP_CAMEL ${OP} )
+        hntd_upper_snake( OP_UPPER ${OP} )
+
+        set( H "${H}\n// ${OP} ${OP_${OP}_PATH}\ntypedef struct HNTD${OP_CAMEL}ParamsStruct\n{\n" )
+        set( C "${C}\nbool\nhntdExtract${OP_CAMEL}Params( HNOperationData *opData, HNTD_${OP_UPPER}_PARAMS_T &params )\n{\n" )
+
+        foreach( PARAM ${OP_${OP}_PATHPARAMS} )
+            set( H "${H}    std::string ${PARAM};\n" )
+            set( C "${C}    if( opData->getParam( \"${PARAM}\", params.${PARAM} ) == true )\n        return false;\n\n" )
+        endforeach()
+
+        if( OP_${OP}_QUERY )
+            foreach( PARAM ${OP_${OP}_QUERY} )
+                hntd_upper_first( PARAM_CAMEL ${PARAM} )
+                set( TYPE ${PARAM_${OP}_${PARAM}_TYPE} )
+
+                if( TYPE STREQUAL "integer" )
+                    set( H "${H}    bool        has${PARAM_CAMEL};\n    uint64_t    ${PARAM};\n" )
+                    set( C "${C}    params.has${PARAM_CAMEL} = false;\n    params.${PARAM} = 0;\n" )
+                elseif( TYPE STREQUAL "boolean" )
+                    set( H "${H}    bool        has${PARAM_CAMEL};\n    bool        ${PARAM};\n" )
+                    set( C "${C}    params.has${PARAM_CAMEL} = false;\n    params.${PARAM} = false;\n" )
+                elseif( TYPE STREQUAL "string" )
+                    set( H "${H}    bool        has${PARAM_CAMEL};\n    std::string ${PARAM};\n" )
+                    set( C "${C}    params.has${PARAM_CAMEL} = false;\n" )
+                else()
+                    message( FATAL_ERROR "${SPEC_FILE}: ${OP} parameter ${PARAM} has unsupported type '${TYPE}'" )
+                endif()
+            endforeach()
+
+            set( C "${C}\n    Poco::URI::QueryParameters query;\n\n    try\n    {\n" )
+            set( C "${C}        query = Poco::URI( opData->getRequest().getURI() ).getQueryParameters();\n" )
+            set( C "${C}    }\n    catch( Poco::Exception ex )\n    {\n        return false;\n    }\n\n" )
+            set( C "${C}    for( Poco::URI::QueryParameters::iterator it = query.begin(); it != query.end(); it++ )\n    {\n" )
+
+            set( ELSE "" )
+            foreach( PARAM ${OP_${OP}_QUERY} )
+                hntd_upper_first( PARAM_CAMEL ${PARAM} )
+                set( TYPE ${PARAM_${OP}_${PARAM}_TYPE} )
+
+                set( C "${C}        ${ELSE}if( \"${PARAM}\" == it->first )\n        {\n" )
+                if( TYPE STREQUAL "integer" )
+                    set( C "${C}            Poco::UInt64 value;\n            if( Poco::NumberParser::tryParseUnsigned64( it->second, value ) == false )\n                return false;\n            params.${PARAM} = value;\n" )
+                elseif( TYPE STREQUAL "boolean" )
+                    set( C "${C}            if( Poco::NumberParser::tryParseBool( it->second, params.${PARAM} ) == false )\n                return false;\n" )
+                else()
+                    set( C "${C}            params.${PARAM} = it->second;\n" )
+                endif()
+                set( C "${C}            params.has${PARAM_CAMEL} = true;\n        }\n" )
+                set( ELSE "else " )
+            endforeach()
+            set( C "${C}    }\n" )
+
+            foreach( PARAM ${OP_${OP}_QUERY} )
+                if( PARAM_${OP}_${PARAM}_REQUIRED STREQUAL "true" )
+                    hntd_upper_first( PARAM_CAMEL ${PARAM} )
+                    set( C "${C}\n    if( params.has${PARAM_CAMEL} == false )\n        return false;\n" )
+                endif()
+            endforeach()
+            set( C "${C}\n" )
+        endif()
+
+        set( C "${C}    return true;\n}\n" )
+
+        set( H "${H}}HNTD_${OP_UPPER}_PARAMS_T;\n\n" )
+        set( H "${H}// False if a parameter is missing or malformed\nbool hntdExtract${OP_CAMEL}Params( HNOperationData *opData, HNTD_${OP_UPPER}_PARAMS_T &params );\n" )
+    endif()
+endforeach()
+
+set( H "${H}\n#endif // __HNTD_OPERATIONS_H__\n" )
+
+set( C "${C}\nconst std::string g_HNode2TestRest = R\"HNTDSPEC(\n${SPEC_TEXT})HNTDSPEC\";\n" )
+
+# Only touch the outputs that changed, so dependents are not rebuilt
+foreach( OUT HNTDOperations.h HNTDOperations.cpp )
+    if( OUT STREQUAL "HNTDOperations.h" )
+        file( WRITE ${OUTPUT_DIR}/${OUT}.tmp "${H}" )
+    else()
+        file( WRITE ${OUTPUT_DIR}/${OUT}.tmp "${C}" )
+    endif()
+
+    execute_process( COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT_DIR}/${OUT}.tmp ${OUTPUT_DIR}/${OUT} )
+    file( REMOVE ${OUTPUT_DIR}/${OUT}.tmp )
+endforeach()
@@ -0,0 +1,503 @@
+#include <unistd.h>
+#include <time.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <random>
+
+#include "Poco/Util/Option.h"
+#include "Poco/Util/OptionSet.h"
+#include "Poco/Util/HelpFormatter.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/NumberParser.h"
+#include <Poco/JSON/Object.h>
+
+#include "HNTestBenchPrivate.h"
+
+using namespace Poco::Util;
+
+namespace pjs = Poco::JSON;
+namespace pnt = Poco::Net;
+
+// Indexed by HNTB_OP_T, named by the device operationIds
+static const char *g_HNTBOpNames[ HNTB_OP_COUNT ] =
+{
+    "getStatus",
+    "getWidgetList",
+    "getWidgetInfo",
+    "createWidget",
+    "updateWidget",
+    "deleteWidget",
+    "putTestHealth"
+};
+
+static const char *g_HNTBDefaultMix = "getStatus=30,getWidgetList=5,getWidgetInfo=30,createWidget=10,updateWidget=15,deleteWidget=5,putTestHealth=5";
+
+static const char *g_HNTBHealthStates[] = { "OK", "FAILED", "UNKNOWN", "NOTE" };
+
+static uint64_t
+hntbNowNS()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+HNTestBenchWorker::HNTestBenchWorker()
+{
+    for( uint i = 0; i < HNTB_OP_COUNT; i++ )
+    {
+        errors[i]   = 0;
+        bytesOut[i] = 0;
+        bytesIn[i]  = 0;
+    }
+}
+
+HNTestBench::HNTestBench()
+: m_recording( false ), m_stop( false )
+{
+    m_host        = "127.0.0.1";
+    m_port        = 8088;
+    m_concurrency = 8;
+    m_durationSec = 10;
+    m_warmupSec   = 1;
+    m_seedCount   = 100;
+    m_payloadSize = 0;
+    m_totalWeight = 0;
+}
+
+void
+HNTestBench::defineOptions( OptionSet& options )
+{
+    Application::defineOptions( options );
+
+    options.addOption(
+              Option("help", "h", "display help").required(false).repeatable(false));
+
+    options.addOption(
+              Option("host", "", "Address of the test device (default 127.0.0.1).").required(false).repeatable(false).argument("host"));
+
+    options.addOption(
+              Option("port", "p", "REST port of the test device (default 8088).").required(false).repeatable(false).argument("port"));
+
+    options.addOption(
+              Option("concurrency", "c", "Number of concurrent connections (default 8).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("duration", "t", "Measured run time in seconds (default 10).").required(false).repeatable(false).argument("seconds"));
+
+    options.addOption(
+              Option("warmup", "w", "Unmeasured warmup time in seconds (default 1).").required(false).repeatable(false).argument("seconds"));
+
+    options.addOption(
+              Option("seed", "", "Widgets each connection creates before the run (default 100).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("payload-size", "s", "Pad widget create/update bodies to this many bytes.").required(false).repeatable(false).argument("bytes"));
+
+    options.addOption(
+              Option("mix", "m", "Request mix as operationId=weight,... (default all operations).").required(false).repeatable(false).argument("mix"));
+
+    options.addOption(
+              Option("json", "j", "Write the results as JSON to this file.").required(false).repeatable(false).argument("path"));
+}
+
+void
+HNTestBench::handleOption( const std::string& name, const std::string& value )
+{
+    Application::handleOption( name, value );
+
+    if( "help" == name )
+        _helpRequested = true;
+    else if( "host" == name )
+        m_host = value;
+    else if( "port" == name )
+        m_port = Poco::NumberParser::parseUnsigned( value );
+    else if( "concurrency" == name )
+        m_concurrency = Poco::NumberParser::parseUnsigned( value );
+    else if( "duration" == name )
+        m_durationSec = Poco::NumberParser::parseUnsigned( value );
+    else if( "warmup" == name )
+        m_warmupSec = Poco::NumberParser::parseUnsigned( value );
+    else if( "seed" == name )
+        m_seedCount = Poco::NumberParser::parseUnsigned( value );
+    else if( "payload-size" == name )
+        m_payloadSize = Poco::NumberParser::parseUnsigned( value );
+    else if( "mix" == name )
+        m_mix = value;
+    else if( "json" == name )
+        m_jsonPath = value;
+}
+
+void
+HNTestBench::displayHelp()
+{
+    HelpFormatter helpFormatter(options());
+    helpFormatter.setCommand(commandName());
+    helpFormatter.setUsage("[options]");
+    helpFormatter.setHeader("HNode2 Test Device REST load generator.");
+    helpFormatter.format(std::cout);
+}
+
+bool
+HNTestBench::parseMix( const std::string &mix )
+{
+    uint weights[ HNTB_OP_COUNT ] = { 0 };
+
+    Poco::StringTokenizer entries( mix, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM );
+
+    for( Poco::StringTokenizer::Iterator it = entries.begin(); it != entries.end(); it++ )
+    {
+        std::string::size_type sep = it->find( '=' );
+        std::string name = it->substr( 0, sep );
+        uint weight = 1;
+
+        if( ( sep != std::string::npos ) && ( Poco::NumberParser::tryParseUnsigned( it->substr( sep + 1 ), weight ) == false ) )
+        {
+            std::cerr << "ERROR: Bad weight in mix entry: " << *it << std::endl;
+            return false;
+        }
+
+        uint op;
+        for( op = 0; op < HNTB_OP_COUNT; op++ )
+        {
+            if( name == g_HNTBOpNames[ op ] )
+                break;
+        }
+
+        if( op == HNTB_OP_COUNT )
+        {
+            std::cerr << "ERROR: Unknown operation in mix: " << name << std::endl;
+            return false;
+        }
+
+        weights[ op ] = weight;
+    }
+
+    m_totalWeight = 0;
+    for( uint op = 0; op < HNTB_OP_COUNT; op++ )
+    {
+        m_totalWeight += weights[ op ];
+        m_opWeight[ op ] = m_totalWeight;
+    }
+
+    return ( m_totalWeight != 0 );
+}
+
+HNTB_OP_T
+HNTestBench::pickOp( uint rnd )
+{
+    uint point = rnd % m_totalWeight;
+
+    for( uint op = 0; op < HNTB_OP_COUNT; op++ )
+    {
+        if( point < m_opWeight[ op ] )
+            return (HNTB_OP_T) op;
+    }
+
+    return HNTB_OP_GET_STATUS;
+}
+
+bool
+HNTestBench::issueRequest( pnt::HTTPClientSession &session, HNTestBenchWorker *worker, HNTB_OP_T op, uint rnd, uint64_t &bytesOut, uint64_t &bytesIn )
+{
+    std::string method = pnt::HTTPRequest::HTTP_GET;
+    std::string path;
+    std::string body;
+    uint widgetIndex = 0;
+
+    bytesOut = 0;
+    bytesIn  = 0;
+
+    // Operations on a specific widget need one to exist
+    if( ( ( op == HNTB_OP_GET_WIDGET_INFO ) || ( op == HNTB_OP_UPDATE_WIDGET ) || ( op == HNTB_OP_DELETE_WIDGET ) ) && worker->widgetIDs.empty() )
+        op = HNTB_OP_CREATE_WIDGET;
+
+    if( worker->widgetIDs.empty() == false )
+        widgetIndex = rnd % worker->widgetIDs.size();
+
+    switch( op )
+    {
+        case HNTB_OP_GET_STATUS:
+            path = "/hnode2/test/status";
+        break;
+
+        case HNTB_OP_GET_WIDGET_LIST:
+            path = "/hnode2/test/widgets";
+        break;
+
+        case HNTB_OP_GET_WIDGET_INFO:
+            path = "/hnode2/test/widgets/" + worker->widgetIDs[ widgetIndex ];
+        break;
+
+        case HNTB_OP_CREATE_WIDGET:
+            method = pnt::HTTPRequest::HTTP_POST;
+            path = "/hnode2/test/widgets";
+            body = "{\"color\":\"red\",\"name\":\"" + m_payloadPad + "\"}";
+        break;
+
+        case HNTB_OP_UPDATE_WIDGET:
+            method = pnt::HTTPRequest::HTTP_PUT;
+            path = "/hnode2/test/widgets/" + worker->widgetIDs[ widgetIndex ];
+            body = "{\"color\":\"blue\",\"name\":\"" + m_payloadPad + "\"}";
+        break;
+
+        case HNTB_OP_DELETE_WIDGET:
+            method = pnt::HTTPRequest::HTTP_DELETE;
+            path = "/hnode2/test/widgets/" + worker->widgetIDs[ widgetIndex ];
+        break;
+
+        case HNTB_OP_PUT_TEST_HEALTH:
+            method = pnt::HTTPRequest::HTTP_PUT;
+            path = "/hnode2/test/health";
+            body = std::string( "{\"status\":\"" ) + g_HNTBHealthStates[ rnd % 4 ] + "\",\"errCode\":500}";
+        break;
+
+        default:
+        break;
+    }
+
+    try
+    {
+        pnt::HTTPRequest request( method, path, pnt::HTTPMessage::HTTP_1_1 );
+        request.setKeepAlive( true );
+
+        if( body.empty() == false )
+        {
+            request.setContentType( "application/json" );
+            request.setContentLength( body.size() );
+        }
+
+        std::ostream &os = session.sendRequest( request );
+        os << body;
+        bytesOut = body.size();
+
+        pnt::HTTPResponse response;
+        std::istream &is = session.receiveResponse( response );
+
+        // Consume the whole body so the connection can be reused
+        char buf[ 16384 ];
+        while( is )
+        {
+            is.read( buf, sizeof( buf ) );
+            bytesIn += is.gcount();
+        }
+
+        if( response.getStatus() >= pnt::HTTPResponse::HTTP_BAD_REQUEST )
+            return false;
+
+        if( op == HNTB_OP_CREATE_WIDGET )
+        {
+            // The new widget id is the last segment of the location
+            std::string location = response.get( "Location", "" );
+            std::string::size_type slash = location.rfind( '/' );
+
+            if( location.empty() == false )
+                worker->widgetIDs.push_back( ( slash == std::string::npos ) ? location : location.substr( slash + 1 ) );
+        }
+        else if( op == HNTB_OP_DELETE_WIDGET )
+        {
+            worker->widgetIDs[ widgetIndex ] = worker->widgetIDs.back();
+            worker->widgetIDs.pop_back();
+        }
+    }
+    catch( Poco::Exception &ex )
+    {
+        session.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void
+HNTestBench::runWorker( HNTestBenchWorker *worker, uint seed )
+{
+    std::minstd_rand rng( seed );
+    uint64_t bytesOut;
+    uint64_t bytesIn;
+
+    pnt::HTTPClientSession session( m_host, m_port );
+    session.setKeepAlive( true );
+    session.setTimeout( Poco::Timespan( 10, 0 ) );
+
+    // Give each connection its own widgets to work against
+    for( uint i = 0; ( i < m_seedCount ) && ( m_stop == false ); i++ )
+        issueRequest( session, worker, HNTB_OP_CREATE_WIDGET, rng(), bytesOut, bytesIn );
+
+    while( m_stop == false )
+    {
+        HNTB_OP_T op = pickOp( rng() );
+
+        uint64_t start  = hntbNowNS();
+        bool     result = issueRequest( session, worker, op, rng(), bytesOut, bytesIn );
+        uint64_t end    = hntbNowNS();
+
+        if( m_recording == false )
+            continue;
+
+        worker->latency[ op ].record( end - start );
+        worker->bytesOut[ op ] += bytesOut;
+        worker->bytesIn[ op ]  += bytesIn;
+
+        if( result == false )
+            worker->errors[ op ] += 1;
+    }
+}
+
+void
+HNTestBench::report( std::vector< HNTestBenchWorker* > &workers, double elapsedSec )
+{
+    HNTDHistogram *total = new HNTDHistogram;
+    uint64_t totalErrors = 0;
+
+    pjs::Object jsRoot;
+    pjs::Object jsConfig;
+    pjs::Object jsOps;
+
+    jsConfig.set( "host", m_host );
+    jsConfig.set( "port", m_port );
+    jsConfig.set( "concurrency", m_concurrency );
+    jsConfig.set( "durationSec", m_durationSec );
+    jsConfig.set( "payloadSize", m_payloadSize );
+    jsConfig.set( "mix", m_mix );
+
+    printf( "%-14s %10s %8s %10s %10s %10s %10s %10s %10s\n", "operation", "requests", "errors", "req/s", "mean(us)", "p50(us)", "p99(us)", "p99.9(us)", "max(us)" );
+
+    for( uint op = 0; op < HNTB_OP_COUNT; op++ )
+    {
+        HNTDHistogram *hist = new HNTDHistogram;
+        uint64_t errors   = 0;
+        uint64_t bytesOut = 0;
+        uint64_t bytesIn  = 0;
+
+        for( std::vector< HNTestBenchWorker* >::iterator it = workers.begin(); it != workers.end(); it++ )
+        {
+            hist->merge( (*it)->latency[ op ] );
+            errors   += (*it)->errors[ op ];
+            bytesOut += (*it)->bytesOut[ op ];
+            bytesIn  += (*it)->bytesIn[ op ];
+        }
+
+        total->merge( *hist );
+        totalErrors += errors;
+
+        if( hist->getCount() != 0 )
+        {
+            printf( "%-14s %10lu %8lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", g_HNTBOpNames[ op ],
+                    (unsigned long) hist->getCount(), (unsigned long) errors, hist->getCount() / elapsedSec,
+                    hist->getMean() / 1000.0, hist->getPercentile( 50 ) / 1000.0, hist->getPercentile( 99 ) / 1000.0,
+                    hist->getPercentile( 99.9 ) / 1000.0, hist->getMax() / 1000.0 );
+
+            pjs::Object jsOp;
+            jsOp.set( "requests", hist->getCount() );
+            jsOp.set( "errors", errors );
+            jsOp.set( "throughput", hist->getCount() / elapsedSec );
+            jsOp.set( "bytesOut", bytesOut );
+            jsOp.set( "bytesIn", bytesIn );
+            jsOp.set( "meanUs", hist->getMean() / 1000.0 );
+            jsOp.set( "p50Us", hist->getPercentile( 50 ) / 1000.0 );
+            jsOp.set( "p99Us", hist->getPercentile( 99 ) / 1000.0 );
+            jsOp.set( "p999Us", hist->getPercentile( 99.9 ) / 1000.0 );
+            jsOp.set( "maxUs", hist->getMax() / 1000.0 );
+            jsOps.set( g_HNTBOpNames[ op ], jsOp );
+        }
+
+        delete hist;
+    }
+
+    printf( "%-14s %10lu %8lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", "total",
+            (unsigned long) total->getCount(), (unsigned long) totalErrors, total->getCount() / elapsedSec,
+            total->getMean() / 1000.0, total->getPercentile( 50 ) / 1000.0, total->getPercentile( 99 ) / 1000.0,
+            total->getPercentile( 99.9 ) / 1000.0, total->getMax() / 1000.0 );
+
+    if( m_jsonPath.empty() == false )
+    {
+        pjs::Object jsTotal;
+        jsTotal.set( "requests", total->getCount() );
+        jsTotal.set( "errors", totalErrors );
+        jsTotal.set( "throughput", total->getCount() / elapsedSec );
+        jsTotal.set( "meanUs", total->getMean() / 1000.0 );
+        jsTotal.set( "p50Us", total->getPercentile( 50 ) / 1000.0 );
+        jsTotal.set( "p99Us", total->getPercentile( 99 ) / 1000.0 );
+        jsTotal.set( "p999Us", total->getPercentile( 99.9 ) / 1000.0 );
+        jsTotal.set( "maxUs", total->getMax() / 1000.0 );
+
+        jsRoot.set( "config", jsConfig );
+        jsRoot.set( "elapsedSec", elapsedSec );
+        jsRoot.set( "operations", jsOps );
+        jsRoot.set( "total", jsTotal );
+
+        std::ofstream ofs( m_jsonPath );
+        pjs::Stringifier::stringify( jsRoot, ofs, 1 );
+        ofs << std::endl;
+
+        if( ofs.fail() )
+            std::cerr << "ERROR: Could not write results to " << m_jsonPath << std::endl;
+    }
+
+    delete total;
+}
+
+int
+HNTestBench::main( const std::vector<std::string>& args )
+{
+    if( _helpRequested == true )
+    {
+        displayHelp();
+        return Application::EXIT_OK;
+    }
+
+    if( m_mix.empty() )
+        m_mix = g_HNTBDefaultMix;
+
+    if( ( parseMix( m_mix ) == false ) || ( m_concurrency == 0 ) || ( m_durationSec == 0 ) )
+    {
+        displayHelp();
+        return Application::EXIT_USAGE;
+    }
+
+    // Filler for the widget name so create/update bodies hit the payload size
+    uint overhead = std::string( "{\"color\":\"blue\",\"name\":\"\"}" ).size();
+    m_payloadPad.assign( ( m_payloadSize > overhead ) ? ( m_payloadSize - overhead ) : 0, 'x' );
+
+    std::cout << "Driving " << m_host << ":" << m_port << " with " << m_concurrency << " connections for "
+              << m_durationSec << "s (+" << m_warmupSec << "s warmup), mix: " << m_mix << std::endl;
+
+    std::vector< HNTestBenchWorker* > workers;
+    std::vector< std::thread > threads;
+
+    for( uint i = 0; i < m_concurrency; i++ )
+    {
+        workers.push_back( new HNTestBenchWorker );
+        threads.push_back( std::thread( &HNTestBench::runWorker, this, workers.back(), i + 1 ) );
+    }
+
+    sleep( m_warmupSec );
+
+    m_recording = true;
+    uint64_t start = hntbNowNS();
+
+    sleep( m_durationSec );
+
+    m_recording = false;
+    uint64_t end = hntbNowNS();
+
+    m_stop = true;
+    for( std::vector< std::thread >::iterator it = threads.begin(); it != threads.end(); it++ )
+        it->join();
+
+    report( workers, (double)( end - start ) / 1e9 );
+
+    for( std::vector< HNTestBenchWorker* >::iterator it = workers.begin(); it != workers.end(); it++ )
+        delete *it;
+
+    return Application::EXIT_OK;
+}
@@ -0,0 +1,88 @@
+#ifndef __HN_TEST_BENCH_PRIVATE_H__
+#define __HN_TEST_BENCH_PRIVATE_H__
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "Poco/Util/Application.h"
+#include "Poco/Util/OptionSet.h"
+#include "Poco/Net/HTTPClientSession.h"
+
+#include "HNTDHistogram.h"
+
+typedef enum HNTestBenchOpEnum
+{
+  HNTB_OP_GET_STATUS,
+  HNTB_OP_GET_WIDGET_LIST,
+  HNTB_OP_GET_WIDGET_INFO,
+  HNTB_OP_CREATE_WIDGET,
+  HNTB_OP_UPDATE_WIDGET,
+  HNTB_OP_DELETE_WIDGET,
+  HNTB_OP_PUT_TEST_HEALTH,
+  HNTB_OP_COUNT
+}HNTB_OP_T;
+
+// Results collected by one load generating thread
+class HNTestBenchWorker
+{
+    public:
+        HNTDHistogram latency[ HNTB_OP_COUNT ];
+
+        uint64_t errors[ HNTB_OP_COUNT ];
+        uint64_t bytesOut[ HNTB_OP_COUNT ];
+        uint64_t bytesIn[ HNTB_OP_COUNT ];
+
+        // Widget ids owned by this worker
+        std::vector< std::string > widgetIDs;
+
+        HNTestBenchWorker();
+};
+
+class HNTestBench : public Poco::Util::Application
+{
+    private:
+        bool _helpRequested = false;
+
+        std::string m_host;
+        uint        m_port;
+        uint        m_concurrency;
+        uint        m_durationSec;
+        uint        m_warmupSec;
+        uint        m_seedCount;
+        uint        m_payloadSize;
+        std::string m_jsonPath;
+        std::string m_mix;
+
+        // Cumulative weights for picking an operation
+        uint m_opWeight[ HNTB_OP_COUNT ];
+        uint m_totalWeight;
+
+        std::string m_payloadPad;
+
+        std::atomic< bool > m_recording;
+        std::atomic< bool > m_stop;
+
+        void displayHelp();
+
+        bool parseMix( const std::string &mix );
+
+        HNTB_OP_T pickOp( uint rnd );
+
+        void runWorker( HNTestBenchWorker *worker, uint seed );
+
+        bool issueRequest( Poco::Net::HTTPClientSession &session, HNTestBenchWorker *worker, HNTB_OP_T op, uint rnd, uint64_t &bytesOut, uint64_t &bytesIn );
+
+        void report( std::vector< HNTestBenchWorker* > &workers, double elapsedSec );
+
+    protected:
+        // Poco funcions
+        void defineOptions( Poco::Util::OptionSet& options );
+        void handleOption( const std::string& name, const std::string& value );
+        int main( const std::vector<std::string>& args );
+
+    public:
+        HNTestBench();
+};
+
+#endif // __HN_TEST_BENCH_PRIVATE_H__
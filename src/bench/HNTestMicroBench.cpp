@@ -0,0 +1,945 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <poll.h>
+
+#include <iostream>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include "Poco/Util/Option.h"
+#include "Poco/Util/OptionSet.h"
+#include "Poco/Util/HelpFormatter.h"
+#include "Poco/NumberParser.h"
+#include <Poco/JSON/Object.h>
+#include <Poco/JSON/Parser.h>
+#include <Poco/Exception.h>
+
+#include "HNTDLog.h"
+#include "HNTestMicroBenchPrivate.h"
+
+using namespace Poco::Util;
+
+namespace pjs = Poco::JSON;
+namespace pdy = Poco::Dynamic;
+namespace pnt = Poco::Net;
+
+// Every allocation in the process is counted, the device has no
+// threads of its own when standalone so a dispatch's allocations
+// are its own
+static std::atomic< uint64_t > g_HNTMBAllocCount( 0 );
+static std::atomic< uint64_t > g_HNTMBAllocBytes( 0 );
+
+void*
+operator new( std::size_t size )
+{
+    g_HNTMBAllocCount.fetch_add( 1, std::memory_order_relaxed );
+    g_HNTMBAllocBytes.fetch_add( size, std::memory_order_relaxed );
+
+    void *ptr = malloc( ( size != 0 ) ? size : 1 );
+    if( ptr == NULL )
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void*
+operator new[]( std::size_t size )
+{
+    return operator new( size );
+}
+
+void
+operator delete( void *ptr ) noexcept
+{
+    free( ptr );
+}
+
+void
+operator delete[]( void *ptr ) noexcept
+{
+    free( ptr );
+}
+
+void
+operator delete( void *ptr, std::size_t size ) noexcept
+{
+    free( ptr );
+}
+
+void
+operator delete[]( void *ptr, std::size_t size ) noexcept
+{
+    free( ptr );
+}
+
+// Indexed by HNTMB_OP_T, named by the device operationIds.  Creates
+// run before deletes, which remove the widgets the creates made.
+static const char *g_HNTMBOpNames[ HNTMB_OP_COUNT ] =
+{
+    "getStatus",
+    "getWidgetList",
+    "getWidgetInfo",
+    "updateWidget",
+    "createWidget",
+    "deleteWidget",
+    "putTestHealth"
+};
+
+static const char *g_HNTMBHealthStates[] = { "OK", "FAILED", "UNKNOWN", "NOTE" };
+
+// Delay cap and injected latency for the delay check
+#define HNTMB_CHECK_MAX_DELAYED 2
+#define HNTMB_CHECK_DELAY_MS    1000
+
+static uint64_t
+hntmbNowNS()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+HNTMBResponse::HNTMBResponse( bool capture )
+: m_body( capture ? (std::ostream&) m_captured : (std::ostream&) m_null )
+{
+    m_bufferBytes = 0;
+    m_capture     = capture;
+    m_sent        = false;
+}
+
+HNTMBResponse::~HNTMBResponse()
+{
+
+}
+
+uint64_t
+HNTMBResponse::getBodyBytes()
+{
+    return m_body.chars() + m_bufferBytes;
+}
+
+std::string
+HNTMBResponse::getBody()
+{
+    m_body.flush();
+    return m_captured.str();
+}
+
+void
+HNTMBResponse::sendContinue()
+{
+
+}
+
+std::ostream&
+HNTMBResponse::send()
+{
+    m_sent = true;
+    return m_body;
+}
+
+std::pair< std::ostream*, std::ostream* >
+HNTMBResponse::beginSend()
+{
+    m_sent = true;
+    return std::make_pair( (std::ostream*) &m_null, (std::ostream*) &m_body );
+}
+
+void
+HNTMBResponse::sendFile( const std::string &path, const std::string &mediaType )
+{
+    m_sent = true;
+}
+
+void
+HNTMBResponse::sendBuffer( const void *buffer, std::size_t length )
+{
+    m_sent = true;
+    m_bufferBytes += length;
+
+    if( m_capture == true )
+        m_captured.write( (const char*) buffer, length );
+}
+
+void
+HNTMBResponse::redirect( const std::string &uri, HTTPStatus status )
+{
+    m_sent = true;
+}
+
+void
+HNTMBResponse::requireAuthentication( const std::string &realm )
+{
+    m_sent = true;
+}
+
+bool
+HNTMBResponse::sent() const
+{
+    return m_sent;
+}
+
+HNTMBRequest::HNTMBRequest( const std::string &method, const std::string &uri, const std::string &body, HNTMBResponse &response )
+: m_body( body ), m_params( new pnt::HTTPServerParams ), m_response( response )
+{
+    setMethod( method );
+    setURI( uri );
+    setVersion( pnt::HTTPMessage::HTTP_1_1 );
+
+    if( body.empty() == false )
+    {
+        setContentType( "application/json" );
+        setContentLength( body.size() );
+    }
+}
+
+HNTMBRequest::~HNTMBRequest()
+{
+
+}
+
+std::istream&
+HNTMBRequest::stream()
+{
+    return m_body;
+}
+
+const pnt::SocketAddress&
+HNTMBRequest::clientAddress() const
+{
+    return m_clientAddress;
+}
+
+const pnt::SocketAddress&
+HNTMBRequest::serverAddress() const
+{
+    return m_serverAddress;
+}
+
+const pnt::HTTPServerParams&
+HNTMBRequest::serverParams() const
+{
+    return *m_params;
+}
+
+pnt::HTTPServerResponse&
+HNTMBRequest::response() const
+{
+    return m_response;
+}
+
+bool
+HNTMBRequest::secure() const
+{
+    return false;
+}
+
+HNTMBResult::HNTMBResult()
+{
+    iterations = 0;
+    totalNS    = 0;
+    allocs     = 0;
+    allocBytes = 0;
+    bodyBytes  = 0;
+    errors     = 0;
+}
+
+HNTestMicroBench::HNTestMicroBench()
+: m_wheelRunning( false )
+{
+    m_iterations  = 100000;
+    m_warmup      = 1000;
+    m_widgetCount = 100;
+    m_tolerance   = 25;
+    m_check       = false;
+    m_wheelFD     = -1;
+}
+
+void
+HNTestMicroBench::defineOptions( OptionSet& options )
+{
+    Application::defineOptions( options );
+
+    options.addOption(
+              Option("help", "h", "display help").required(false).repeatable(false));
+
+    options.addOption(
+              Option("iterations", "n", "Measured dispatches per operation (default 100000).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("warmup", "w", "Unmeasured dispatches per operation before the measured ones (default 1000).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("widgets", "", "Widgets in the store while reads and updates run (default 100).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("json", "j", "Write the results as JSON to this file, usable as a baseline.").required(false).repeatable(false).argument("path"));
+
+    options.addOption(
+              Option("baseline", "b", "Fail if an operation is slower or allocates more than in this earlier --json output.").required(false).repeatable(false).argument("path"));
+
+    options.addOption(
+              Option("tolerance", "", "Percent ns/op may exceed the baseline before it is a regression (default 25).").required(false).repeatable(false).argument("percent"));
+
+    options.addOption(
+              Option("check", "", "Run the handler behaviour checks instead of timing, fail if any does not hold.").required(false).repeatable(false));
+}
+
+void
+HNTestMicroBench::handleOption( const std::string& name, const std::string& value )
+{
+    Application::handleOption( name, value );
+
+    if( "help" == name )
+        _helpRequested = true;
+    else if( "iterations" == name )
+        m_iterations = Poco::NumberParser::parseUnsigned( value );
+    else if( "warmup" == name )
+        m_warmup = Poco::NumberParser::parseUnsigned( value );
+    else if( "widgets" == name )
+        m_widgetCount = Poco::NumberParser::parseUnsigned( value );
+    else if( "json" == name )
+        m_jsonPath = value;
+    else if( "baseline" == name )
+        m_baselinePath = value;
+    else if( "tolerance" == name )
+        m_tolerance = Poco::NumberParser::parseFloat( value );
+    else if( "check" == name )
+        m_check = true;
+}
+
+void
+HNTestMicroBench::displayHelp()
+{
+    HelpFormatter helpFormatter(options());
+    helpFormatter.setCommand(commandName());
+    helpFormatter.setUsage("[options]");
+    helpFormatter.setHeader("HNode2 Test Device in-process handler microbenchmarks.");
+    helpFormatter.format(std::cout);
+}
+
+// The checks delay requests, which needs the timer wheel run the way
+// the daemon's event loop runs it
+bool
+HNTestMicroBench::startWheel()
+{
+    m_wheelFD = m_timerWheel.start();
+    if( m_wheelFD < 0 )
+        return false;
+
+    m_delayScheduler.start( &m_timerWheel );
+
+    m_wheelRunning = true;
+    m_wheelThread = std::thread( &HNTestMicroBench::runWheel, this );
+
+    return true;
+}
+
+void
+HNTestMicroBench::runWheel()
+{
+    struct pollfd pfd;
+
+    // Wake now and then to notice stopWheel()
+    while( m_wheelRunning.load() == true )
+    {
+        pfd.fd      = m_wheelFD;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if( ( poll( &pfd, 1, 50 ) > 0 ) && ( pfd.revents & POLLIN ) )
+            m_timerWheel.run();
+    }
+}
+
+void
+HNTestMicroBench::stopWheel()
+{
+    if( m_wheelRunning.load() == false )
+        return;
+
+    m_delayScheduler.stop();
+
+    m_wheelRunning = false;
+    m_wheelThread.join();
+
+    m_timerWheel.stop();
+}
+
+bool
+HNTestMicroBench::startDevice()
+{
+    HNTD_DEVICE_SETTINGS_T settings;
+    settings.instance          = "microbench";
+    settings.restPort          = 0;
+    settings.healthTreeFanout  = 0;
+    settings.healthTreeDepth   = 2;
+    settings.churnSeed         = 1;
+    settings.maxBodySize       = HNTD_DEFAULT_MAX_BODY_SIZE;
+    settings.compressMinSize   = HNTD_DEFAULT_COMPRESS_MIN_SIZE;
+    settings.changeFeedSize    = HNTD_DEFAULT_CHANGE_FEED_SIZE;
+    settings.changeFeedClients = HNTD_DEFAULT_CHANGE_FEED_CLIENTS;
+    settings.maxDelayed        = HNTMB_CHECK_MAX_DELAYED;
+    settings.healthHistorySize = HNTD_DEFAULT_HEALTH_HISTORY_SIZE;
+    settings.widgetCompactSize = HNTD_DEFAULT_WIDGET_COMPACT_SIZE;
+    settings.payloadSize       = 0;
+    settings.payloadShape      = HNTD_PAYLOAD_SHAPE_BLOB;
+    settings.fleetSize         = 1;
+    settings.configPersister   = NULL;
+    settings.churnPacer        = NULL;
+    settings.journalFlusher    = NULL;
+    settings.delayScheduler    = ( m_check == true ) ? &m_delayScheduler : NULL;
+    settings.payloadArena      = NULL;
+    settings.startupProfile    = NULL;
+    settings.standalone        = true;
+
+    if( m_device.start( settings ) != HNTD_RESULT_SUCCESS )
+        return false;
+
+    // Widgets for the reads and updates, made through the handler too
+    for( uint i = 0; i < m_widgetCount; i++ )
+    {
+        if( dispatch( HNTMB_OP_CREATE_WIDGET, i, NULL ) == false )
+            return false;
+    }
+
+    m_widgetIDs.swap( m_createdIDs );
+
+    return ( m_widgetIDs.empty() == false );
+}
+
+// One request through dispatchEP().  With a result the dispatch is
+// timed and its allocations and body bytes are added to it.
+bool
+HNTestMicroBench::dispatch( HNTMB_OP_T op, uint iteration, HNTMBResult *result )
+{
+    std::string method = pnt::HTTPRequest::HTTP_GET;
+    std::string uri;
+    std::string body;
+    std::string widgetID;
+
+    switch( op )
+    {
+        case HNTMB_OP_GET_STATUS:
+            uri = "/hnode2/test/status";
+        break;
+
+        case HNTMB_OP_GET_WIDGET_LIST:
+            uri = "/hnode2/test/widgets";
+        break;
+
+        case HNTMB_OP_GET_WIDGET_INFO:
+            widgetID = m_widgetIDs[ iteration % m_widgetIDs.size() ];
+            uri = "/hnode2/test/widgets/" + widgetID;
+        break;
+
+        case HNTMB_OP_UPDATE_WIDGET:
+            method = pnt::HTTPRequest::HTTP_PUT;
+            widgetID = m_widgetIDs[ iteration % m_widgetIDs.size() ];
+            uri = "/hnode2/test/widgets/" + widgetID;
+
+            // Alternate so every update changes the widget
+            body = std::string( "{\"color\":\"" ) + ( ( iteration & 1 ) ? "blue" : "green" ) + "\",\"name\":\"microbench\"}";
+        break;
+
+        case HNTMB_OP_CREATE_WIDGET:
+            method = pnt::HTTPRequest::HTTP_POST;
+            uri = "/hnode2/test/widgets";
+            body = "{\"color\":\"red\",\"name\":\"microbench\"}";
+        break;
+
+        case HNTMB_OP_DELETE_WIDGET:
+            if( m_createdIDs.empty() )
+                return false;
+
+            method = pnt::HTTPRequest::HTTP_DELETE;
+            widgetID = m_createdIDs.back();
+            m_createdIDs.pop_back();
+            uri = "/hnode2/test/widgets/" + widgetID;
+        break;
+
+        case HNTMB_OP_PUT_TEST_HEALTH:
+            method = pnt::HTTPRequest::HTTP_PUT;
+            uri = "/hnode2/test/health";
+            body = std::string( "{\"status\":\"" ) + g_HNTMBHealthStates[ iteration % 4 ] + "\",\"errCode\":500}";
+        break;
+
+        default:
+        return false;
+    }
+
+    HNTMBResponse response;
+    HNTMBRequest  request( method, uri, body, response );
+
+    // As the REST server hands it over after routing
+    HNOperationData opData( request, response );
+    opData.setDispatchID( "hnode2Test" );
+    opData.setOpID( g_HNTMBOpNames[ op ] );
+
+    if( widgetID.empty() == false )
+        opData.addParam( "widgetid", widgetID );
+
+    // Called the way libhnode2 calls it
+    HNDEPDispatchInf *dispatcher = &m_device;
+
+    uint64_t allocCount = g_HNTMBAllocCount.load( std::memory_order_relaxed );
+    uint64_t allocBytes = g_HNTMBAllocBytes.load( std::memory_order_relaxed );
+    uint64_t start      = hntmbNowNS();
+
+    dispatcher->dispatchEP( NULL, &opData );
+
+    uint64_t end = hntmbNowNS();
+
+    allocCount = g_HNTMBAllocCount.load( std::memory_order_relaxed ) - allocCount;
+    allocBytes = g_HNTMBAllocBytes.load( std::memory_order_relaxed ) - allocBytes;
+
+    bool success = ( response.getStatus() < pnt::HTTPResponse::HTTP_BAD_REQUEST );
+
+    // The new widget id is the last segment of the location
+    if( ( op == HNTMB_OP_CREATE_WIDGET ) && ( success == true ) )
+    {
+        std::string location = response.get( "Location", "" );
+        std::string::size_type slash = location.rfind( '/' );
+
+        if( location.empty() == false )
+            m_createdIDs.push_back( ( slash == std::string::npos ) ? location : location.substr( slash + 1 ) );
+    }
+
+    if( result != NULL )
+    {
+        result->latency.record( end - start );
+        result->iterations += 1;
+        result->totalNS    += end - start;
+        result->allocs     += allocCount;
+        result->allocBytes += allocBytes;
+        result->bodyBytes  += response.getBodyBytes();
+
+        if( success == false )
+            result->errors += 1;
+    }
+
+    return success;
+}
+
+void
+HNTestMicroBench::runOp( HNTMB_OP_T op )
+{
+    for( uint i = 0; i < m_warmup; i++ )
+        dispatch( op, i, NULL );
+
+    for( uint i = 0; i < m_iterations; i++ )
+        dispatch( op, i, &m_results[ op ] );
+}
+
+void
+HNTestMicroBench::report()
+{
+    pjs::Object jsRoot;
+    pjs::Object jsConfig;
+    pjs::Object jsOps;
+
+    jsConfig.set( "iterations", m_iterations );
+    jsConfig.set( "warmup", m_warmup );
+    jsConfig.set( "widgets", m_widgetCount );
+
+    printf( "%-14s %10s %10s %10s %10s %12s %12s %8s\n", "operation", "ns/op", "p50(ns)", "p99(ns)", "allocs/op", "allocB/op", "bytes/op", "errors" );
+
+    for( uint op = 0; op < HNTMB_OP_COUNT; op++ )
+    {
+        HNTMBResult &result = m_results[ op ];
+
+        if( result.iterations == 0 )
+            continue;
+
+        double count = (double) result.iterations;
+
+        printf( "%-14s %10.1f %10lu %10lu %10.2f %12.1f %12.1f %8lu\n", g_HNTMBOpNames[ op ],
+                result.totalNS / count, (unsigned long) result.latency.getPercentile( 50 ), (unsigned long) result.latency.getPercentile( 99 ),
+                result.allocs / count, result.allocBytes / count, result.bodyBytes / count, (unsigned long) result.errors );
+
+        pjs::Object jsOp;
+        jsOp.set( "iterations", result.iterations );
+        jsOp.set( "nsPerOp", result.totalNS / count );
+        jsOp.set( "p50Ns", result.latency.getPercentile( 50 ) );
+        jsOp.set( "p99Ns", result.latency.getPercentile( 99 ) );
+        jsOp.set( "allocsPerOp", result.allocs / count );
+        jsOp.set( "allocBytesPerOp", result.allocBytes / count );
+        jsOp.set( "bytesPerOp", result.bodyBytes / count );
+        jsOp.set( "errors", result.errors );
+        jsOps.set( g_HNTMBOpNames[ op ], jsOp );
+    }
+
+    if( m_jsonPath.empty() == false )
+    {
+        jsRoot.set( "config", jsConfig );
+        jsRoot.set( "operations", jsOps );
+
+        std::ofstream ofs( m_jsonPath );
+        pjs::Stringifier::stringify( jsRoot, ofs, 1 );
+        ofs << std::endl;
+
+        if( ofs.fail() )
+            std::cerr << "ERROR: Could not write results to " << m_jsonPath << std::endl;
+    }
+}
+
+// Operations in the baseline that are now slower than the tolerance
+// allows, or allocate more, are regressions.  Allocation counts are
+// exact, so any increase of a whole allocation per op counts.
+bool
+HNTestMicroBench::compareBaseline()
+{
+    pjs::Object::Ptr jsBaseOps;
+
+    try
+    {
+        std::ifstream ifs( m_baselinePath );
+        if( ifs.fail() )
+        {
+            std::cerr << "ERROR: Could not read baseline " << m_baselinePath << std::endl;
+            return false;
+        }
+
+        pjs::Parser parser;
+        pdy::Var varRoot = parser.parse( ifs );
+        jsBaseOps = varRoot.extract< pjs::Object::Ptr >()->getObject( "operations" );
+    }
+    catch( Poco::Exception &ex )
+    {
+        std::cerr << "ERROR: Could not parse baseline " << m_baselinePath << ": " << ex.displayText() << std::endl;
+        return false;
+    }
+
+    if( jsBaseOps.isNull() )
+    {
+        std::cerr << "ERROR: Baseline " << m_baselinePath << " has no operations" << std::endl;
+        return false;
+    }
+
+    bool passed = true;
+
+    for( uint op = 0; op < HNTMB_OP_COUNT; op++ )
+    {
+        HNTMBResult &result = m_results[ op ];
+        pjs::Object::Ptr jsBase = jsBaseOps->getObject( g_HNTMBOpNames[ op ] );
+
+        if( ( result.iterations == 0 ) || jsBase.isNull() )
+            continue;
+
+        double nsPerOp     = result.totalNS / (double) result.iterations;
+        double allocsPerOp = result.allocs / (double) result.iterations;
+        double baseNS      = jsBase->optValue( "nsPerOp", 0.0 );
+        double baseAllocs  = jsBase->optValue( "allocsPerOp", 0.0 );
+
+        if( ( baseNS > 0 ) && ( nsPerOp > ( baseNS * ( 1.0 + ( m_tolerance / 100.0 ) ) ) ) )
+        {
+            printf( "REGRESSION %-14s %.1f ns/op, baseline %.1f\n", g_HNTMBOpNames[ op ], nsPerOp, baseNS );
+            passed = false;
+        }
+
+        if( allocsPerOp >= ( baseAllocs + 1.0 ) )
+        {
+            printf( "REGRESSION %-14s %.2f allocs/op, baseline %.2f\n", g_HNTMBOpNames[ op ], allocsPerOp, baseAllocs );
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+uint
+HNTestMicroBench::request( const std::string &method, const std::string &uri, const std::string &opID, const std::string &body, std::string *responseBody )
+{
+    HNTMBResponse response( responseBody != NULL );
+    HNTMBRequest  request( method, uri, body, response );
+
+    HNOperationData opData( request, response );
+    opData.setDispatchID( "hnode2Test" );
+    opData.setOpID( opID );
+
+    HNDEPDispatchInf *dispatcher = &m_device;
+    dispatcher->dispatchEP( NULL, &opData );
+
+    if( responseBody != NULL )
+        *responseBody = response.getBody();
+
+    return response.getStatus();
+}
+
+// The newest change feed sequence, from the metrics
+bool
+HNTestMicroBench::getFeedSeq( uint64_t &seq )
+{
+    std::string body;
+
+    if( request( pnt::HTTPRequest::HTTP_GET, "/hnode2/test/metrics", "getMetrics", "", &body ) != pnt::HTTPResponse::HTTP_OK )
+        return false;
+
+    try
+    {
+        pjs::Parser parser;
+        pdy::Var varRoot = parser.parse( body );
+        seq = varRoot.extract< pjs::Object::Ptr >()->getObject( "changeFeed" )->getValue< uint64_t >( "seq" );
+    }
+    catch( Poco::Exception &ex )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// One counter from the metrics faults object
+bool
+HNTestMicroBench::getFaultCount( const std::string &name, uint64_t &value )
+{
+    std::string body;
+
+    if( request( pnt::HTTPRequest::HTTP_GET, "/hnode2/test/metrics", "getMetrics", "", &body ) != pnt::HTTPResponse::HTTP_OK )
+        return false;
+
+    try
+    {
+        pjs::Parser parser;
+        pdy::Var varRoot = parser.parse( body );
+        value = varRoot.extract< pjs::Object::Ptr >()->getObject( "faults" )->getValue< uint64_t >( name );
+    }
+    catch( Poco::Exception &ex )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// A health change with an unknown status is refused and publishes
+// nothing, a good one is applied and published once
+bool
+HNTestMicroBench::checkHealthRejected( std::string &error )
+{
+    uint64_t before;
+    uint64_t after;
+
+    if( getFeedSeq( before ) == false )
+    {
+        error = "could not read the change feed sequence";
+        return false;
+    }
+
+    uint status = request( pnt::HTTPRequest::HTTP_PUT, "/hnode2/test/health", "putTestHealth", "{\"status\":\"BOGUS\"}", NULL );
+    if( status != pnt::HTTPResponse::HTTP_BAD_REQUEST )
+    {
+        error = "unknown status answered " + std::to_string( status );
+        return false;
+    }
+
+    if( ( getFeedSeq( after ) == false ) || ( after != before ) )
+    {
+        error = "unknown status published a change";
+        return false;
+    }
+
+    status = request( pnt::HTTPRequest::HTTP_PUT, "/hnode2/test/health", "putTestHealth", "{\"status\":\"FAILED\",\"errCode\":500}", NULL );
+    if( status != pnt::HTTPResponse::HTTP_OK )
+    {
+        error = "valid status answered " + std::to_string( status );
+        return false;
+    }
+
+    if( ( getFeedSeq( after ) == false ) || ( after != ( before + 1 ) ) )
+    {
+        error = "valid status was not published once";
+        return false;
+    }
+
+    return true;
+}
+
+// With the cap's worth of requests held for latency, one more delayed
+// request is answered 503 straight away and undelayed requests are
+// still served, then the held requests complete
+bool
+HNTestMicroBench::checkDelayCapped( std::string &error )
+{
+    std::string rules = "{\"operations\":{\"getWidgetList\":{\"latency\":{\"distribution\":\"fixed\",\"ms\":"
+                        + std::to_string( HNTMB_CHECK_DELAY_MS ) + "}}}}";
+
+    if( request( pnt::HTTPRequest::HTTP_PUT, "/hnode2/test/faults", "putFaults", rules, NULL ) != pnt::HTTPResponse::HTTP_OK )
+    {
+        error = "could not set the latency rule";
+        return false;
+    }
+
+    std::thread held[ HNTMB_CHECK_MAX_DELAYED ];
+    std::atomic< uint > heldOK( 0 );
+
+    for( uint i = 0; i < HNTMB_CHECK_MAX_DELAYED; i++ )
+    {
+        held[i] = std::thread( [ this, &heldOK ]()
+        {
+            if( request( pnt::HTTPRequest::HTTP_GET, "/hnode2/test/widgets", "getWidgetList", "", NULL ) == pnt::HTTPResponse::HTTP_OK )
+                heldOK++;
+        } );
+    }
+
+    // Wait for every held request to be parked
+    uint64_t delayedNow = 0;
+    for( uint i = 0; i < 100; i++ )
+    {
+        if( ( getFaultCount( "delayedNow", delayedNow ) == true ) && ( delayedNow == HNTMB_CHECK_MAX_DELAYED ) )
+            break;
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+    }
+
+    bool passed = true;
+
+    if( delayedNow != HNTMB_CHECK_MAX_DELAYED )
+    {
+        error = "held requests were not delayed, delayedNow " + std::to_string( delayedNow );
+        passed = false;
+    }
+
+    // Both of these must be answered well inside the held delay
+    uint64_t limitNS = ( HNTMB_CHECK_DELAY_MS * 1000000ULL ) / 2;
+
+    uint64_t startNS = hntmbNowNS();
+    uint status = request( pnt::HTTPRequest::HTTP_GET, "/hnode2/test/widgets", "getWidgetList", "", NULL );
+    uint64_t elapsedNS = hntmbNowNS() - startNS;
+    if( passed && ( ( status != pnt::HTTPResponse::HTTP_SERVICE_UNAVAILABLE ) || ( elapsedNS > limitNS ) ) )
+    {
+        error = "delay past the cap answered " + std::to_string( status ) + " after " + std::to_string( elapsedNS / 1000000 ) + " ms";
+        passed = false;
+    }
+
+    startNS = hntmbNowNS();
+    status = request( pnt::HTTPRequest::HTTP_GET, "/hnode2/test/status", "getStatus", "", NULL );
+    elapsedNS = hntmbNowNS() - startNS;
+    if( passed && ( ( status != pnt::HTTPResponse::HTTP_OK ) || ( elapsedNS > limitNS ) ) )
+    {
+        error = "undelayed request answered " + std::to_string( status ) + " after " + std::to_string( elapsedNS / 1000000 ) + " ms";
+        passed = false;
+    }
+
+    for( uint i = 0; i < HNTMB_CHECK_MAX_DELAYED; i++ )
+        held[i].join();
+
+    if( passed && ( heldOK.load() != HNTMB_CHECK_MAX_DELAYED ) )
+    {
+        error = "held requests did not complete";
+        passed = false;
+    }
+
+    uint64_t rejected = 0;
+    if( passed && ( ( getFaultCount( "delayRejected", rejected ) == false ) || ( rejected != 1 ) ) )
+    {
+        error = "delayRejected is " + std::to_string( rejected );
+        passed = false;
+    }
+
+    request( pnt::HTTPRequest::HTTP_PUT, "/hnode2/test/faults", "putFaults", "{\"operations\":{}}", NULL );
+
+    return passed;
+}
+
+bool
+HNTestMicroBench::runChecks()
+{
+    typedef bool (HNTestMicroBench::*CHECK_T)( std::string &error );
+
+    static const struct
+    {
+        const char *name;
+        CHECK_T     check;
+    }checks[] =
+    {
+        { "putTestHealth rejects an unknown status", &HNTestMicroBench::checkHealthRejected },
+        { "delays past the cap are answered 503",    &HNTestMicroBench::checkDelayCapped },
+    };
+
+    bool passed = true;
+
+    for( uint i = 0; i < ( sizeof( checks ) / sizeof( checks[0] ) ); i++ )
+    {
+        std::string error;
+
+        if( ( this->*( checks[i].check ) )( error ) == true )
+            printf( "PASS %s\n", checks[i].name );
+        else
+        {
+            printf( "FAIL %s: %s\n", checks[i].name, error.c_str() );
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+int
+HNTestMicroBench::main( const std::vector<std::string>& args )
+{
+    if( _helpRequested == true )
+    {
+        displayHelp();
+        return Application::EXIT_OK;
+    }
+
+    if( ( m_iterations == 0 ) || ( m_widgetCount == 0 ) )
+    {
+        displayHelp();
+        return Application::EXIT_USAGE;
+    }
+
+    // Handler logging would be timed with the handlers
+    HNTDLog::getInstance().setLevel( HNTD_LOG_LEVEL_WARN );
+    HNTDLog::getInstance().start();
+
+    if( ( m_check == true ) && ( startWheel() == false ) )
+    {
+        std::cerr << "ERROR: Could not start the timer wheel" << std::endl;
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_SOFTWARE;
+    }
+
+    if( startDevice() == false )
+    {
+        std::cerr << "ERROR: Could not start the standalone device" << std::endl;
+        stopWheel();
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_SOFTWARE;
+    }
+
+    if( m_check == true )
+    {
+        bool passed = runChecks();
+
+        m_device.stop();
+        stopWheel();
+        HNTDLog::getInstance().stop();
+
+        return ( passed == true ) ? Application::EXIT_OK : Application::EXIT_SOFTWARE;
+    }
+
+    std::cout << "Dispatching " << m_iterations << " requests per operation (+" << m_warmup << " warmup) against "
+              << m_widgetCount << " widgets" << std::endl;
+
+    for( uint op = 0; op < HNTMB_OP_COUNT; op++ )
+        runOp( (HNTMB_OP_T) op );
+
+    report();
+
+    bool passed = true;
+    if( m_baselinePath.empty() == false )
+        passed = compareBaseline();
+
+    m_device.stop();
+
+    HNTDLog::getInstance().stop();
+
+    return ( passed == true ) ? Application::EXIT_OK : Application::EXIT_SOFTWARE;
+}
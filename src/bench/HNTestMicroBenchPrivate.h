@@ -0,0 +1,183 @@
+#ifndef __HN_TEST_MICRO_BENCH_PRIVATE_H__
+#define __HN_TEST_MICRO_BENCH_PRIVATE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <atomic>
+
+#include "Poco/Util/Application.h"
+#include "Poco/Util/OptionSet.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/CountingStream.h"
+#include "Poco/NullStream.h"
+
+#include "HNTDHistogram.h"
+#include "HNTDTimerWheel.h"
+#include "HNTDDelayScheduler.h"
+#include "HNTestDevicePrivate.h"
+
+typedef enum HNTestMicroBenchOpEnum
+{
+  HNTMB_OP_GET_STATUS,
+  HNTMB_OP_GET_WIDGET_LIST,
+  HNTMB_OP_GET_WIDGET_INFO,
+  HNTMB_OP_UPDATE_WIDGET,
+  HNTMB_OP_CREATE_WIDGET,
+  HNTMB_OP_DELETE_WIDGET,
+  HNTMB_OP_PUT_TEST_HEALTH,
+  HNTMB_OP_COUNT
+}HNTMB_OP_T;
+
+// Response that counts the body bytes written instead of sending them.
+// With capture set the body is kept for the checks to read.
+class HNTMBResponse : public Poco::Net::HTTPServerResponse
+{
+    private:
+        Poco::NullOutputStream     m_null;
+        std::ostringstream         m_captured;
+        Poco::CountingOutputStream m_body;
+
+        uint64_t m_bufferBytes;
+        bool     m_capture;
+        bool     m_sent;
+
+    public:
+        HNTMBResponse( bool capture = false );
+       ~HNTMBResponse();
+
+        uint64_t getBodyBytes();
+        std::string getBody();
+
+        // Poco::Net::HTTPServerResponse
+        void sendContinue();
+        std::ostream& send();
+        std::pair< std::ostream*, std::ostream* > beginSend();
+        void sendFile( const std::string &path, const std::string &mediaType );
+        void sendBuffer( const void *buffer, std::size_t length );
+        void redirect( const std::string &uri, HTTPStatus status = HTTP_FOUND );
+        void requireAuthentication( const std::string &realm );
+        bool sent() const;
+};
+
+// Request with a canned body and no connection behind it
+class HNTMBRequest : public Poco::Net::HTTPServerRequest
+{
+    private:
+        std::istringstream m_body;
+
+        Poco::Net::SocketAddress         m_clientAddress;
+        Poco::Net::SocketAddress         m_serverAddress;
+        Poco::Net::HTTPServerParams::Ptr m_params;
+
+        HNTMBResponse &m_response;
+
+    public:
+        HNTMBRequest( const std::string &method, const std::string &uri, const std::string &body, HNTMBResponse &response );
+       ~HNTMBRequest();
+
+        // Poco::Net::HTTPServerRequest
+        std::istream& stream();
+        const Poco::Net::SocketAddress& clientAddress() const;
+        const Poco::Net::SocketAddress& serverAddress() const;
+        const Poco::Net::HTTPServerParams& serverParams() const;
+        Poco::Net::HTTPServerResponse& response() const;
+        bool secure() const;
+};
+
+// Results for one operation
+class HNTMBResult
+{
+    public:
+        HNTDHistogram latency;
+
+        uint64_t iterations;
+        uint64_t totalNS;
+        uint64_t allocs;
+        uint64_t allocBytes;
+        uint64_t bodyBytes;
+        uint64_t errors;
+
+        HNTMBResult();
+};
+
+// Drives HNTestDevice::dispatchEP() in process, one operation at a
+// time, against a standalone device with no REST server.  Only the
+// dispatch is timed; the request is built before and the response
+// inspected after.  With --check it runs behaviour checks against the
+// same device instead of timing it, with a timer wheel on its own
+// thread to release delayed requests.
+class HNTestMicroBench : public Poco::Util::Application
+{
+    private:
+        bool _helpRequested = false;
+
+        uint        m_iterations;
+        uint        m_warmup;
+        uint        m_widgetCount;
+        double      m_tolerance;
+        std::string m_jsonPath;
+        std::string m_baselinePath;
+        bool        m_check;
+
+        HNTestDevice m_device;
+
+        // Releases delayed requests, only run for the checks
+        HNTDTimerWheel      m_timerWheel;
+        HNTDDelayScheduler  m_delayScheduler;
+        int                 m_wheelFD;
+        std::thread         m_wheelThread;
+        std::atomic< bool > m_wheelRunning;
+
+        // Widgets every read and update works against
+        std::vector< std::string > m_widgetIDs;
+
+        // Made by the createWidget run for the deleteWidget run
+        std::vector< std::string > m_createdIDs;
+
+        HNTMBResult m_results[ HNTMB_OP_COUNT ];
+
+        void displayHelp();
+
+        bool startWheel();
+        void runWheel();
+        void stopWheel();
+
+        bool startDevice();
+
+        bool dispatch( HNTMB_OP_T op, uint iteration, HNTMBResult *result );
+
+        void runOp( HNTMB_OP_T op );
+
+        void report();
+        bool compareBaseline();
+
+        // One untimed request, returns the response status
+        uint request( const std::string &method, const std::string &uri, const std::string &opID, const std::string &body, std::string *responseBody );
+
+        bool getFeedSeq( uint64_t &seq );
+        bool getFaultCount( const std::string &name, uint64_t &value );
+
+        bool checkHealthRejected( std::string &error );
+        bool checkDelayCapped( std::string &error );
+
+        bool runChecks();
+
+    protected:
+        // Poco funcions
+        void defineOptions( Poco::Util::OptionSet& options );
+        void handleOption( const std::string& name, const std::string& value );
+        int main( const std::vector<std::string>& args );
+
+    public:
+        HNTestMicroBench();
+};
+
+#endif // __HN_TEST_MICRO_BENCH_PRIVATE_H__
@@ -0,0 +1,9 @@
+#include "HNTestBenchPrivate.h"
+
+int 
+main( int argc, char* argv[] )
+{
+    HNTestBench bench;    
+    return bench.run( argc, argv );
+}
+
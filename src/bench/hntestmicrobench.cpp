@@ -0,0 +1,8 @@
+#include "HNTestMicroBenchPrivate.h"
+
+int 
+main( int argc, char* argv[] )
+{
+    HNTestMicroBench bench;    
+    return bench.run( argc, argv );
+}
@@ -0,0 +1,240 @@
+#include <chrono>
+
+#include "HNTDChangeFeed.h"
+
+HNTDChangeFeed::HNTDChangeFeed()
+{
+    m_lastSeq     = 0;
+    m_waiters     = 0;
+    m_stopped     = false;
+    m_resyncCount = 0;
+    m_maxClients  = HNTD_DEFAULT_CHANGE_FEED_CLIENTS;
+    m_clients     = 0;
+    m_rejectCount = 0;
+
+    m_ring.resize( HNTD_DEFAULT_CHANGE_FEED_SIZE );
+}
+
+HNTDChangeFeed::~HNTDChangeFeed()
+{
+
+}
+
+void
+HNTDChangeFeed::setCapacity( uint capacity )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( capacity == 0 )
+        capacity = 1;
+
+    m_ring.clear();
+    m_ring.resize( capacity );
+}
+
+void
+HNTDChangeFeed::setMaxClients( uint maxClients )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    m_maxClients = maxClients;
+}
+
+bool
+HNTDChangeFeed::addClient()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_clients >= m_maxClients )
+    {
+        m_rejectCount += 1;
+        return false;
+    }
+
+    m_clients += 1;
+    return true;
+}
+
+void
+HNTDChangeFeed::removeClient()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    m_clients -= 1;
+}
+
+uint64_t
+HNTDChangeFeed::publish( HNTD_CHANGE_EVENT_T &event )
+{
+    uint64_t seq;
+    bool     wake;
+
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        m_lastSeq += 1;
+        seq = m_lastSeq;
+
+        event.seq = seq;
+        m_ring[ seq % m_ring.size() ] = std::move( event );
+
+        wake = ( m_waiters > 0 );
+    }
+
+    // Most writes have nobody waiting
+    if( wake == true )
+        m_changed.notify_all();
+
+    return seq;
+}
+
+uint64_t
+HNTDChangeFeed::publishWidget( HNTD_CHANGE_TYPE_T type, const std::string &id, const std::string &color, const std::string &name )
+{
+    HNTD_CHANGE_EVENT_T event;
+
+    event.type    = type;
+    event.id      = id;
+    event.color   = color;
+    event.name    = name;
+    event.errCode = 0;
+
+    return publish( event );
+}
+
+uint64_t
+HNTDChangeFeed::publishHealth( const std::string &component, const std::string &status, uint errCode )
+{
+    HNTD_CHANGE_EVENT_T event;
+
+    event.type    = HNTD_CHANGE_HEALTH;
+    event.id      = component;
+    event.status  = status;
+    event.errCode = errCode;
+
+    return publish( event );
+}
+
+HNTDCF_RESULT_T
+HNTDChangeFeed::read( uint64_t since, uint maxEvents, uint timeoutMS, std::vector< HNTD_CHANGE_EVENT_T > &events, uint64_t &lastSeq )
+{
+    std::unique_lock< std::mutex > lock( m_lock );
+
+    events.clear();
+
+    if( ( m_stopped == false ) && ( since == m_lastSeq ) && ( timeoutMS > 0 ) )
+    {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeoutMS );
+
+        m_waiters += 1;
+
+        while( ( m_stopped == false ) && ( since == m_lastSeq ) )
+        {
+            if( m_changed.wait_until( lock, deadline ) == std::cv_status::timeout )
+                break;
+        }
+
+        m_waiters -= 1;
+    }
+
+    lastSeq = m_lastSeq;
+
+    if( m_stopped == true )
+        return HNTDCF_RESULT_STOPPED;
+
+    // Overwritten, or from before a restart
+    if( ( since > m_lastSeq ) || ( ( m_lastSeq - since ) > m_ring.size() ) )
+    {
+        m_resyncCount += 1;
+        return HNTDCF_RESULT_RESYNC;
+    }
+
+    if( since == m_lastSeq )
+        return HNTDCF_RESULT_TIMEOUT;
+
+    for( uint64_t seq = since + 1; ( seq <= m_lastSeq ) && ( events.size() < maxEvents ); seq++ )
+        events.push_back( m_ring[ seq % m_ring.size() ] );
+
+    return HNTDCF_RESULT_EVENTS;
+}
+
+void
+HNTDChangeFeed::stop()
+{
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+        m_stopped = true;
+    }
+
+    m_changed.notify_all();
+}
+
+uint64_t
+HNTDChangeFeed::getLastSeq()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_lastSeq;
+}
+
+uint64_t
+HNTDChangeFeed::getResyncCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_resyncCount;
+}
+
+uint
+HNTDChangeFeed::getClientCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_clients;
+}
+
+uint64_t
+HNTDChangeFeed::getRejectCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_rejectCount;
+}
+
+const char*
+HNTDChangeFeed::getTypeName( HNTD_CHANGE_TYPE_T type )
+{
+    switch( type )
+    {
+        case HNTD_CHANGE_WIDGET_CREATED:
+            return "widgetCreated";
+
+        case HNTD_CHANGE_WIDGET_UPDATED:
+            return "widgetUpdated";
+
+        case HNTD_CHANGE_WIDGET_DELETED:
+            return "widgetDeleted";
+
+        case HNTD_CHANGE_HEALTH:
+            return "health";
+    }
+
+    return "unknown";
+}
+
+HNTDChangeFeedClient::HNTDChangeFeedClient( HNTDChangeFeed &feed )
+{
+    m_feed = ( feed.addClient() == true ) ? &feed : NULL;
+}
+
+HNTDChangeFeedClient::~HNTDChangeFeedClient()
+{
+    if( m_feed != NULL )
+        m_feed->removeClient();
+}
+
+bool
+HNTDChangeFeedClient::isAdmitted()
+{
+    return ( m_feed != NULL );
+}
@@ -0,0 +1,119 @@
+#ifndef __HNTD_CHANGE_FEED_H__
+#define __HNTD_CHANGE_FEED_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#define HNTD_DEFAULT_CHANGE_FEED_SIZE  4096
+
+// Long-polls and streams let in at once per device.  Each holds a REST
+// worker while it waits, so this stays under the server's pool of 16.
+#define HNTD_DEFAULT_CHANGE_FEED_CLIENTS  8
+
+typedef enum HNTDChangeFeedResultEnum
+{
+  HNTDCF_RESULT_EVENTS,    // Events after the cursor were returned
+  HNTDCF_RESULT_TIMEOUT,   // Nothing new before the timeout
+  HNTDCF_RESULT_RESYNC,    // The cursor is no longer in the ring
+  HNTDCF_RESULT_STOPPED
+}HNTDCF_RESULT_T;
+
+typedef enum HNTDChangeTypeEnum
+{
+  HNTD_CHANGE_WIDGET_CREATED,
+  HNTD_CHANGE_WIDGET_UPDATED,
+  HNTD_CHANGE_WIDGET_DELETED,
+  HNTD_CHANGE_HEALTH
+}HNTD_CHANGE_TYPE_T;
+
+// One mutation.  For widgets id is the widget id and color and name
+// its new fields.  For health id is the component, empty when a whole
+// update cycle changed, status its new status and errCode the error
+// code of a failure.
+typedef struct HNTDChangeEventStruct
+{
+    uint64_t            seq;
+    HNTD_CHANGE_TYPE_T  type;
+    std::string         id;
+    std::string         color;
+    std::string         name;
+    std::string         status;
+    uint                errCode;
+}HNTD_CHANGE_EVENT_T;
+
+// Fixed size ring of the latest mutation events, numbered by a sequence
+// that starts at 1.  Readers hold a cursor, the last sequence they have
+// seen, and block until there is something after it.  A cursor that has
+// been overwritten, or that is ahead of the feed because it came from an
+// earlier run, gets a resync and must reread the state it follows.
+class HNTDChangeFeed
+{
+    private:
+        std::mutex              m_lock;
+        std::condition_variable m_changed;
+
+        std::vector< HNTD_CHANGE_EVENT_T > m_ring;
+
+        uint64_t m_lastSeq;
+        uint     m_waiters;
+        bool     m_stopped;
+
+        uint64_t m_resyncCount;
+
+        uint     m_maxClients;
+        uint     m_clients;
+        uint64_t m_rejectCount;
+
+        uint64_t publish( HNTD_CHANGE_EVENT_T &event );
+
+    public:
+        HNTDChangeFeed();
+       ~HNTDChangeFeed();
+
+        // Drops every event, only meant for setup
+        void setCapacity( uint capacity );
+
+        // Waiting clients are counted through HNTDChangeFeedClient
+        void setMaxClients( uint maxClients );
+        bool addClient();
+        void removeClient();
+
+        uint64_t publishWidget( HNTD_CHANGE_TYPE_T type, const std::string &id, const std::string &color, const std::string &name );
+        uint64_t publishHealth( const std::string &component, const std::string &status, uint errCode );
+
+        // Copy up to maxEvents events after since, waiting up to
+        // timeoutMS for the first.  lastSeq is set to the newest
+        // sequence, the cursor to continue from after a resync.
+        HNTDCF_RESULT_T read( uint64_t since, uint maxEvents, uint timeoutMS, std::vector< HNTD_CHANGE_EVENT_T > &events, uint64_t &lastSeq );
+
+        // Wake every reader for good
+        void stop();
+
+        uint64_t getLastSeq();
+        uint64_t getResyncCount();
+        uint     getClientCount();
+        uint64_t getRejectCount();
+
+        static const char* getTypeName( HNTD_CHANGE_TYPE_T type );
+};
+
+// Holds one of the feed's client places from construction until
+// destruction.  isAdmitted() is false if the feed was already full.
+class HNTDChangeFeedClient
+{
+    private:
+        HNTDChangeFeed *m_feed;
+
+    public:
+        HNTDChangeFeedClient( HNTDChangeFeed &feed );
+       ~HNTDChangeFeedClient();
+
+        bool isAdmitted();
+};
+
+#endif // __HNTD_CHANGE_FEED_H__
@@ -0,0 +1,131 @@
+#include <time.h>
+
+#include "HNTDChurnPacer.h"
+
+// Never tick faster than the timer wheel, higher rates issue several
+// per tick
+#define HNTD_PACER_MIN_TICK_MS  1
+
+static uint64_t
+hntdPacerNowNS()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+HNTDChurnPacer::HNTDChurnPacer()
+: m_issued( 0 ), m_achievedRate( 0 )
+{
+    m_rate               = 0;
+    m_tickMS             = 0;
+    m_startNS            = 0;
+    m_scheduled          = 0;
+    m_windowStartNS      = 0;
+    m_windowIssued       = 0;
+    m_windowsSinceReport = 0;
+}
+
+HNTDChurnPacer::~HNTDChurnPacer()
+{
+
+}
+
+bool
+HNTDChurnPacer::start( double ratePerSec )
+{
+    if( ratePerSec <= 0 )
+        return false;
+
+    m_rate = ratePerSec;
+
+    m_tickMS = (uint64_t)( 1000.0 / ratePerSec );
+    if( m_tickMS < HNTD_PACER_MIN_TICK_MS )
+        m_tickMS = HNTD_PACER_MIN_TICK_MS;
+
+    m_startNS            = hntdPacerNowNS();
+    m_scheduled          = 0;
+    m_windowStartNS      = m_startNS;
+    m_windowIssued       = 0;
+    m_windowsSinceReport = 0;
+
+    m_issued.store( 0 );
+    m_achievedRate.store( 0 );
+
+    return true;
+}
+
+uint64_t
+HNTDChurnPacer::getTickMS()
+{
+    return m_tickMS;
+}
+
+uint
+HNTDChurnPacer::getDueCount()
+{
+    if( m_rate <= 0 )
+        return 0;
+
+    double   elapsed = (double)( hntdPacerNowNS() - m_startNS ) / 1000000000.0;
+    uint64_t target  = (uint64_t)( elapsed * m_rate );
+
+    if( target <= m_scheduled )
+        return 0;
+
+    // After a stall, catch up at most one second of backlog
+    uint64_t backlogCap = (uint64_t) m_rate + 1;
+    if( ( target - m_scheduled ) > backlogCap )
+        m_scheduled = target - backlogCap;
+
+    uint due = (uint)( target - m_scheduled );
+    m_scheduled = target;
+
+    return due;
+}
+
+void
+HNTDChurnPacer::markIssued( uint count )
+{
+    uint64_t issued = m_issued.load( std::memory_order_relaxed ) + count;
+    m_issued.store( issued, std::memory_order_relaxed );
+
+    uint64_t now = hntdPacerNowNS();
+    if( ( now - m_windowStartNS ) < 1000000000ULL )
+        return;
+
+    double seconds = (double)( now - m_windowStartNS ) / 1000000000.0;
+    m_achievedRate.store( (double)( issued - m_windowIssued ) / seconds, std::memory_order_relaxed );
+
+    m_windowStartNS       = now;
+    m_windowIssued        = issued;
+    m_windowsSinceReport += 1;
+}
+
+bool
+HNTDChurnPacer::reportDue( uint reportSeconds )
+{
+    if( m_windowsSinceReport < reportSeconds )
+        return false;
+
+    m_windowsSinceReport = 0;
+    return true;
+}
+
+double
+HNTDChurnPacer::getTargetRate()
+{
+    return m_rate;
+}
+
+double
+HNTDChurnPacer::getAchievedRate()
+{
+    return m_achievedRate.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDChurnPacer::getIssuedCount()
+{
+    return m_issued.load( std::memory_order_relaxed );
+}
@@ -0,0 +1,53 @@
+#ifndef __HNTD_CHURN_PACER_H__
+#define __HNTD_CHURN_PACER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+
+// Paces a stream of events at a fixed rate from an event loop.  A
+// periodic timer on the loop's timer wheel calls getDueCount() every
+// getTickMS(), at high rates several events are due per tick and the
+// due count is derived from elapsed time so missed ticks are caught
+// up rather than lost.  The rate actually achieved
+// is measured over one second windows.
+class HNTDChurnPacer
+{
+    private:
+        double   m_rate;
+        uint64_t m_tickMS;
+
+        uint64_t m_startNS;
+        uint64_t m_scheduled;
+
+        uint64_t m_windowStartNS;
+        uint64_t m_windowIssued;
+        uint     m_windowsSinceReport;
+
+        std::atomic< uint64_t > m_issued;
+        std::atomic< double >   m_achievedRate;
+
+    public:
+        HNTDChurnPacer();
+       ~HNTDChurnPacer();
+
+        // Rate is in events per second, false if it is not positive
+        bool start( double ratePerSec );
+
+        // Period to run getDueCount() at
+        uint64_t getTickMS();
+
+        // Number of events to generate now, call markIssued() after
+        uint getDueCount();
+        void markIssued( uint count );
+
+        // True roughly every reportSeconds
+        bool reportDue( uint reportSeconds );
+
+        double getTargetRate();
+        double getAchievedRate();
+        uint64_t getIssuedCount();
+};
+
+#endif // __HNTD_CHURN_PACER_H__
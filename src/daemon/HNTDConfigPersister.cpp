@@ -0,0 +1,143 @@
+#include "HNTDLog.h"
+#include "HNTDConfigPersister.h"
+
+#define HNTD_CONFIG_DEFAULT_WINDOW_MS  500
+
+HNTDConfigPersister::HNTDConfigPersister()
+: m_window( HNTD_CONFIG_DEFAULT_WINDOW_MS )
+{
+    m_running      = false;
+    m_requestCount = 0;
+    m_saveCount    = 0;
+    m_failCount    = 0;
+}
+
+HNTDConfigPersister::~HNTDConfigPersister()
+{
+    stop();
+}
+
+void
+HNTDConfigPersister::setWindow( uint windowMS )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    m_window = std::chrono::milliseconds( windowMS );
+}
+
+void
+HNTDConfigPersister::start()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_running == true )
+        return;
+
+    m_running = true;
+
+    m_thread = std::thread( &HNTDConfigPersister::persistLoop, this );
+}
+
+void
+HNTDConfigPersister::stop()
+{
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        if( m_running == false )
+            return;
+
+        m_running = false;
+    }
+
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+void
+HNTDConfigPersister::requestSave( HNTDConfigPersistInf *owner )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    m_requestCount += 1;
+
+    // Already part of a pending burst
+    if( m_dirty.insert( owner ).second == false )
+        return;
+
+    PENDING_T pending;
+    pending.owner    = owner;
+    pending.deadline = std::chrono::steady_clock::now() + m_window;
+
+    m_pending.push_back( pending );
+
+    if( m_pending.size() == 1 )
+        m_wakeup.notify_one();
+}
+
+void
+HNTDConfigPersister::persistLoop()
+{
+    std::unique_lock< std::mutex > lock( m_lock );
+
+    while( true )
+    {
+        // Wait for a change, or the end of the oldest window
+        if( m_pending.empty() )
+        {
+            if( m_running == false )
+                break;
+
+            m_wakeup.wait( lock );
+            continue;
+        }
+
+        PENDING_T pending = m_pending.front();
+
+        if( ( m_running == true ) && ( std::chrono::steady_clock::now() < pending.deadline ) )
+        {
+            m_wakeup.wait_until( lock, pending.deadline );
+            continue;
+        }
+
+        // Changes arriving during the save start a new window
+        m_pending.pop_front();
+        m_dirty.erase( pending.owner );
+
+        lock.unlock();
+        bool result = pending.owner->persistConfig();
+        lock.lock();
+
+        if( result == true )
+        {
+            m_saveCount += 1;
+            HNTD_LOG_DEBUG( "Config saved (%lu change requests, %lu saves)", (unsigned long) m_requestCount, (unsigned long) m_saveCount );
+        }
+        else
+            m_failCount += 1;
+    }
+}
+
+uint64_t
+HNTDConfigPersister::getRequestCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_requestCount;
+}
+
+uint64_t
+HNTDConfigPersister::getSaveCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_saveCount;
+}
+
+uint64_t
+HNTDConfigPersister::getFailCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_failCount;
+}
@@ -0,0 +1,74 @@
+#ifndef __HNTD_CONFIG_PERSISTER_H__
+#define __HNTD_CONFIG_PERSISTER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_set>
+
+// Implemented by the owner of the configuration, called on the
+// persister thread to build and write the current configuration.
+class HNTDConfigPersistInf
+{
+    public:
+        virtual bool persistConfig() = 0;
+};
+
+// Write-behind saving of device configurations.  requestSave() only
+// marks an owner's configuration dirty, a background thread performs
+// the save once the debounce window after the first request in a
+// burst has passed, so any number of changes inside the window turn
+// into a single write and the caller never waits on disk I/O.  One
+// persister thread serves every device in the process.
+class HNTDConfigPersister
+{
+    private:
+        typedef struct PendingStruct
+        {
+            HNTDConfigPersistInf                  *owner;
+            std::chrono::steady_clock::time_point  deadline;
+        }PENDING_T;
+
+        std::chrono::milliseconds m_window;
+
+        std::mutex              m_lock;
+        std::condition_variable m_wakeup;
+        std::thread             m_thread;
+
+        bool m_running;
+
+        // Windows all have the same length, so deadlines are in order
+        std::deque< PENDING_T > m_pending;
+        std::unordered_set< HNTDConfigPersistInf* > m_dirty;
+
+        uint64_t m_requestCount;
+        uint64_t m_saveCount;
+        uint64_t m_failCount;
+
+        void persistLoop();
+
+    public:
+        HNTDConfigPersister();
+       ~HNTDConfigPersister();
+
+        void setWindow( uint windowMS );
+
+        void start();
+
+        // Write any pending changes and stop the thread
+        void stop();
+
+        // Safe to call from any thread
+        void requestSave( HNTDConfigPersistInf *owner );
+
+        uint64_t getRequestCount();
+        uint64_t getSaveCount();
+        uint64_t getFailCount();
+};
+
+#endif // __HNTD_CONFIG_PERSISTER_H__
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <strings.h>
+
+#include <sstream>
+
+#include <Poco/DeflatingStream.h>
+#include <Poco/Exception.h>
+
+#include "HNTDContentEncoder.h"
+
+HNTD_ENCODING_T
+HNTDContentEncoder::negotiate( const std::string &acceptEncoding )
+{
+    // Unlisted codings are not acceptable unless "*" says otherwise
+    double gzipQ    = -1;
+    double deflateQ = -1;
+    double anyQ     = 0;
+
+    std::string::size_type pos = 0;
+
+    while( pos < acceptEncoding.size() )
+    {
+        std::string::size_type end = acceptEncoding.find( ',', pos );
+        if( end == std::string::npos )
+            end = acceptEncoding.size();
+
+        std::string element = acceptEncoding.substr( pos, end - pos );
+        pos = end + 1;
+
+        // coding [ ";" "q=" qvalue ]
+        double q = 1;
+
+        std::string::size_type semi = element.find( ';' );
+        if( semi != std::string::npos )
+        {
+            std::string::size_type qpos = element.find( "q=", semi );
+            if( qpos != std::string::npos )
+                q = strtod( element.c_str() + qpos + 2, NULL );
+
+            element.erase( semi );
+        }
+
+        std::string::size_type first = element.find_first_not_of( " \t" );
+        if( first == std::string::npos )
+            continue;
+
+        std::string::size_type last = element.find_last_not_of( " \t" );
+        std::string coding = element.substr( first, last - first + 1 );
+
+        if( ( strcasecmp( coding.c_str(), "gzip" ) == 0 ) || ( strcasecmp( coding.c_str(), "x-gzip" ) == 0 ) )
+            gzipQ = q;
+        else if( strcasecmp( coding.c_str(), "deflate" ) == 0 )
+            deflateQ = q;
+        else if( coding == "*" )
+            anyQ = q;
+    }
+
+    if( gzipQ < 0 )
+        gzipQ = anyQ;
+
+    if( deflateQ < 0 )
+        deflateQ = anyQ;
+
+    if( ( gzipQ > 0 ) && ( gzipQ >= deflateQ ) )
+        return HNTD_ENCODING_GZIP;
+
+    if( deflateQ > 0 )
+        return HNTD_ENCODING_DEFLATE;
+
+    return HNTD_ENCODING_IDENTITY;
+}
+
+bool
+HNTDContentEncoder::encode( HNTD_ENCODING_T encoding, const std::string &body, std::string &encoded )
+{
+    // HTTP deflate is the zlib format, not a raw deflate stream
+    Poco::DeflatingStreamBuf::StreamType type;
+
+    switch( encoding )
+    {
+        case HNTD_ENCODING_GZIP:
+            type = Poco::DeflatingStreamBuf::STREAM_GZIP;
+        break;
+
+        case HNTD_ENCODING_DEFLATE:
+            type = Poco::DeflatingStreamBuf::STREAM_ZLIB;
+        break;
+
+        default:
+            return false;
+    }
+
+    std::ostringstream ostr;
+
+    try
+    {
+        Poco::DeflatingOutputStream deflater( ostr, type );
+
+        deflater.write( body.data(), body.size() );
+        deflater.close();
+    }
+    catch( Poco::Exception ex )
+    {
+        return false;
+    }
+
+    encoded = ostr.str();
+
+    return true;
+}
+
+const char*
+HNTDContentEncoder::getName( HNTD_ENCODING_T encoding )
+{
+    switch( encoding )
+    {
+        case HNTD_ENCODING_GZIP:
+            return "gzip";
+
+        case HNTD_ENCODING_DEFLATE:
+            return "deflate";
+
+        default:
+        break;
+    }
+
+    return "identity";
+}
@@ -0,0 +1,33 @@
+#ifndef __HNTD_CONTENT_ENCODER_H__
+#define __HNTD_CONTENT_ENCODER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+// Bodies smaller than this are not worth compressing
+#define HNTD_DEFAULT_COMPRESS_MIN_SIZE  1024
+
+typedef enum HNTDContentEncodingEnum
+{
+  HNTD_ENCODING_IDENTITY,
+  HNTD_ENCODING_GZIP,
+  HNTD_ENCODING_DEFLATE,
+  HNTD_ENCODING_COUNT
+}HNTD_ENCODING_T;
+
+// HTTP content-coding negotiation and compression of response bodies
+class HNTDContentEncoder
+{
+    public:
+        // Best coding an Accept-Encoding header allows, gzip on a tie
+        static HNTD_ENCODING_T negotiate( const std::string &acceptEncoding );
+
+        static bool encode( HNTD_ENCODING_T encoding, const std::string &body, std::string &encoded );
+
+        // Content-Encoding value
+        static const char* getName( HNTD_ENCODING_T encoding );
+};
+
+#endif // __HNTD_CONTENT_ENCODER_H__
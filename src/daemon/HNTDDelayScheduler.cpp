@@ -0,0 +1,107 @@
+#include "HNTDDelayScheduler.h"
+
+HNTDDelayScheduler::HNTDDelayScheduler()
+{
+    m_wheel        = NULL;
+    m_running      = false;
+    m_delayedCount = 0;
+}
+
+HNTDDelayScheduler::~HNTDDelayScheduler()
+{
+    stop();
+}
+
+void
+HNTDDelayScheduler::start( HNTDTimerWheel *wheel )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_running == true )
+        return;
+
+    m_wheel   = wheel;
+    m_running = true;
+}
+
+void
+HNTDDelayScheduler::stop()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_running == false )
+        return;
+
+    m_running = false;
+
+    std::unordered_map< HNTDTimer*, WAITER_T* >::iterator it = m_waiters.begin();
+    while( it != m_waiters.end() )
+    {
+        // A timer that is already firing releases its caller itself,
+        // the waiter must stay known until then
+        if( m_wheel->cancel( it->first ) == false )
+        {
+            it++;
+            continue;
+        }
+
+        it->second->released = true;
+        it->second->cond.notify_one();
+
+        it = m_waiters.erase( it );
+    }
+}
+
+void
+HNTDDelayScheduler::delay( uint64_t delayNS )
+{
+    WAITER_T waiter;
+    waiter.released = false;
+    waiter.timer.setCallback( this );
+
+    std::unique_lock< std::mutex > lock( m_lock );
+
+    // Nobody would release the caller
+    if( m_running == false )
+        return;
+
+    m_waiters[ &waiter.timer ] = &waiter;
+    m_delayedCount += 1;
+
+    // Round up to whole wheel ticks so the caller is never released early
+    m_wheel->arm( &waiter.timer, ( delayNS + 999999 ) / 1000000, 0 );
+
+    while( waiter.released == false )
+        waiter.cond.wait( lock );
+}
+
+void
+HNTDDelayScheduler::timerFired( HNTDTimer *timer )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    std::unordered_map< HNTDTimer*, WAITER_T* >::iterator it = m_waiters.find( timer );
+    if( it == m_waiters.end() )
+        return;
+
+    it->second->released = true;
+    it->second->cond.notify_one();
+
+    m_waiters.erase( it );
+}
+
+uint
+HNTDDelayScheduler::getWaitingCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_waiters.size();
+}
+
+uint64_t
+HNTDDelayScheduler::getDelayedCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_delayedCount;
+}
@@ -0,0 +1,62 @@
+#ifndef __HNTD_DELAY_SCHEDULER_H__
+#define __HNTD_DELAY_SCHEDULER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "HNTDTimerWheel.h"
+
+// Requests a device holds for injected latency at once, the rest get 503
+#define HNTD_DEFAULT_MAX_DELAYED 4
+
+// Holds requests back for injected latency.  Delayed callers are
+// parked on their own condition with a one-shot timer on the event
+// loop's timer wheel that releases them when due.  The caller's thread
+// is blocked for the whole delay: libhnode2 answers a request on the
+// Poco worker that received it, so each delayed request still takes
+// one REST worker.  Devices cap how many requests they delay at once
+// so the rest of the pool stays free for undelayed requests.  stop() releases every parked caller at
+// once instead of leaving them to sleep out their delay.
+class HNTDDelayScheduler : public HNTDTimerCallback
+{
+    private:
+        typedef struct WaiterStruct
+        {
+            HNTDTimer               timer;
+            std::condition_variable cond;
+            bool                    released;
+        }WAITER_T;
+
+        std::mutex m_lock;
+
+        HNTDTimerWheel *m_wheel;
+        bool m_running;
+
+        // Parked callers by their timer
+        std::unordered_map< HNTDTimer*, WAITER_T* > m_waiters;
+
+        uint64_t m_delayedCount;
+
+    public:
+        HNTDDelayScheduler();
+       ~HNTDDelayScheduler();
+
+        // The wheel must be running for as long as the scheduler is
+        void start( HNTDTimerWheel *wheel );
+        void stop();
+
+        // Block the calling request until delayNS have passed
+        void delay( uint64_t delayNS );
+
+        // Requests parked right now
+        uint getWaitingCount();
+        uint64_t getDelayedCount();
+
+        virtual void timerFired( HNTDTimer *timer );
+};
+
+#endif // __HNTD_DELAY_SCHEDULER_H__
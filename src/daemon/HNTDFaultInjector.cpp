@@ -0,0 +1,235 @@
+#include <math.h>
+
+#include <random>
+
+#include "HNTDFaultInjector.h"
+
+static const char *g_HNTDLatencyDistNames[] =
+{
+    "none",
+    "fixed",
+    "uniform",
+    "normal",
+    "exponential"
+};
+
+// Each REST thread draws from its own generator
+static thread_local std::mt19937_64 t_HNTDFaultRandom( std::random_device{}() );
+
+static double
+hntdFaultUniform()
+{
+    return std::uniform_real_distribution< double >( 0.0, 1.0 )( t_HNTDFaultRandom );
+}
+
+HNTDFaultInjector::HNTDFaultInjector( uint opCount )
+: m_active( false ), m_delayCount( 0 ), m_errorCount( 0 ), m_dropCount( 0 )
+{
+    m_opCount = opCount;
+
+    std::shared_ptr< RULE_TABLE_T > table = std::make_shared< RULE_TABLE_T >();
+    table->byOp.resize( m_opCount, -1 );
+
+    m_table = table;
+}
+
+HNTDFaultInjector::~HNTDFaultInjector()
+{
+
+}
+
+const char*
+HNTDFaultInjector::getDistName( HNTD_LATENCY_DIST_T dist )
+{
+    return g_HNTDLatencyDistNames[ dist ];
+}
+
+bool
+HNTDFaultInjector::parseDistName( const std::string &name, HNTD_LATENCY_DIST_T &dist )
+{
+    for( uint i = 0; i < ( sizeof( g_HNTDLatencyDistNames ) / sizeof( g_HNTDLatencyDistNames[0] ) ); i++ )
+    {
+        if( name == g_HNTDLatencyDistNames[i] )
+        {
+            dist = (HNTD_LATENCY_DIST_T) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HNTDFI_RESULT_T
+HNTDFaultInjector::checkRule( const HNTD_FAULT_RULE_T &rule, std::string &error )
+{
+    if( ( rule.errorRate < 0 ) || ( rule.errorRate > 1 ) || ( rule.dropRate < 0 ) || ( rule.dropRate > 1 ) )
+    {
+        error = rule.opID + ": rates must be between 0 and 1";
+        return HNTDFI_RESULT_BAD_RULE;
+    }
+
+    if( ( rule.errorStatus < 400 ) || ( rule.errorStatus > 599 ) )
+    {
+        error = rule.opID + ": errorStatus must be a 4xx or 5xx status";
+        return HNTDFI_RESULT_BAD_RULE;
+    }
+
+    const double limit = HNTD_FAULT_MAX_LATENCY_MS;
+
+    if( ( rule.latencyMinMS < 0 ) || ( rule.latencyMaxMS < 0 ) || ( rule.latencyMeanMS < 0 ) || ( rule.latencyStddevMS < 0 )
+        || ( rule.latencyMinMS > limit ) || ( rule.latencyMaxMS > limit ) || ( rule.latencyMeanMS > limit ) || ( rule.latencyStddevMS > limit ) )
+    {
+        error = rule.opID + ": latency must be between 0 and 600000 ms";
+        return HNTDFI_RESULT_BAD_RULE;
+    }
+
+    if( ( rule.latencyDist == HNTD_LATENCY_UNIFORM ) && ( rule.latencyMinMS > rule.latencyMaxMS ) )
+    {
+        error = rule.opID + ": minMs is larger than maxMs";
+        return HNTDFI_RESULT_BAD_RULE;
+    }
+
+    return HNTDFI_RESULT_SUCCESS;
+}
+
+HNTDFI_RESULT_T
+HNTDFaultInjector::setRules( const std::vector< HNTD_FAULT_RULE_T > &rules, int (*findOp)( const std::string &opID ), std::string &error )
+{
+    std::shared_ptr< RULE_TABLE_T > table = std::make_shared< RULE_TABLE_T >();
+    table->byOp.resize( m_opCount, -1 );
+
+    int wildcard = -1;
+
+    for( std::vector< HNTD_FAULT_RULE_T >::const_iterator it = rules.begin(); it != rules.end(); it++ )
+    {
+        if( checkRule( *it, error ) != HNTDFI_RESULT_SUCCESS )
+            return HNTDFI_RESULT_BAD_RULE;
+
+        int ruleIndex = table->rules.size();
+
+        if( it->opID == "*" )
+            wildcard = ruleIndex;
+        else
+        {
+            int op = findOp( it->opID );
+            if( ( op < 0 ) || ( (uint) op >= m_opCount ) )
+            {
+                error = it->opID + ": unknown operation";
+                return HNTDFI_RESULT_BAD_RULE;
+            }
+
+            table->byOp[ op ] = ruleIndex;
+        }
+
+        table->rules.push_back( *it );
+    }
+
+    // Operations without their own rule take the wildcard
+    if( wildcard >= 0 )
+    {
+        for( std::vector< int >::iterator it = table->byOp.begin(); it != table->byOp.end(); it++ )
+        {
+            if( *it < 0 )
+                *it = wildcard;
+        }
+    }
+
+    std::atomic_store( &m_table, std::shared_ptr< const RULE_TABLE_T >( table ) );
+    m_active.store( table->rules.empty() == false );
+
+    return HNTDFI_RESULT_SUCCESS;
+}
+
+void
+HNTDFaultInjector::getRules( std::vector< HNTD_FAULT_RULE_T > &rules )
+{
+    std::shared_ptr< const RULE_TABLE_T > table = std::atomic_load( &m_table );
+
+    rules = table->rules;
+}
+
+uint64_t
+HNTDFaultInjector::sampleDelayNS( const HNTD_FAULT_RULE_T &rule )
+{
+    double ms = 0;
+
+    switch( rule.latencyDist )
+    {
+        case HNTD_LATENCY_NONE:
+            return 0;
+
+        case HNTD_LATENCY_FIXED:
+            ms = rule.latencyMeanMS;
+        break;
+
+        case HNTD_LATENCY_UNIFORM:
+            ms = rule.latencyMinMS + ( ( rule.latencyMaxMS - rule.latencyMinMS ) * hntdFaultUniform() );
+        break;
+
+        case HNTD_LATENCY_NORMAL:
+            ms = std::normal_distribution< double >( rule.latencyMeanMS, rule.latencyStddevMS )( t_HNTDFaultRandom );
+        break;
+
+        case HNTD_LATENCY_EXPONENTIAL:
+            if( rule.latencyMeanMS > 0 )
+                ms = std::exponential_distribution< double >( 1.0 / rule.latencyMeanMS )( t_HNTDFaultRandom );
+        break;
+    }
+
+    // The long tails are cut at the rule limit
+    ms = fmin( fmax( ms, 0.0 ), (double) HNTD_FAULT_MAX_LATENCY_MS );
+
+    return (uint64_t)( ms * 1000000.0 );
+}
+
+void
+HNTDFaultInjector::decide( uint opIndex, HNTD_FAULT_DECISION_T &decision )
+{
+    decision.delayNS     = 0;
+    decision.errorStatus = 0;
+    decision.drop        = false;
+
+    if( m_active.load( std::memory_order_relaxed ) == false )
+        return;
+
+    std::shared_ptr< const RULE_TABLE_T > table = std::atomic_load( &m_table );
+
+    if( ( opIndex >= table->byOp.size() ) || ( table->byOp[ opIndex ] < 0 ) )
+        return;
+
+    const HNTD_FAULT_RULE_T &rule = table->rules[ table->byOp[ opIndex ] ];
+
+    decision.delayNS = sampleDelayNS( rule );
+    if( decision.delayNS > 0 )
+        m_delayCount.fetch_add( 1, std::memory_order_relaxed );
+
+    // A dropped request is never also answered with an error
+    if( ( rule.dropRate > 0 ) && ( hntdFaultUniform() < rule.dropRate ) )
+    {
+        decision.drop = true;
+        m_dropCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else if( ( rule.errorRate > 0 ) && ( hntdFaultUniform() < rule.errorRate ) )
+    {
+        decision.errorStatus = rule.errorStatus;
+        m_errorCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+uint64_t
+HNTDFaultInjector::getDelayCount()
+{
+    return m_delayCount.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDFaultInjector::getErrorCount()
+{
+    return m_errorCount.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDFaultInjector::getDropCount()
+{
+    return m_dropCount.load( std::memory_order_relaxed );
+}
@@ -0,0 +1,104 @@
+#ifndef __HNTD_FAULT_INJECTOR_H__
+#define __HNTD_FAULT_INJECTOR_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// Longest latency a rule may inject
+#define HNTD_FAULT_MAX_LATENCY_MS  600000
+
+typedef enum HNTDFaultInjectorResultEnum
+{
+  HNTDFI_RESULT_SUCCESS,
+  HNTDFI_RESULT_BAD_RULE
+}HNTDFI_RESULT_T;
+
+typedef enum HNTDLatencyDistEnum
+{
+  HNTD_LATENCY_NONE,
+  HNTD_LATENCY_FIXED,
+  HNTD_LATENCY_UNIFORM,
+  HNTD_LATENCY_NORMAL,
+  HNTD_LATENCY_EXPONENTIAL
+}HNTD_LATENCY_DIST_T;
+
+// Faults for one operationId, or for every operation without a
+// rule of its own when opID is "*".  Latency parameters are in ms:
+// fixed uses mean, uniform min and max, normal mean and stddev
+// and exponential mean.
+typedef struct HNTDFaultRuleStruct
+{
+    std::string         opID;
+
+    HNTD_LATENCY_DIST_T latencyDist = HNTD_LATENCY_NONE;
+    double              latencyMinMS = 0;
+    double              latencyMaxMS = 0;
+    double              latencyMeanMS = 0;
+    double              latencyStddevMS = 0;
+
+    // Probabilities from 0 to 1
+    double              errorRate = 0;
+    uint                errorStatus = 503;
+    double              dropRate = 0;
+}HNTD_FAULT_RULE_T;
+
+// What to do to one request
+typedef struct HNTDFaultDecisionStruct
+{
+    uint64_t delayNS;
+    uint     errorStatus;   // 0 to run the handler
+    bool     drop;
+}HNTD_FAULT_DECISION_T;
+
+// Per operation latency, error and connection drop injection.  The
+// rule set is replaced as a whole and read without locking, so an
+// operation without faults costs one atomic load per request.
+class HNTDFaultInjector
+{
+    private:
+        typedef struct RuleTableStruct
+        {
+            std::vector< HNTD_FAULT_RULE_T > rules;
+
+            // Rule index per operation index, -1 for none
+            std::vector< int > byOp;
+        }RULE_TABLE_T;
+
+        uint m_opCount;
+
+        std::shared_ptr< const RULE_TABLE_T > m_table;
+        std::atomic< bool > m_active;
+
+        std::atomic< uint64_t > m_delayCount;
+        std::atomic< uint64_t > m_errorCount;
+        std::atomic< uint64_t > m_dropCount;
+
+        static HNTDFI_RESULT_T checkRule( const HNTD_FAULT_RULE_T &rule, std::string &error );
+        static uint64_t sampleDelayNS( const HNTD_FAULT_RULE_T &rule );
+
+    public:
+        HNTDFaultInjector( uint opCount );
+       ~HNTDFaultInjector();
+
+        // Replace every rule, operations are named by their opID and
+        // findOp gives their index, or -1 if there is no such operation
+        HNTDFI_RESULT_T setRules( const std::vector< HNTD_FAULT_RULE_T > &rules, int (*findOp)( const std::string &opID ), std::string &error );
+        void getRules( std::vector< HNTD_FAULT_RULE_T > &rules );
+
+        // Draw the faults for one request to an operation
+        void decide( uint opIndex, HNTD_FAULT_DECISION_T &decision );
+
+        static const char* getDistName( HNTD_LATENCY_DIST_T dist );
+        static bool parseDistName( const std::string &name, HNTD_LATENCY_DIST_T &dist );
+
+        uint64_t getDelayCount();
+        uint64_t getErrorCount();
+        uint64_t getDropCount();
+};
+
+#endif // __HNTD_FAULT_INJECTOR_H__
@@ -0,0 +1,290 @@
+#include <time.h>
+
+#include <mutex>
+
+#include "HNTDHealthHistory.h"
+
+static const char *g_HNTDHHStatusNames[] = { "OK", "FAILED", "UNKNOWN", "NOTE", "" };
+
+HNTDHealthHistory::HNTDHealthHistory()
+{
+    m_mask         = 0;
+    m_lastSeq      = 0;
+    m_lastTime     = 0;
+    m_maxComponent = 0;
+}
+
+HNTDHealthHistory::~HNTDHealthHistory()
+{
+
+}
+
+void
+HNTDHealthHistory::setCapacity( uint64_t capacity )
+{
+    std::unique_lock< std::shared_mutex > lock( m_lock );
+
+    uint64_t size = 0;
+    if( capacity > 0 )
+    {
+        size = 1;
+        while( size < capacity )
+            size <<= 1;
+    }
+
+    m_times.assign( size, 0 );
+    m_components.assign( size, 0 );
+    m_errCodes.assign( size, 0 );
+    m_statuses.assign( size, 0 );
+
+    m_mask         = ( size > 0 ) ? ( size - 1 ) : 0;
+    m_lastSeq      = 0;
+    m_lastTime     = 0;
+    m_maxComponent = 0;
+}
+
+uint64_t
+HNTDHealthHistory::getCapacity()
+{
+    std::shared_lock< std::shared_mutex > lock( m_lock );
+
+    return m_times.size();
+}
+
+uint64_t
+HNTDHealthHistory::getNowUS()
+{
+    struct timespec now;
+    clock_gettime( CLOCK_REALTIME, &now );
+
+    return ( (uint64_t) now.tv_sec * 1000000ULL ) + ( now.tv_nsec / 1000 );
+}
+
+void
+HNTDHealthHistory::record( uint32_t component, HNTD_HH_STATUS_T status, uint errCode )
+{
+    uint64_t now = getNowUS();
+
+    std::unique_lock< std::shared_mutex > lock( m_lock );
+
+    if( m_times.empty() )
+        return;
+
+    if( now < m_lastTime )
+        now = m_lastTime;
+
+    m_lastSeq += 1;
+    m_lastTime = now;
+
+    uint64_t slot = m_lastSeq & m_mask;
+
+    m_times[ slot ]      = now;
+    m_components[ slot ] = component;
+    m_errCodes[ slot ]   = ( errCode > 0xFFFF ) ? 0xFFFF : errCode;
+    m_statuses[ slot ]   = status;
+
+    if( ( component != HNTD_HEALTH_HISTORY_ROOT ) && ( component > m_maxComponent ) )
+        m_maxComponent = component;
+}
+
+uint64_t
+HNTDHealthHistory::getFirstSeq()
+{
+    if( m_lastSeq == 0 )
+        return 1;
+
+    return ( m_lastSeq > m_times.size() ) ? ( m_lastSeq - m_times.size() + 1 ) : 1;
+}
+
+// First retained sequence with a time at or after timeUS, one past
+// the newest if there is none.
+uint64_t
+HNTDHealthHistory::findTime( uint64_t timeUS )
+{
+    uint64_t low  = getFirstSeq();
+    uint64_t high = m_lastSeq + 1;
+
+    while( low < high )
+    {
+        uint64_t mid = low + ( ( high - low ) / 2 );
+
+        if( m_times[ mid & m_mask ] < timeUS )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+void
+HNTDHealthHistory::getRange( uint64_t startUS, uint64_t endUS, uint64_t since, bool hasComponent, uint32_t component, size_t max, std::vector< HNTD_HEALTH_TRANSITION_T > &transitions, bool &more )
+{
+    transitions.clear();
+    more = false;
+
+    std::shared_lock< std::shared_mutex > lock( m_lock );
+
+    if( ( m_lastSeq == 0 ) || ( startUS >= endUS ) )
+        return;
+
+    uint64_t seq = findTime( startUS );
+    uint64_t end = findTime( endUS );
+
+    if( seq < since )
+        seq = since;
+
+    for( ; seq < end; seq++ )
+    {
+        uint64_t slot = seq & m_mask;
+
+        if( ( hasComponent == true ) && ( m_components[ slot ] != component ) )
+            continue;
+
+        if( transitions.size() == max )
+        {
+            more = true;
+            break;
+        }
+
+        HNTD_HEALTH_TRANSITION_T transition;
+        transition.seq       = seq;
+        transition.timeUS    = m_times[ slot ];
+        transition.component = m_components[ slot ];
+        transition.status    = (HNTD_HH_STATUS_T) m_statuses[ slot ];
+        transition.errCode   = m_errCodes[ slot ];
+
+        transitions.push_back( transition );
+    }
+}
+
+bool
+HNTDHealthHistory::downsample( uint64_t startUS, uint64_t bucketUS, uint bucketCount, bool hasComponent, uint32_t component, uint64_t maxCells, std::vector< HNTD_HEALTH_BUCKETS_T > &components )
+{
+    components.clear();
+
+    if( ( bucketUS == 0 ) || ( bucketCount == 0 ) )
+        return true;
+
+    // Components that fit in the budget
+    uint64_t maxComponents = maxCells / bucketCount;
+
+    // Clamp rather than wrap a span that runs past the end of time
+    uint64_t endUS = UINT64_MAX;
+    if( bucketUS <= ( ( UINT64_MAX - startUS ) / bucketCount ) )
+        endUS = startUS + ( bucketUS * bucketCount );
+
+    std::shared_lock< std::shared_mutex > lock( m_lock );
+
+    if( m_lastSeq == 0 )
+        return true;
+
+    uint64_t seq = findTime( startUS );
+    uint64_t end = findTime( endUS );
+
+    // Position in components of each component seen, the root takes
+    // slot 0 and table index i slot i + 1.  Dense so the scan never hashes,
+    // and not needed at all for one component.
+    std::vector< int32_t > slots( ( hasComponent == true ) ? 0 : ( (size_t) m_maxComponent + 2 ), -1 );
+
+    // Times are in order, so the bucket only ever moves forward
+    uint     bucket    = 0;
+    uint64_t bucketEnd = startUS + bucketUS;
+
+    for( ; seq < end; seq++ )
+    {
+        uint64_t ringSlot = seq & m_mask;
+        uint32_t seen     = m_components[ ringSlot ];
+        size_t   position = 0;
+
+        if( hasComponent == true )
+        {
+            if( seen != component )
+                continue;
+        }
+        else
+        {
+            size_t index = ( seen == HNTD_HEALTH_HISTORY_ROOT ) ? 0 : ( (size_t) seen + 1 );
+
+            if( slots[ index ] < 0 )
+                slots[ index ] = components.size();
+
+            position = slots[ index ];
+        }
+
+        if( position == components.size() )
+        {
+            if( components.size() >= maxComponents )
+            {
+                components.clear();
+                return false;
+            }
+
+            components.emplace_back();
+            components.back().component = seen;
+            components.back().transitions.resize( bucketCount, 0 );
+            components.back().failures.resize( bucketCount, 0 );
+            components.back().status.resize( bucketCount, HNTD_HH_STATUS_NONE );
+        }
+
+        if( m_times[ ringSlot ] >= bucketEnd )
+        {
+            bucket    = ( m_times[ ringSlot ] - startUS ) / bucketUS;
+            bucketEnd = startUS + ( ( (uint64_t) bucket + 1 ) * bucketUS );
+        }
+
+        HNTD_HEALTH_BUCKETS_T &buckets = components[ position ];
+        HNTD_HH_STATUS_T status = (HNTD_HH_STATUS_T) m_statuses[ ringSlot ];
+
+        buckets.transitions[ bucket ] += 1;
+        if( status == HNTD_HH_STATUS_FAILED )
+            buckets.failures[ bucket ] += 1;
+
+        buckets.status[ bucket ] = status;
+    }
+
+    // A bucket without transitions ends in the status of the one before
+    for( std::vector< HNTD_HEALTH_BUCKETS_T >::iterator it = components.begin(); it != components.end(); it++ )
+    {
+        for( uint i = 1; i < bucketCount; i++ )
+        {
+            if( it->status[i] == HNTD_HH_STATUS_NONE )
+                it->status[i] = it->status[ i - 1 ];
+        }
+    }
+
+    return true;
+}
+
+void
+HNTDHealthHistory::getSeqRange( uint64_t &firstSeq, uint64_t &lastSeq )
+{
+    std::shared_lock< std::shared_mutex > lock( m_lock );
+
+    firstSeq = ( m_lastSeq == 0 ) ? 0 : getFirstSeq();
+    lastSeq  = m_lastSeq;
+}
+
+const char*
+HNTDHealthHistory::getStatusName( HNTD_HH_STATUS_T status )
+{
+    if( status > HNTD_HH_STATUS_NONE )
+        return "";
+
+    return g_HNTDHHStatusNames[ status ];
+}
+
+bool
+HNTDHealthHistory::parseStatusName( const std::string &name, HNTD_HH_STATUS_T &status )
+{
+    for( uint i = 0; i < HNTD_HH_STATUS_NONE; i++ )
+    {
+        if( name == g_HNTDHHStatusNames[i] )
+        {
+            status = (HNTD_HH_STATUS_T) i;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,106 @@
+#ifndef __HNTD_HEALTH_HISTORY_H__
+#define __HNTD_HEALTH_HISTORY_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+
+#define HNTD_DEFAULT_HEALTH_HISTORY_SIZE  262144
+
+// Component index recorded for the root component
+#define HNTD_HEALTH_HISTORY_ROOT  0xFFFFFFFF
+
+typedef enum HNTDHealthHistoryStatusEnum
+{
+  HNTD_HH_STATUS_OK,
+  HNTD_HH_STATUS_FAILED,
+  HNTD_HH_STATUS_UNKNOWN,
+  HNTD_HH_STATUS_NOTE,
+  HNTD_HH_STATUS_NONE      // No transition yet, only in downsampled results
+}HNTD_HH_STATUS_T;
+
+// One recorded transition.  Time is microseconds since the epoch,
+// component the health table index or HNTD_HEALTH_HISTORY_ROOT.
+typedef struct HNTDHealthTransitionStruct
+{
+    uint64_t         seq;
+    uint64_t         timeUS;
+    uint32_t         component;
+    HNTD_HH_STATUS_T status;
+    uint             errCode;
+}HNTD_HEALTH_TRANSITION_T;
+
+// Transitions of one component counted into equal time buckets.
+// status is the component's status at the end of each bucket, as far
+// as the range shows.
+typedef struct HNTDHealthBucketsStruct
+{
+    uint32_t                        component;
+    std::vector< uint32_t >         transitions;
+    std::vector< uint32_t >         failures;
+    std::vector< HNTD_HH_STATUS_T > status;
+}HNTD_HEALTH_BUCKETS_T;
+
+// Fixed size ring of the latest health transitions, numbered by a
+// sequence that starts at 1.  The fields are kept in separate columns
+// so a range scan only reads the columns it needs, about 15 bytes per
+// transition in all.  Times never go backwards, a wall clock step back
+// repeats the last time, so a time range is found by binary search.
+class HNTDHealthHistory
+{
+    private:
+        std::shared_mutex m_lock;
+
+        std::vector< uint64_t > m_times;
+        std::vector< uint32_t > m_components;
+        std::vector< uint16_t > m_errCodes;
+        std::vector< uint8_t >  m_statuses;
+
+        uint64_t m_mask;
+        uint64_t m_lastSeq;
+        uint64_t m_lastTime;
+
+        // Largest component index recorded, sizes the downsample slots
+        uint32_t m_maxComponent;
+
+        // Callers hold m_lock for the following.
+        uint64_t getFirstSeq();
+        uint64_t findTime( uint64_t timeUS );
+
+    public:
+        HNTDHealthHistory();
+       ~HNTDHealthHistory();
+
+        // Rounded up to a power of two, 0 turns recording off.  Drops
+        // every transition, only meant for setup.
+        void setCapacity( uint64_t capacity );
+        uint64_t getCapacity();
+
+        void record( uint32_t component, HNTD_HH_STATUS_T status, uint errCode );
+
+        // Up to max transitions from startUS up to but not including
+        // endUS, with a sequence of at least since, oldest first.  With
+        // hasComponent set only that component's.  more is set if the
+        // range holds transitions past the last one returned.
+        void getRange( uint64_t startUS, uint64_t endUS, uint64_t since, bool hasComponent, uint32_t component, size_t max, std::vector< HNTD_HEALTH_TRANSITION_T > &transitions, bool &more );
+
+        // Per component counts over bucketCount buckets of bucketUS
+        // starting at startUS, for the components with transitions in
+        // that span, or only the one component with hasComponent set.
+        // Returns false with nothing counted if the components found
+        // would need more than maxCells buckets in all.
+        bool downsample( uint64_t startUS, uint64_t bucketUS, uint bucketCount, bool hasComponent, uint32_t component, uint64_t maxCells, std::vector< HNTD_HEALTH_BUCKETS_T > &components );
+
+        // Oldest retained and newest sequence, 0 when empty
+        void getSeqRange( uint64_t &firstSeq, uint64_t &lastSeq );
+
+        static uint64_t getNowUS();
+
+        static const char* getStatusName( HNTD_HH_STATUS_T status );
+        static bool parseStatusName( const std::string &name, HNTD_HH_STATUS_T &status );
+};
+
+#endif // __HNTD_HEALTH_HISTORY_H__
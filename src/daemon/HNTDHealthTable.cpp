@@ -0,0 +1,176 @@
+#include "HNTDHealthTable.h"
+
+#define HNTD_HEALTH_NAME_PREFIX  "test device hc"
+
+HNTDHealthTable::HNTDHealthTable()
+{
+
+}
+
+HNTDHealthTable::~HNTDHealthTable()
+{
+
+}
+
+void
+HNTDHealthTable::clear()
+{
+    m_names.clear();
+    m_ids.clear();
+    m_parents.clear();
+    m_failed.clear();
+    m_nameIndex.clear();
+    m_idIndex.clear();
+}
+
+uint32_t
+HNTDHealthTable::add( const std::string &name, uint32_t parent )
+{
+    uint32_t index = m_names.size();
+
+    m_names.push_back( name );
+    m_ids.push_back( std::string() );
+    m_parents.push_back( parent );
+    m_failed.push_back( 0 );
+
+    m_nameIndex[ name ] = index;
+
+    return index;
+}
+
+void
+HNTDHealthTable::buildDefault()
+{
+    clear();
+
+    add( HNTD_HEALTH_NAME_PREFIX "1", HNTD_HEALTH_NO_PARENT );
+    uint32_t hc2 = add( HNTD_HEALTH_NAME_PREFIX "2", HNTD_HEALTH_NO_PARENT );
+    add( HNTD_HEALTH_NAME_PREFIX "2.1", hc2 );
+}
+
+uint64_t
+HNTDHealthTable::getTreeSize( uint fanout, uint depth )
+{
+    uint64_t total = 0;
+    uint64_t level = 1;
+
+    for( uint d = 0; d < depth; d++ )
+    {
+        level *= fanout;
+        total += level;
+
+        // Only needs to be accurate up to the limit
+        if( total > HNTD_HEALTH_TABLE_MAX )
+            return total;
+    }
+
+    return total;
+}
+
+HNTDHT_RESULT_T
+HNTDHealthTable::buildTree( uint fanout, uint depth )
+{
+    if( ( fanout == 0 ) || ( depth == 0 ) )
+        return HNTDHT_RESULT_FAILURE;
+
+    uint64_t total = getTreeSize( fanout, depth );
+    if( total > HNTD_HEALTH_TABLE_MAX )
+        return HNTDHT_RESULT_TOO_LARGE;
+
+    clear();
+
+    m_names.reserve( total );
+    m_ids.reserve( total );
+    m_parents.reserve( total );
+    m_failed.reserve( total );
+    m_nameIndex.reserve( total );
+    m_idIndex.reserve( total );
+
+    // Top level nodes hang off the device root
+    for( uint c = 1; c <= fanout; c++ )
+        add( HNTD_HEALTH_NAME_PREFIX + std::to_string( c ), HNTD_HEALTH_NO_PARENT );
+
+    // Each following level expands the one before it
+    uint32_t levelStart = 0;
+    for( uint d = 1; d < depth; d++ )
+    {
+        uint32_t levelEnd = m_names.size();
+
+        for( uint32_t parent = levelStart; parent < levelEnd; parent++ )
+        {
+            for( uint c = 1; c <= fanout; c++ )
+                add( m_names[ parent ] + "." + std::to_string( c ), parent );
+        }
+
+        levelStart = levelEnd;
+    }
+
+    return HNTDHT_RESULT_SUCCESS;
+}
+
+uint
+HNTDHealthTable::size()
+{
+    return m_names.size();
+}
+
+const std::string&
+HNTDHealthTable::getName( uint32_t index )
+{
+    return m_names[ index ];
+}
+
+const std::string&
+HNTDHealthTable::getID( uint32_t index )
+{
+    return m_ids[ index ];
+}
+
+uint32_t
+HNTDHealthTable::getParent( uint32_t index )
+{
+    return m_parents[ index ];
+}
+
+void
+HNTDHealthTable::setID( uint32_t index, const std::string &compID )
+{
+    m_ids[ index ] = compID;
+    m_idIndex[ compID ] = index;
+}
+
+bool
+HNTDHealthTable::findByID( const std::string &compID, uint32_t &index )
+{
+    std::unordered_map< std::string, uint32_t >::iterator it = m_idIndex.find( compID );
+
+    if( it == m_idIndex.end() )
+        return false;
+
+    index = it->second;
+    return true;
+}
+
+bool
+HNTDHealthTable::findByName( const std::string &name, uint32_t &index )
+{
+    std::unordered_map< std::string, uint32_t >::iterator it = m_nameIndex.find( name );
+
+    if( it == m_nameIndex.end() )
+        return false;
+
+    index = it->second;
+    return true;
+}
+
+bool
+HNTDHealthTable::isFailed( uint32_t index )
+{
+    return ( m_failed[ index ] != 0 );
+}
+
+void
+HNTDHealthTable::setFailed( uint32_t index, bool failed )
+{
+    m_failed[ index ] = failed ? 1 : 0;
+}
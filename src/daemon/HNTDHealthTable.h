@@ -0,0 +1,69 @@
+#ifndef __HNTD_HEALTH_TABLE_H__
+#define __HNTD_HEALTH_TABLE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define HNTD_HEALTH_NO_PARENT    0xFFFFFFFF
+
+// Largest synthetic tree that will be generated
+#define HNTD_HEALTH_TABLE_MAX    65536
+
+typedef enum HNTDHealthTableResultEnum
+{
+  HNTDHT_RESULT_SUCCESS,
+  HNTDHT_RESULT_FAILURE,
+  HNTDHT_RESULT_TOO_LARGE
+}HNTDHT_RESULT_T;
+
+// The device's health components, addressed by a dense index.  Names
+// and parents are filled in first, the component ids are assigned as
+// each entry is registered with the device health.  Entries are in
+// breadth first order so a parent always precedes its children.
+class HNTDHealthTable
+{
+    private:
+        std::vector< std::string > m_names;
+        std::vector< std::string > m_ids;
+        std::vector< uint32_t >    m_parents;
+        std::vector< uint8_t >     m_failed;
+
+        std::unordered_map< std::string, uint32_t > m_nameIndex;
+        std::unordered_map< std::string, uint32_t > m_idIndex;
+
+        uint32_t add( const std::string &name, uint32_t parent );
+
+    public:
+        HNTDHealthTable();
+       ~HNTDHealthTable();
+
+        void clear();
+
+        // The original three node tree: hc1, hc2 and hc2.1
+        void buildDefault();
+
+        // fanout children per node, depth levels below the root
+        HNTDHT_RESULT_T buildTree( uint fanout, uint depth );
+
+        static uint64_t getTreeSize( uint fanout, uint depth );
+
+        uint size();
+
+        const std::string& getName( uint32_t index );
+        const std::string& getID( uint32_t index );
+        uint32_t getParent( uint32_t index );
+
+        void setID( uint32_t index, const std::string &compID );
+
+        bool findByName( const std::string &name, uint32_t &index );
+        bool findByID( const std::string &compID, uint32_t &index );
+
+        bool isFailed( uint32_t index );
+        void setFailed( uint32_t index, bool failed );
+};
+
+#endif // __HNTD_HEALTH_TABLE_H__
@@ -0,0 +1,159 @@
+#include "HNTDHistogram.h"
+
+HNTDHistogram::HNTDHistogram()
+{
+    reset();
+}
+
+HNTDHistogram::~HNTDHistogram()
+{
+
+}
+
+uint
+HNTDHistogram::bucketIndex( uint64_t value )
+{
+    if( value < ( 2 * SUB_COUNT ) )
+        return value;
+
+    if( value >= ( 1ULL << MAX_BITS ) )
+        return BUCKET_COUNT - 1;
+
+    uint msb   = 63 - __builtin_clzll( value );
+    uint shift = msb - SUB_BITS;
+
+    return ( ( shift + 1 ) * SUB_COUNT ) + ( ( value >> shift ) - SUB_COUNT );
+}
+
+uint64_t
+HNTDHistogram::bucketUpperBound( uint index )
+{
+    if( index < ( 2 * SUB_COUNT ) )
+        return index;
+
+    uint shift = ( index / SUB_COUNT ) - 1;
+    uint64_t sub = SUB_COUNT + ( index % SUB_COUNT );
+
+    return ( ( sub + 1 ) << shift ) - 1;
+}
+
+void
+HNTDHistogram::record( uint64_t value )
+{
+    std::atomic< uint64_t > &bucket = m_buckets[ bucketIndex( value ) ];
+
+    bucket.store( bucket.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+    m_count.store( m_count.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    m_total.store( m_total.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+
+    if( value < m_min.load( std::memory_order_relaxed ) )
+        m_min.store( value, std::memory_order_relaxed );
+
+    if( value > m_max.load( std::memory_order_relaxed ) )
+        m_max.store( value, std::memory_order_relaxed );
+}
+
+void
+HNTDHistogram::reset()
+{
+    for( uint i = 0; i < BUCKET_COUNT; i++ )
+        m_buckets[i].store( 0, std::memory_order_relaxed );
+
+    m_count.store( 0, std::memory_order_relaxed );
+    m_total.store( 0, std::memory_order_relaxed );
+    m_min.store( UINT64_MAX, std::memory_order_relaxed );
+    m_max.store( 0, std::memory_order_relaxed );
+}
+
+void
+HNTDHistogram::merge( const HNTDHistogram &other )
+{
+    for( uint i = 0; i < BUCKET_COUNT; i++ )
+    {
+        uint64_t cnt = other.m_buckets[i].load( std::memory_order_relaxed );
+
+        if( cnt != 0 )
+            m_buckets[i].store( m_buckets[i].load( std::memory_order_relaxed ) + cnt, std::memory_order_relaxed );
+    }
+
+    m_count.store( m_count.load( std::memory_order_relaxed ) + other.m_count.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    m_total.store( m_total.load( std::memory_order_relaxed ) + other.m_total.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+
+    if( other.m_min.load( std::memory_order_relaxed ) < m_min.load( std::memory_order_relaxed ) )
+        m_min.store( other.m_min.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+
+    if( other.m_max.load( std::memory_order_relaxed ) > m_max.load( std::memory_order_relaxed ) )
+        m_max.store( other.m_max.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDHistogram::getCount() const
+{
+    return m_count.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDHistogram::getMin() const
+{
+    return ( getCount() == 0 ) ? 0 : m_min.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDHistogram::getMax() const
+{
+    return m_max.load( std::memory_order_relaxed );
+}
+
+double
+HNTDHistogram::getMean() const
+{
+    uint64_t count = getCount();
+
+    if( count == 0 )
+        return 0;
+
+    return (double) m_total.load( std::memory_order_relaxed ) / (double) count;
+}
+
+uint64_t
+HNTDHistogram::getPercentile( double percent ) const
+{
+    // Sum the buckets rather than trusting m_count, a concurrent
+    // writer may have advanced one but not yet the other.
+    uint64_t total = 0;
+    for( uint i = 0; i < BUCKET_COUNT; i++ )
+        total += m_buckets[i].load( std::memory_order_relaxed );
+
+    if( total == 0 )
+        return 0;
+
+    uint64_t target = (uint64_t)( ( percent / 100.0 ) * (double) total + 0.5 );
+    if( target == 0 )
+        target = 1;
+
+    uint64_t seen = 0;
+    for( uint i = 0; i < BUCKET_COUNT; i++ )
+    {
+        seen += m_buckets[i].load( std::memory_order_relaxed );
+
+        if( seen >= target )
+        {
+            // Never report beyond the largest value actually seen
+            uint64_t bound = bucketUpperBound( i );
+            uint64_t max   = getMax();
+            return ( bound < max ) ? bound : max;
+        }
+    }
+
+    return getMax();
+}
+
+uint64_t
+HNTDHistogram::getBucketCount( uint index ) const
+{
+    if( index >= BUCKET_COUNT )
+        return 0;
+
+    return m_buckets[ index ].load( std::memory_order_relaxed );
+}
@@ -0,0 +1,61 @@
+#ifndef __HNTD_HISTOGRAM_H__
+#define __HNTD_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+
+// Log-linear (HDR style) latency histogram.  Values below 64 get
+// their own bucket, above that each power of two is split into 32
+// sub-buckets, which bounds the relative error to ~3%.  Values
+// above 2^36 (~68s when recording nanoseconds) are clamped.
+//
+// A histogram has a single writer, record() is a relaxed load and
+// store per counter rather than an atomic add, while any number
+// of readers can merge() a consistent-enough copy concurrently.
+class HNTDHistogram
+{
+    public:
+        static const uint SUB_BITS     = 5;
+        static const uint SUB_COUNT    = ( 1 << SUB_BITS );
+        static const uint MAX_BITS     = 36;
+        static const uint BUCKET_COUNT = ( MAX_BITS - SUB_BITS + 1 ) * SUB_COUNT;
+
+    private:
+        std::atomic< uint64_t > m_buckets[ BUCKET_COUNT ];
+
+        std::atomic< uint64_t > m_count;
+        std::atomic< uint64_t > m_total;
+        std::atomic< uint64_t > m_min;
+        std::atomic< uint64_t > m_max;
+
+    public:
+        static uint bucketIndex( uint64_t value );
+        static uint64_t bucketUpperBound( uint index );
+
+        HNTDHistogram();
+       ~HNTDHistogram();
+
+        // Single writer only
+        void record( uint64_t value );
+
+        void reset();
+
+        // Add the counts of another histogram into this one,
+        // the destination must not be written concurrently.
+        void merge( const HNTDHistogram &other );
+
+        uint64_t getCount() const;
+        uint64_t getMin() const;
+        uint64_t getMax() const;
+        double   getMean() const;
+
+        // Value at or below which the given percent (0-100) of
+        // recorded values fall, reported as the bucket upper bound.
+        uint64_t getPercentile( double percent ) const;
+
+        uint64_t getBucketCount( uint index ) const;
+};
+
+#endif // __HNTD_HISTOGRAM_H__
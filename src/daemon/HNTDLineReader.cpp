@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "HNTDLineReader.h"
+
+#define HNTD_LINE_BLOCK_SIZE  65536
+
+// Per thread buffers shared by every reader created on the thread
+static thread_local char        t_HNTDLineBlock[ HNTD_LINE_BLOCK_SIZE ];
+static thread_local std::string t_HNTDLineBuffer;
+
+HNTDLineReader::HNTDLineReader( std::istream &stream, uint maxLine )
+: m_stream( stream ), m_line( t_HNTDLineBuffer )
+{
+    m_maxLine    = maxLine;
+    m_lineNumber = 0;
+    m_block      = t_HNTDLineBlock;
+    m_blockPos   = 0;
+    m_blockLen   = 0;
+    m_eof        = false;
+
+    m_line.clear();
+}
+
+HNTDLineReader::~HNTDLineReader()
+{
+    // Don't hold on to a very long line between requests
+    if( m_line.capacity() > m_maxLine )
+        std::string().swap( m_line );
+}
+
+bool
+HNTDLineReader::fill()
+{
+    if( m_eof )
+        return false;
+
+    m_stream.read( m_block, HNTD_LINE_BLOCK_SIZE );
+
+    m_blockPos = 0;
+    m_blockLen = m_stream.gcount();
+
+    if( m_blockLen == 0 )
+    {
+        m_eof = true;
+        return false;
+    }
+
+    return true;
+}
+
+HNTDLR_RESULT_T
+HNTDLineReader::next()
+{
+    bool tooLong = false;
+
+    m_line.clear();
+
+    while( true )
+    {
+        if( ( m_blockPos == m_blockLen ) && ( fill() == false ) )
+        {
+            // A final line without a terminator still counts
+            if( ( m_line.empty() == false ) || tooLong )
+                break;
+
+            return HNTDLR_RESULT_END;
+        }
+
+        const char *start = m_block + m_blockPos;
+        const char *end   = m_block + m_blockLen;
+        const char *nl    = (const char *) memchr( start, '\n', end - start );
+
+        const char *stop = ( nl != NULL ) ? nl : end;
+        m_blockPos = ( nl != NULL ) ? ( ( nl - m_block ) + 1 ) : m_blockLen;
+
+        if( tooLong == false )
+        {
+            if( ( m_line.size() + ( stop - start ) ) > m_maxLine )
+            {
+                tooLong = true;
+                m_line.clear();
+            }
+            else
+                m_line.append( start, stop - start );
+        }
+
+        if( nl != NULL )
+            break;
+    }
+
+    m_lineNumber += 1;
+
+    if( tooLong )
+        return HNTDLR_RESULT_TOO_LONG;
+
+    if( ( m_line.empty() == false ) && ( m_line.back() == '\r' ) )
+        m_line.pop_back();
+
+    return HNTDLR_RESULT_LINE;
+}
+
+const std::string&
+HNTDLineReader::getLine()
+{
+    return m_line;
+}
+
+uint
+HNTDLineReader::getLineNumber()
+{
+    return m_lineNumber;
+}
@@ -0,0 +1,56 @@
+#ifndef __HNTD_LINE_READER_H__
+#define __HNTD_LINE_READER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <istream>
+
+typedef enum HNTDLineReaderResultEnum
+{
+  HNTDLR_RESULT_LINE,
+  HNTDLR_RESULT_TOO_LONG,
+  HNTDLR_RESULT_END
+}HNTDLR_RESULT_T;
+
+// Splits a stream into lines, for newline delimited request bodies.
+// The stream is read in fixed size blocks and each line is assembled
+// in a string whose capacity is kept, both buffers belong to the
+// calling thread and are reused by every reader on it, so memory use
+// is bounded by the longest allowed line no matter how large the
+// body is.
+class HNTDLineReader
+{
+    private:
+        std::istream &m_stream;
+
+        uint m_maxLine;
+        uint m_lineNumber;
+
+        std::string &m_line;
+
+        char *m_block;
+        uint  m_blockPos;
+        uint  m_blockLen;
+
+        bool m_eof;
+
+        bool fill();
+
+    public:
+        HNTDLineReader( std::istream &stream, uint maxLine );
+       ~HNTDLineReader();
+
+        // Advance to the next line.  An over long line is skipped
+        // through to its end and reported once.
+        HNTDLR_RESULT_T next();
+
+        // The current line without its terminator, valid until next()
+        const std::string& getLine();
+
+        // 1 based number of the current line
+        uint getLineNumber();
+};
+
+#endif // __HNTD_LINE_READER_H__
@@ -0,0 +1,273 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#include "HNTDLog.h"
+
+#define HNTD_LOG_DRAIN_BUFSIZE  ( 64 * 1024 )
+#define HNTD_LOG_IDLE_MAX_US    5000
+
+static const char *g_HNTDLogLevelStr[] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
+
+static uint32_t
+hntdLogThreadID()
+{
+    static thread_local uint32_t tid = 0;
+
+    if( tid == 0 )
+        tid = (uint32_t) syscall( SYS_gettid );
+
+    return tid;
+}
+
+static uint64_t
+hntdLogTimestampUS()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_REALTIME, &ts );
+
+    return ( (uint64_t) ts.tv_sec * 1000000 ) + ( ts.tv_nsec / 1000 );
+}
+
+static uint
+hntdLogFormatLine( char *buf, uint bufSize, HNTD_LOG_LEVEL_T level, uint32_t tid, uint64_t timestampUS, const char *text, uint length )
+{
+    static thread_local time_t lastSec = 0;
+    static thread_local char   secStr[ 32 ];
+
+    time_t sec = timestampUS / 1000000;
+
+    // The seconds portion rarely changes between messages
+    if( sec != lastSec )
+    {
+        struct tm tmVal;
+        localtime_r( &sec, &tmVal );
+        strftime( secStr, sizeof( secStr ), "%Y-%m-%d %H:%M:%S", &tmVal );
+        lastSec = sec;
+    }
+
+    int hdrLen = snprintf( buf, bufSize, "%s.%06u %s [%u] ", secStr, (uint)( timestampUS % 1000000 ), g_HNTDLogLevelStr[ level ], tid );
+    if( ( hdrLen < 0 ) || ( (uint) hdrLen + length + 1 > bufSize ) )
+        return 0;
+
+    memcpy( buf + hdrLen, text, length );
+    buf[ hdrLen + length ] = '\n';
+
+    return hdrLen + length + 1;
+}
+
+HNTDLog::HNTDLog()
+: m_enqueuePos( 0 ), m_dequeuePos( 0 ), m_level( HNTD_LOG_LEVEL_INFO ), m_dropCount( 0 ), m_running( false ), m_writers( 0 )
+{
+    m_ring = new SLOT_T[ RING_SIZE ];
+
+    for( uint i = 0; i < RING_SIZE; i++ )
+        m_ring[i].seq.store( i, std::memory_order_relaxed );
+}
+
+HNTDLog::~HNTDLog()
+{
+    stop();
+
+    delete[] m_ring;
+}
+
+HNTDLog&
+HNTDLog::getInstance()
+{
+    static HNTDLog instance;
+
+    return instance;
+}
+
+void
+HNTDLog::setLevel( HNTD_LOG_LEVEL_T level )
+{
+    m_level.store( level, std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDLog::getDropCount()
+{
+    return m_dropCount.load( std::memory_order_relaxed );
+}
+
+void
+HNTDLog::start()
+{
+    if( m_running.exchange( true ) == true )
+        return;
+
+    m_drainThread = std::thread( &HNTDLog::drainLoop, this );
+}
+
+void
+HNTDLog::stop()
+{
+    if( m_running.exchange( false ) == false )
+        return;
+
+    m_drainThread.join();
+
+    // A producer that saw m_running set may still be filling its slot.
+    // Later producers see it clear and write directly.
+    while( m_writers.load() != 0 )
+        std::this_thread::yield();
+
+    // Pick up anything queued while the thread was exiting
+    char *buf = new char[ HNTD_LOG_DRAIN_BUFSIZE ];
+    while( drainBatch( buf, HNTD_LOG_DRAIN_BUFSIZE ) != 0 );
+    delete[] buf;
+
+    uint64_t drops = getDropCount();
+    if( drops != 0 )
+        fprintf( stdout, "HNTDLog: %lu messages dropped\n", (unsigned long) drops );
+
+    fflush( stdout );
+}
+
+void
+HNTDLog::writeDirect( HNTD_LOG_LEVEL_T level, uint32_t tid, uint64_t timestampUS, const char *text, uint length )
+{
+    char line[ TEXT_SIZE + 64 ];
+
+    uint lineLen = hntdLogFormatLine( line, sizeof( line ), level, tid, timestampUS, text, length );
+
+    fwrite( line, 1, lineLen, stdout );
+    fflush( stdout );
+}
+
+void
+HNTDLog::write( HNTD_LOG_LEVEL_T level, const char *format, ... )
+{
+    char text[ TEXT_SIZE ];
+    va_list args;
+
+    va_start( args, format );
+    int length = vsnprintf( text, sizeof( text ), format, args );
+    va_end( args );
+
+    if( length < 0 )
+        return;
+
+    // Messages longer than a slot are truncated
+    if( (uint) length >= sizeof( text ) )
+        length = sizeof( text ) - 1;
+
+    uint32_t tid = hntdLogThreadID();
+    uint64_t timestampUS = hntdLogTimestampUS();
+
+    // Before start() and after stop() there is no drain thread.
+    // Counted first so stop() either sees this writer or it sees
+    // m_running clear.
+    m_writers.fetch_add( 1 );
+
+    if( m_running.load() == false )
+    {
+        m_writers.fetch_sub( 1 );
+        writeDirect( level, tid, timestampUS, text, length );
+        return;
+    }
+
+    // Claim a slot
+    SLOT_T  *slot;
+    uint64_t pos = m_enqueuePos.load( std::memory_order_relaxed );
+
+    for( ;; )
+    {
+        slot = &m_ring[ pos & ( RING_SIZE - 1 ) ];
+
+        int64_t diff = (int64_t) slot->seq.load( std::memory_order_acquire ) - (int64_t) pos;
+
+        if( diff == 0 )
+        {
+            if( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                break;
+        }
+        else if( diff < 0 )
+        {
+            // Ring is full
+            m_dropCount.fetch_add( 1, std::memory_order_relaxed );
+            m_writers.fetch_sub( 1, std::memory_order_release );
+            return;
+        }
+        else
+            pos = m_enqueuePos.load( std::memory_order_relaxed );
+    }
+
+    slot->level       = level;
+    slot->tid         = tid;
+    slot->timestampUS = timestampUS;
+    slot->length      = length;
+    memcpy( slot->text, text, length );
+
+    // Publish to the drain thread
+    slot->seq.store( pos + 1, std::memory_order_release );
+
+    m_writers.fetch_sub( 1, std::memory_order_release );
+}
+
+uint
+HNTDLog::drainBatch( char *buf, uint bufSize )
+{
+    uint used  = 0;
+    uint count = 0;
+
+    for( ;; )
+    {
+        SLOT_T *slot = &m_ring[ m_dequeuePos & ( RING_SIZE - 1 ) ];
+
+        if( slot->seq.load( std::memory_order_acquire ) != ( m_dequeuePos + 1 ) )
+            break;
+
+        // Make room in the output buffer
+        if( ( bufSize - used ) < ( TEXT_SIZE + 64 ) )
+        {
+            fwrite( buf, 1, used, stdout );
+            used = 0;
+        }
+
+        used += hntdLogFormatLine( buf + used, bufSize - used, slot->level, slot->tid, slot->timestampUS, slot->text, slot->length );
+
+        // Hand the slot back to the producers
+        slot->seq.store( m_dequeuePos + RING_SIZE, std::memory_order_release );
+        m_dequeuePos += 1;
+        count += 1;
+    }
+
+    if( used != 0 )
+    {
+        fwrite( buf, 1, used, stdout );
+        fflush( stdout );
+    }
+
+    return count;
+}
+
+void
+HNTDLog::drainLoop()
+{
+    char *buf = new char[ HNTD_LOG_DRAIN_BUFSIZE ];
+    uint idleUS = 1000;
+
+    while( m_running.load( std::memory_order_relaxed ) )
+    {
+        if( drainBatch( buf, HNTD_LOG_DRAIN_BUFSIZE ) != 0 )
+        {
+            idleUS = 1000;
+            continue;
+        }
+
+        // Back off while idle, producers never signal so
+        // that the write path stays free of locks and syscalls.
+        usleep( idleUS );
+        if( idleUS < HNTD_LOG_IDLE_MAX_US )
+            idleUS *= 2;
+    }
+
+    delete[] buf;
+}
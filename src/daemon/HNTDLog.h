@@ -0,0 +1,91 @@
+#ifndef __HNTD_LOG_H__
+#define __HNTD_LOG_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <thread>
+
+typedef enum HNTDLogLevelEnum
+{
+  HNTD_LOG_LEVEL_ERROR,
+  HNTD_LOG_LEVEL_WARN,
+  HNTD_LOG_LEVEL_INFO,
+  HNTD_LOG_LEVEL_DEBUG
+}HNTD_LOG_LEVEL_T;
+
+// Process wide logger.  Messages are formatted by the calling thread
+// into a slot of a fixed size lock-free ring (bounded MPMC sequence
+// queue) and written to stdout by a background drain thread, so
+// callers never block on the stdout lock or wait for a flush.  When
+// the ring is full messages are dropped and counted rather than
+// stalling the caller.  Use the HNTD_LOG_* macros so that disabled
+// levels skip formatting entirely.
+class HNTDLog
+{
+    private:
+        static const uint RING_SIZE = 4096;   // Must be a power of two
+        static const uint TEXT_SIZE = 232;
+
+        typedef struct alignas(64) SlotStruct
+        {
+            std::atomic< uint64_t > seq;
+
+            HNTD_LOG_LEVEL_T level;
+            uint32_t         tid;
+            uint64_t         timestampUS;
+            uint32_t         length;
+            char             text[ TEXT_SIZE ];
+        }SLOT_T;
+
+        SLOT_T *m_ring;
+
+        alignas(64) std::atomic< uint64_t > m_enqueuePos;
+        alignas(64) uint64_t                m_dequeuePos;
+
+        std::atomic< int >      m_level;
+        std::atomic< uint64_t > m_dropCount;
+
+        std::atomic< bool > m_running;
+        std::thread         m_drainThread;
+
+        // Producers between checking m_running and publishing their
+        // slot, stop() waits them out before its last drain
+        std::atomic< uint > m_writers;
+
+        HNTDLog();
+       ~HNTDLog();
+
+        void drainLoop();
+        uint drainBatch( char *buf, uint bufSize );
+
+        static void writeDirect( HNTD_LOG_LEVEL_T level, uint32_t tid, uint64_t timestampUS, const char *text, uint length );
+
+    public:
+        static HNTDLog& getInstance();
+
+        void start();
+        void stop();
+
+        void setLevel( HNTD_LOG_LEVEL_T level );
+
+        bool isEnabled( HNTD_LOG_LEVEL_T level )
+        {
+            return ( (int) level <= m_level.load( std::memory_order_relaxed ) );
+        }
+
+        void write( HNTD_LOG_LEVEL_T level, const char *format, ... ) __attribute__(( format( printf, 3, 4 ) ));
+
+        uint64_t getDropCount();
+};
+
+#define HNTD_LOG( level, ... ) \
+    do { if( HNTDLog::getInstance().isEnabled( level ) ) HNTDLog::getInstance().write( level, __VA_ARGS__ ); } while( 0 )
+
+#define HNTD_LOG_ERROR( ... )  HNTD_LOG( HNTD_LOG_LEVEL_ERROR, __VA_ARGS__ )
+#define HNTD_LOG_WARN( ... )   HNTD_LOG( HNTD_LOG_LEVEL_WARN, __VA_ARGS__ )
+#define HNTD_LOG_INFO( ... )   HNTD_LOG( HNTD_LOG_LEVEL_INFO, __VA_ARGS__ )
+#define HNTD_LOG_DEBUG( ... )  HNTD_LOG( HNTD_LOG_LEVEL_DEBUG, __VA_ARGS__ )
+
+#endif // __HNTD_LOG_H__
@@ -0,0 +1,106 @@
+#include "HNTDMetrics.h"
+
+// Each HNTDMetrics gets a unique id that indexes the per-thread
+// block table below, ids are never reused.
+static std::atomic< uint > g_HNTDMetricsNextID( 0 );
+
+static thread_local std::vector< HNTDOpCounters* > t_HNTDMetricsBlocks;
+
+HNTDOpCounters::HNTDOpCounters()
+: requests( 0 ), errors( 0 ), bytesIn( 0 ), bytesOut( 0 )
+{
+
+}
+
+HNTDOpSnapshot::HNTDOpSnapshot()
+: requests( 0 ), errors( 0 ), bytesIn( 0 ), bytesOut( 0 )
+{
+
+}
+
+HNTDMetrics::HNTDMetrics( uint opCount )
+{
+    m_opCount    = opCount;
+    m_instanceID = g_HNTDMetricsNextID.fetch_add( 1 );
+}
+
+HNTDMetrics::~HNTDMetrics()
+{
+    std::lock_guard< std::mutex > lock( m_blockLock );
+
+    for( std::vector< HNTDOpCounters* >::iterator it = m_blocks.begin(); it != m_blocks.end(); it++ )
+        delete[] *it;
+
+    m_blocks.clear();
+}
+
+uint
+HNTDMetrics::getOpCount()
+{
+    return m_opCount;
+}
+
+HNTDOpCounters*
+HNTDMetrics::getThreadBlock()
+{
+    if( m_instanceID >= t_HNTDMetricsBlocks.size() )
+        t_HNTDMetricsBlocks.resize( m_instanceID + 1, NULL );
+
+    HNTDOpCounters *block = t_HNTDMetricsBlocks[ m_instanceID ];
+
+    if( block == NULL )
+    {
+        // First request on this thread, the block is owned by
+        // this object so it stays readable after the thread exits.
+        block = new HNTDOpCounters[ m_opCount ];
+
+        std::lock_guard< std::mutex > lock( m_blockLock );
+        m_blocks.push_back( block );
+
+        t_HNTDMetricsBlocks[ m_instanceID ] = block;
+    }
+
+    return block;
+}
+
+void
+HNTDMetrics::record( uint opIndex, uint64_t latencyNS, bool error, uint64_t bytesIn, uint64_t bytesOut )
+{
+    if( opIndex >= m_opCount )
+        return;
+
+    HNTDOpCounters &ctr = getThreadBlock()[ opIndex ];
+
+    // Only this thread writes these counters
+    ctr.requests.store( ctr.requests.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+    if( error )
+        ctr.errors.store( ctr.errors.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+    ctr.bytesIn.store( ctr.bytesIn.load( std::memory_order_relaxed ) + bytesIn, std::memory_order_relaxed );
+    ctr.bytesOut.store( ctr.bytesOut.load( std::memory_order_relaxed ) + bytesOut, std::memory_order_relaxed );
+
+    ctr.latencyNS.record( latencyNS );
+}
+
+void
+HNTDMetrics::getSnapshot( std::vector< HNTDOpSnapshot > &snapshot )
+{
+    std::lock_guard< std::mutex > lock( m_blockLock );
+
+    for( std::vector< HNTDOpCounters* >::iterator it = m_blocks.begin(); it != m_blocks.end(); it++ )
+    {
+        for( uint op = 0; op < m_opCount; op++ )
+        {
+            HNTDOpCounters &ctr = (*it)[ op ];
+            HNTDOpSnapshot &snap = snapshot[ op ];
+
+            snap.requests += ctr.requests.load( std::memory_order_relaxed );
+            snap.errors   += ctr.errors.load( std::memory_order_relaxed );
+            snap.bytesIn  += ctr.bytesIn.load( std::memory_order_relaxed );
+            snap.bytesOut += ctr.bytesOut.load( std::memory_order_relaxed );
+
+            snap.latencyNS.merge( ctr.latencyNS );
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef __HNTD_METRICS_H__
+#define __HNTD_METRICS_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "HNTDHistogram.h"
+
+// Per operation counters as written by a single thread
+class HNTDOpCounters
+{
+    public:
+        std::atomic< uint64_t > requests;
+        std::atomic< uint64_t > errors;
+        std::atomic< uint64_t > bytesIn;
+        std::atomic< uint64_t > bytesOut;
+
+        HNTDHistogram latencyNS;
+
+        HNTDOpCounters();
+};
+
+// Merged view of one operation returned by getSnapshot()
+class HNTDOpSnapshot
+{
+    public:
+        uint64_t requests;
+        uint64_t errors;
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+
+        HNTDHistogram latencyNS;
+
+        HNTDOpSnapshot();
+};
+
+// Request metrics for a fixed set of operations.  Every recording
+// thread gets its own block of counters the first time it records,
+// after that recording touches only that thread's cache lines with
+// relaxed stores.  The blocks are only summed when a snapshot is
+// requested.
+class HNTDMetrics
+{
+    private:
+        uint m_opCount;
+        uint m_instanceID;
+
+        std::mutex m_blockLock;
+        std::vector< HNTDOpCounters* > m_blocks;
+
+        HNTDOpCounters* getThreadBlock();
+
+    public:
+        HNTDMetrics( uint opCount );
+       ~HNTDMetrics();
+
+        uint getOpCount();
+
+        void record( uint opIndex, uint64_t latencyNS, bool error, uint64_t bytesIn, uint64_t bytesOut );
+
+        // snapshot must hold getOpCount() zeroed entries.  The histograms
+        // cannot be moved, so size it on construction.
+        void getSnapshot( std::vector< HNTDOpSnapshot > &snapshot );
+};
+
+#endif // __HNTD_METRICS_H__
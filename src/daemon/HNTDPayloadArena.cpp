@@ -0,0 +1,163 @@
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+
+#include "HNTDPayloadArena.h"
+
+static const char g_HNTDBlobPattern[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+HNTDPayloadArena::HNTDPayloadArena()
+{
+    m_capacity = 0;
+
+    for( uint i = 0; i < 2; i++ )
+    {
+        m_regions[ i ].base = NULL;
+        m_regions[ i ].filled.store( 0 );
+    }
+}
+
+HNTDPayloadArena::~HNTDPayloadArena()
+{
+    for( uint i = 0; i < 2; i++ )
+    {
+        if( m_regions[ i ].base != NULL )
+            munmap( m_regions[ i ].base, m_capacity );
+    }
+}
+
+bool
+HNTDPayloadArena::reserve()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_capacity != 0 )
+        return true;
+
+    // Room for the largest payload plus the record that straddles its end
+    uint64_t pageSize = sysconf( _SC_PAGESIZE );
+    uint64_t capacity = ( ( HNTD_PAYLOAD_MAX_SIZE + RECORD_SIZE + pageSize - 1 ) / pageSize ) * pageSize;
+
+    for( uint i = 0; i < 2; i++ )
+    {
+        void *base = mmap( NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+        if( base == MAP_FAILED )
+        {
+            if( i == 1 )
+            {
+                munmap( m_regions[ 0 ].base, capacity );
+                m_regions[ 0 ].base = NULL;
+            }
+            return false;
+        }
+
+        m_regions[ i ].base = (char *) base;
+    }
+
+    m_capacity = capacity;
+
+    return true;
+}
+
+void
+HNTDPayloadArena::fill( HNTD_PAYLOAD_SHAPE_T shape, uint64_t length )
+{
+    REGION_T &region = m_regions[ shape ];
+
+    uint64_t filled = region.filled.load( std::memory_order_relaxed );
+
+    // Grow at least geometrically and always by whole pages, so the
+    // filled part can be protected and a run of growing requests
+    // does not fill a page run each
+    uint64_t pageSize = sysconf( _SC_PAGESIZE );
+    uint64_t target   = std::max( length, filled * 2 );
+    target = ( ( target + pageSize - 1 ) / pageSize ) * pageSize;
+    if( target > m_capacity )
+        target = m_capacity;
+
+    if( shape == HNTD_PAYLOAD_SHAPE_BLOB )
+    {
+        uint64_t patternLen = sizeof( g_HNTDBlobPattern ) - 1;
+
+        for( uint64_t i = filled; i < target; i++ )
+            region.base[ i ] = g_HNTDBlobPattern[ i % patternLen ];
+    }
+    else
+    {
+        // Records are written whole, the one crossing the old end was
+        // completed by the last fill so start at the first one after it
+        char record[ RECORD_SIZE + 1 ];
+
+        for( uint64_t seq = ( filled + RECORD_SIZE - 1 ) / RECORD_SIZE; ( seq * RECORD_SIZE ) < target; seq++ )
+        {
+            int len = snprintf( record, sizeof( record ), "{\"seq\":%8lu,\"value\":\"", (unsigned long) seq );
+            memset( record + len, 'x', RECORD_SIZE - len - 3 );
+            memcpy( record + RECORD_SIZE - 3, "\"},", 3 );
+
+            uint64_t offset = seq * RECORD_SIZE;
+            uint64_t copyLen = std::min( (uint64_t) RECORD_SIZE, m_capacity - offset );
+            memcpy( region.base + offset, record, copyLen );
+        }
+    }
+
+    // Served bytes never change again
+    mprotect( region.base, target, PROT_READ );
+
+    region.filled.store( target, std::memory_order_release );
+}
+
+const char*
+HNTDPayloadArena::getFiller( HNTD_PAYLOAD_SHAPE_T shape, uint64_t length )
+{
+    if( ( m_capacity == 0 ) || ( length > HNTD_PAYLOAD_MAX_SIZE ) )
+        return NULL;
+
+    REGION_T &region = m_regions[ shape ];
+
+    if( region.filled.load( std::memory_order_acquire ) >= length )
+        return region.base;
+
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( region.filled.load( std::memory_order_relaxed ) < length )
+        fill( shape, length );
+
+    return region.base;
+}
+
+uint64_t
+HNTDPayloadArena::getCommittedBytes()
+{
+    return m_regions[ 0 ].filled.load( std::memory_order_relaxed ) + m_regions[ 1 ].filled.load( std::memory_order_relaxed );
+}
+
+const char*
+HNTDPayloadArena::getShapeName( HNTD_PAYLOAD_SHAPE_T shape )
+{
+    switch( shape )
+    {
+        case HNTD_PAYLOAD_SHAPE_BLOB:
+            return "blob";
+
+        case HNTD_PAYLOAD_SHAPE_RECORDS:
+            return "records";
+    }
+
+    return "unknown";
+}
+
+bool
+HNTDPayloadArena::parseShapeName( const std::string &name, HNTD_PAYLOAD_SHAPE_T &shape )
+{
+    if( "blob" == name )
+        shape = HNTD_PAYLOAD_SHAPE_BLOB;
+    else if( "records" == name )
+        shape = HNTD_PAYLOAD_SHAPE_RECORDS;
+    else
+        return false;
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef __HNTD_PAYLOAD_ARENA_H__
+#define __HNTD_PAYLOAD_ARENA_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <mutex>
+#include <atomic>
+
+// Bounds of a synthetic payload, in bytes of response body
+#define HNTD_PAYLOAD_MIN_SIZE  100
+#define HNTD_PAYLOAD_MAX_SIZE  ( 100ULL * 1024 * 1024 )
+
+typedef enum HNTDPayloadShapeEnum
+{
+  HNTD_PAYLOAD_SHAPE_BLOB,     // One long string value
+  HNTD_PAYLOAD_SHAPE_RECORDS   // An array of small fixed width objects
+}HNTD_PAYLOAD_SHAPE_T;
+
+// Read-only JSON filler for synthetic responses, shared by every
+// device in the process.  Each shape is generated once into its own
+// reserved region and any response of that shape is a prefix of it,
+// so a payload of any size is written straight from the arena without
+// building or copying a body.  Regions are filled a page run at a time
+// as larger payloads are asked for and the filled part is made read
+// only; memory is only committed up to the largest payload served.
+class HNTDPayloadArena
+{
+    private:
+        typedef struct RegionStruct
+        {
+            char                    *base;
+            std::atomic< uint64_t >  filled;
+        }REGION_T;
+
+        std::mutex m_lock;
+
+        uint64_t m_capacity;
+
+        REGION_T m_regions[ 2 ];
+
+        void fill( HNTD_PAYLOAD_SHAPE_T shape, uint64_t length );
+
+    public:
+        // Width of one records shape element, including its comma
+        static const uint RECORD_SIZE = 64;
+
+        HNTDPayloadArena();
+       ~HNTDPayloadArena();
+
+        // Reserve the address space, false if it could not be mapped
+        bool reserve();
+
+        // Start of at least length bytes of filler, NULL if length is
+        // beyond HNTD_PAYLOAD_MAX_SIZE.  Blob filler is plain string
+        // content.  Records filler is a run of RECORD_SIZE wide objects
+        // each followed by a comma.
+        const char* getFiller( HNTD_PAYLOAD_SHAPE_T shape, uint64_t length );
+
+        uint64_t getCommittedBytes();
+
+        static const char* getShapeName( HNTD_PAYLOAD_SHAPE_T shape );
+        static bool parseShapeName( const std::string &name, HNTD_PAYLOAD_SHAPE_T &shape );
+};
+
+#endif // __HNTD_PAYLOAD_ARENA_H__
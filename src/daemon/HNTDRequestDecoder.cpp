@@ -0,0 +1,721 @@
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+#include "HNTDRequestDecoder.h"
+
+// Bodies are read in blocks of this size
+#define HNTD_DECODER_READ_BLOCK  16384
+
+// Nesting allowed inside members that are being skipped
+#define HNTD_DECODER_MAX_DEPTH   32
+
+// Per thread body buffer shared by every decoder on the thread
+static thread_local std::string t_HNTDDecoderScratch;
+
+HNTDRequestDecoder::HNTDRequestDecoder( uint maxBodySize )
+: m_scratch( t_HNTDDecoderScratch )
+{
+    m_maxBodySize = maxBodySize;
+    m_pos = NULL;
+    m_end = NULL;
+}
+
+HNTDRequestDecoder::~HNTDRequestDecoder()
+{
+
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::fail( const char *error )
+{
+    m_error = error;
+    return HNTDRD_RESULT_MALFORMED;
+}
+
+const std::string&
+HNTDRequestDecoder::getError()
+{
+    return m_error;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::load( std::istream &body, int64_t contentLength )
+{
+    if( ( contentLength > 0 ) && ( (uint64_t) contentLength > m_maxBodySize ) )
+    {
+        m_error = "request body too large";
+        return HNTDRD_RESULT_TOO_LARGE;
+    }
+
+    size_t used = 0;
+
+    while( true )
+    {
+        if( m_scratch.size() < ( used + HNTD_DECODER_READ_BLOCK ) )
+            m_scratch.resize( used + HNTD_DECODER_READ_BLOCK );
+
+        body.read( &m_scratch[ used ], HNTD_DECODER_READ_BLOCK );
+        size_t count = body.gcount();
+
+        used += count;
+
+        // Stop reading as soon as the limit is passed
+        if( used > m_maxBodySize )
+        {
+            m_error = "request body too large";
+            return HNTDRD_RESULT_TOO_LARGE;
+        }
+
+        if( count < HNTD_DECODER_READ_BLOCK )
+            break;
+    }
+
+    setInput( m_scratch.data(), used );
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+void
+HNTDRequestDecoder::setInput( const char *data, size_t length )
+{
+    m_pos = data;
+    m_end = data + length;
+    m_error.clear();
+}
+
+void
+HNTDRequestDecoder::skipSpace()
+{
+    while( ( m_pos < m_end ) && ( ( *m_pos == ' ' ) || ( *m_pos == '\t' ) || ( *m_pos == '\n' ) || ( *m_pos == '\r' ) ) )
+        m_pos++;
+}
+
+bool
+HNTDRequestDecoder::peek( char c )
+{
+    skipSpace();
+    return ( ( m_pos < m_end ) && ( *m_pos == c ) );
+}
+
+bool
+HNTDRequestDecoder::consume( char c )
+{
+    if( peek( c ) == false )
+        return false;
+
+    m_pos++;
+    return true;
+}
+
+static int
+hntdHexValue( char c )
+{
+    if( ( c >= '0' ) && ( c <= '9' ) )
+        return c - '0';
+    if( ( c >= 'a' ) && ( c <= 'f' ) )
+        return c - 'a' + 10;
+    if( ( c >= 'A' ) && ( c <= 'F' ) )
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void
+hntdAppendUTF8( std::string &value, uint32_t cp )
+{
+    if( cp < 0x80 )
+        value.push_back( (char) cp );
+    else if( cp < 0x800 )
+    {
+        value.push_back( (char)( 0xC0 | ( cp >> 6 ) ) );
+        value.push_back( (char)( 0x80 | ( cp & 0x3F ) ) );
+    }
+    else if( cp < 0x10000 )
+    {
+        value.push_back( (char)( 0xE0 | ( cp >> 12 ) ) );
+        value.push_back( (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+        value.push_back( (char)( 0x80 | ( cp & 0x3F ) ) );
+    }
+    else
+    {
+        value.push_back( (char)( 0xF0 | ( cp >> 18 ) ) );
+        value.push_back( (char)( 0x80 | ( ( cp >> 12 ) & 0x3F ) ) );
+        value.push_back( (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+        value.push_back( (char)( 0x80 | ( cp & 0x3F ) ) );
+    }
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::readString( std::string &value )
+{
+    if( consume( '"' ) == false )
+        return fail( "expected string" );
+
+    value.clear();
+
+    while( m_pos < m_end )
+    {
+        // Copy runs of plain characters in one go
+        const char *run = m_pos;
+        while( ( m_pos < m_end ) && ( *m_pos != '"' ) && ( *m_pos != '\\' ) && ( (unsigned char) *m_pos >= 0x20 ) )
+            m_pos++;
+
+        value.append( run, m_pos - run );
+
+        if( m_pos == m_end )
+            break;
+
+        char c = *m_pos++;
+
+        if( c == '"' )
+            return HNTDRD_RESULT_SUCCESS;
+
+        if( c != '\\' )
+            return fail( "control character in string" );
+
+        if( m_pos == m_end )
+            break;
+
+        switch( *m_pos++ )
+        {
+            case '"':  value.push_back( '"' );  break;
+            case '\\': value.push_back( '\\' ); break;
+            case '/':  value.push_back( '/' );  break;
+            case 'b':  value.push_back( '\b' ); break;
+            case 'f':  value.push_back( '\f' ); break;
+            case 'n':  value.push_back( '\n' ); break;
+            case 'r':  value.push_back( '\r' ); break;
+            case 't':  value.push_back( '\t' ); break;
+
+            case 'u':
+            {
+                uint32_t cp = 0;
+                for( uint i = 0; i < 4; i++ )
+                {
+                    int hex = ( m_pos < m_end ) ? hntdHexValue( *m_pos++ ) : -1;
+                    if( hex < 0 )
+                        return fail( "bad unicode escape" );
+                    cp = ( cp << 4 ) | hex;
+                }
+
+                // Combine a surrogate pair
+                if( ( cp >= 0xD800 ) && ( cp <= 0xDBFF ) && ( ( m_end - m_pos ) >= 6 ) && ( m_pos[0] == '\\' ) && ( m_pos[1] == 'u' ) )
+                {
+                    uint32_t low = 0;
+                    for( uint i = 2; i < 6; i++ )
+                    {
+                        int hex = hntdHexValue( m_pos[i] );
+                        if( hex < 0 )
+                            return fail( "bad unicode escape" );
+                        low = ( low << 4 ) | hex;
+                    }
+
+                    if( ( low >= 0xDC00 ) && ( low <= 0xDFFF ) )
+                    {
+                        cp = 0x10000 + ( ( cp - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+                        m_pos += 6;
+                    }
+                }
+
+                hntdAppendUTF8( value, cp );
+            }
+            break;
+
+            default:
+                return fail( "bad escape in string" );
+        }
+    }
+
+    return fail( "unterminated string" );
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::readUInt( uint &value )
+{
+    skipSpace();
+
+    if( ( m_pos == m_end ) || ( *m_pos < '0' ) || ( *m_pos > '9' ) )
+        return fail( "expected unsigned integer" );
+
+    uint64_t result = 0;
+    while( ( m_pos < m_end ) && ( *m_pos >= '0' ) && ( *m_pos <= '9' ) )
+    {
+        result = ( result * 10 ) + ( *m_pos++ - '0' );
+        if( result > UINT_MAX )
+            return fail( "integer out of range" );
+    }
+
+    if( ( m_pos < m_end ) && ( ( *m_pos == '.' ) || ( *m_pos == 'e' ) || ( *m_pos == 'E' ) ) )
+        return fail( "expected unsigned integer" );
+
+    value = result;
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::readDouble( double &value )
+{
+    skipSpace();
+
+    const char *start = m_pos;
+    while( ( m_pos < m_end ) && ( strchr( "0123456789+-.eE", *m_pos ) != NULL ) )
+        m_pos++;
+
+    // strtod needs a terminated copy, numbers are short
+    char number[ 64 ];
+    size_t length = m_pos - start;
+
+    if( ( length == 0 ) || ( length >= sizeof( number ) ) )
+        return fail( "expected number" );
+
+    memcpy( number, start, length );
+    number[ length ] = '\0';
+
+    char *numEnd;
+    value = strtod( number, &numEnd );
+
+    if( ( *numEnd != '\0' ) || ( isfinite( value ) == 0 ) )
+        return fail( "expected number" );
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::skipValue( uint depth )
+{
+    if( depth > HNTD_DECODER_MAX_DEPTH )
+        return fail( "nesting too deep" );
+
+    skipSpace();
+
+    if( m_pos == m_end )
+        return fail( "expected value" );
+
+    switch( *m_pos )
+    {
+        case '"':
+        {
+            std::string discard;
+            return readString( discard );
+        }
+
+        case '{':
+        {
+            std::string key;
+            bool first = true;
+
+            m_pos++;
+            while( true )
+            {
+                if( consume( '}' ) )
+                    return HNTDRD_RESULT_SUCCESS;
+
+                if( ( first == false ) && ( consume( ',' ) == false ) )
+                    return fail( "expected ',' or '}'" );
+                first = false;
+
+                if( readString( key ) != HNTDRD_RESULT_SUCCESS )
+                    return HNTDRD_RESULT_MALFORMED;
+
+                if( consume( ':' ) == false )
+                    return fail( "expected ':'" );
+
+                if( skipValue( depth + 1 ) != HNTDRD_RESULT_SUCCESS )
+                    return HNTDRD_RESULT_MALFORMED;
+            }
+        }
+
+        case '[':
+        {
+            bool first = true;
+
+            m_pos++;
+            while( true )
+            {
+                if( consume( ']' ) )
+                    return HNTDRD_RESULT_SUCCESS;
+
+                if( ( first == false ) && ( consume( ',' ) == false ) )
+                    return fail( "expected ',' or ']'" );
+                first = false;
+
+                if( skipValue( depth + 1 ) != HNTDRD_RESULT_SUCCESS )
+                    return HNTDRD_RESULT_MALFORMED;
+            }
+        }
+
+        case 't':
+        case 'f':
+        case 'n':
+        {
+            static const char *literals[] = { "true", "false", "null" };
+            for( uint i = 0; i < 3; i++ )
+            {
+                size_t len = strlen( literals[i] );
+                if( ( (size_t)( m_end - m_pos ) >= len ) && ( memcmp( m_pos, literals[i], len ) == 0 ) )
+                {
+                    m_pos += len;
+                    return HNTDRD_RESULT_SUCCESS;
+                }
+            }
+            return fail( "bad literal" );
+        }
+
+        default:
+        {
+            const char *start = m_pos;
+            while( ( m_pos < m_end ) && ( strchr( "0123456789+-.eE", *m_pos ) != NULL ) )
+                m_pos++;
+
+            if( m_pos == start )
+                return fail( "unexpected character" );
+
+            return HNTDRD_RESULT_SUCCESS;
+        }
+    }
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::beginObject()
+{
+    if( consume( '{' ) == false )
+        return fail( "expected object" );
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::nextMember( std::string &key, bool &first, bool &done )
+{
+    done = false;
+
+    if( consume( '}' ) )
+    {
+        done = true;
+        return HNTDRD_RESULT_SUCCESS;
+    }
+
+    // Every member but the first is preceded by a comma
+    if( ( first == false ) && ( consume( ',' ) == false ) )
+        return fail( "expected ',' or '}'" );
+    first = false;
+
+    if( readString( key ) != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    if( consume( ':' ) == false )
+        return fail( "expected ':'" );
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::finish()
+{
+    skipSpace();
+
+    if( m_pos != m_end )
+        return fail( "trailing data after value" );
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeWidgetFields( HNTD_WIDGET_FIELDS_T &fields )
+{
+    std::string key;
+    bool first = true;
+    bool done;
+
+    if( beginObject() != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    while( true )
+    {
+        if( nextMember( key, first, done ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        if( done )
+            break;
+
+        HNTDRD_RESULT_T result;
+
+        if( key == "color" )
+        {
+            fields.hasColor = true;
+            result = readString( fields.color );
+        }
+        else if( key == "name" )
+        {
+            fields.hasName = true;
+            result = readString( fields.name );
+        }
+        else
+            result = skipValue( 0 );
+
+        if( result != HNTDRD_RESULT_SUCCESS )
+            return result;
+    }
+
+    return finish();
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeHealthObject( HNTD_HEALTH_CHANGE_T &change )
+{
+    std::string key;
+    bool first = true;
+    bool done;
+
+    change.hasComponent = false;
+    change.hasIndex     = false;
+    change.status       = "OK";
+    change.errCode      = 200;
+    change.valid        = true;
+
+    if( beginObject() != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    while( true )
+    {
+        if( nextMember( key, first, done ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        if( done )
+            break;
+
+        // A value of the wrong type only invalidates this change
+        const char *typeError = NULL;
+
+        if( ( key == "component" ) || ( key == "status" ) )
+        {
+            if( peek( '"' ) )
+            {
+                std::string &target = ( key == "component" ) ? change.component : change.status;
+                if( readString( target ) != HNTDRD_RESULT_SUCCESS )
+                    return HNTDRD_RESULT_MALFORMED;
+                change.hasComponent |= ( key == "component" );
+                continue;
+            }
+            typeError = ( key == "component" ) ? "component must be a string" : "status must be a string";
+        }
+        else if( ( key == "errCode" ) || ( key == "index" ) )
+        {
+            skipSpace();
+            if( ( m_pos < m_end ) && ( *m_pos >= '0' ) && ( *m_pos <= '9' ) )
+            {
+                uint &target = ( key == "errCode" ) ? change.errCode : change.index;
+                if( readUInt( target ) != HNTDRD_RESULT_SUCCESS )
+                    return HNTDRD_RESULT_MALFORMED;
+                change.hasIndex |= ( key == "index" );
+                continue;
+            }
+            typeError = ( key == "errCode" ) ? "errCode must be an unsigned integer" : "index must be an unsigned integer";
+        }
+
+        if( typeError != NULL )
+        {
+            change.valid = false;
+            change.error = typeError;
+        }
+
+        if( skipValue( 0 ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+    }
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeHealthChange( HNTD_HEALTH_CHANGE_T &change )
+{
+    if( decodeHealthObject( change ) != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    if( change.valid == false )
+        return fail( change.error.c_str() );
+
+    return finish();
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeHealthBatch( std::vector< HNTD_HEALTH_CHANGE_T > &changes )
+{
+    bool first = true;
+
+    changes.clear();
+
+    if( consume( '[' ) == false )
+        return fail( "expected array" );
+
+    while( true )
+    {
+        if( consume( ']' ) )
+            break;
+
+        if( ( first == false ) && ( consume( ',' ) == false ) )
+            return fail( "expected ',' or ']'" );
+        first = false;
+
+        changes.push_back( HNTD_HEALTH_CHANGE_T() );
+        HNTD_HEALTH_CHANGE_T &change = changes.back();
+
+        if( peek( '{' ) )
+        {
+            if( decodeHealthObject( change ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+        }
+        else
+        {
+            if( skipValue( 0 ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+
+            change.valid = false;
+            change.error = "entry is not an object";
+        }
+    }
+
+    return finish();
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeLatencyObject( HNTD_FAULT_RULE_T &rule )
+{
+    std::string key;
+    bool first = true;
+    bool done;
+
+    if( beginObject() != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    while( true )
+    {
+        if( nextMember( key, first, done ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        if( done )
+            break;
+
+        HNTDRD_RESULT_T result;
+
+        if( key == "distribution" )
+        {
+            std::string name;
+            if( readString( name ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+
+            if( HNTDFaultInjector::parseDistName( name, rule.latencyDist ) == false )
+                return fail( "unknown latency distribution" );
+
+            continue;
+        }
+        else if( ( key == "ms" ) || ( key == "meanMs" ) )
+            result = readDouble( rule.latencyMeanMS );
+        else if( key == "minMs" )
+            result = readDouble( rule.latencyMinMS );
+        else if( key == "maxMs" )
+            result = readDouble( rule.latencyMaxMS );
+        else if( key == "stddevMs" )
+            result = readDouble( rule.latencyStddevMS );
+        else
+            result = skipValue( 0 );
+
+        if( result != HNTDRD_RESULT_SUCCESS )
+            return result;
+    }
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeFaultObject( HNTD_FAULT_RULE_T &rule )
+{
+    std::string key;
+    bool first = true;
+    bool done;
+
+    if( beginObject() != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    while( true )
+    {
+        if( nextMember( key, first, done ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        if( done )
+            break;
+
+        HNTDRD_RESULT_T result;
+
+        if( key == "latency" )
+            result = decodeLatencyObject( rule );
+        else if( key == "errorRate" )
+            result = readDouble( rule.errorRate );
+        else if( key == "errorStatus" )
+            result = readUInt( rule.errorStatus );
+        else if( key == "dropRate" )
+            result = readDouble( rule.dropRate );
+        else
+            result = skipValue( 0 );
+
+        if( result != HNTDRD_RESULT_SUCCESS )
+            return result;
+    }
+
+    return HNTDRD_RESULT_SUCCESS;
+}
+
+HNTDRD_RESULT_T
+HNTDRequestDecoder::decodeFaultRules( std::vector< HNTD_FAULT_RULE_T > &rules )
+{
+    std::string key;
+    bool first = true;
+    bool done;
+
+    rules.clear();
+
+    if( beginObject() != HNTDRD_RESULT_SUCCESS )
+        return HNTDRD_RESULT_MALFORMED;
+
+    while( true )
+    {
+        if( nextMember( key, first, done ) != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        if( done )
+            break;
+
+        if( key != "operations" )
+        {
+            if( skipValue( 0 ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+            continue;
+        }
+
+        // One member per operationId
+        std::string opID;
+        bool opFirst = true;
+        bool opDone;
+
+        if( beginObject() != HNTDRD_RESULT_SUCCESS )
+            return HNTDRD_RESULT_MALFORMED;
+
+        while( true )
+        {
+            if( nextMember( opID, opFirst, opDone ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+
+            if( opDone )
+                break;
+
+            rules.push_back( HNTD_FAULT_RULE_T() );
+            rules.back().opID = opID;
+
+            if( decodeFaultObject( rules.back() ) != HNTDRD_RESULT_SUCCESS )
+                return HNTDRD_RESULT_MALFORMED;
+        }
+    }
+
+    return finish();
+}
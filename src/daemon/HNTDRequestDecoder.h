@@ -0,0 +1,93 @@
+#ifndef __HNTD_REQUEST_DECODER_H__
+#define __HNTD_REQUEST_DECODER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <istream>
+
+#include "HNTDWidgetStore.h"
+#include "HNTDFaultInjector.h"
+
+#define HNTD_DEFAULT_MAX_BODY_SIZE  ( 1024 * 1024 )
+
+typedef enum HNTDRequestDecoderResultEnum
+{
+  HNTDRD_RESULT_SUCCESS,
+  HNTDRD_RESULT_MALFORMED,
+  HNTDRD_RESULT_TOO_LARGE
+}HNTDRD_RESULT_T;
+
+// One health change as given to putTestHealth or a batch entry
+typedef struct HNTDHealthChangeStruct
+{
+    bool        hasComponent;
+    std::string component;
+    bool        hasIndex;
+    uint        index;
+    std::string status;
+    uint        errCode;
+
+    // Batch entries that could not be decoded are kept with an error
+    bool        valid;
+    std::string error;
+}HNTD_HEALTH_CHANGE_T;
+
+// Decodes request bodies straight into the typed request structs.
+// The body is read into a per-thread scratch buffer that is reused
+// across requests, reading stops as soon as the size limit is passed,
+// and the JSON is then walked in place without building a DOM.
+// Unknown members are skipped.
+class HNTDRequestDecoder
+{
+    private:
+        std::string &m_scratch;
+
+        uint m_maxBodySize;
+
+        const char *m_pos;
+        const char *m_end;
+
+        std::string m_error;
+
+        HNTDRD_RESULT_T fail( const char *error );
+
+        void skipSpace();
+        bool consume( char c );
+        bool peek( char c );
+
+        HNTDRD_RESULT_T readString( std::string &value );
+        HNTDRD_RESULT_T readUInt( uint &value );
+        HNTDRD_RESULT_T readDouble( double &value );
+        HNTDRD_RESULT_T skipValue( uint depth );
+
+        HNTDRD_RESULT_T beginObject();
+        HNTDRD_RESULT_T nextMember( std::string &key, bool &first, bool &done );
+
+        HNTDRD_RESULT_T decodeHealthObject( HNTD_HEALTH_CHANGE_T &change );
+        HNTDRD_RESULT_T decodeLatencyObject( HNTD_FAULT_RULE_T &rule );
+        HNTDRD_RESULT_T decodeFaultObject( HNTD_FAULT_RULE_T &rule );
+        HNTDRD_RESULT_T finish();
+
+    public:
+        HNTDRequestDecoder( uint maxBodySize );
+       ~HNTDRequestDecoder();
+
+        // contentLength < 0 if not known, a declared length over the
+        // limit is rejected before anything is read.
+        HNTDRD_RESULT_T load( std::istream &body, int64_t contentLength );
+
+        // Decode from a caller supplied buffer, e.g. one NDJSON line
+        void setInput( const char *data, size_t length );
+
+        HNTDRD_RESULT_T decodeWidgetFields( HNTD_WIDGET_FIELDS_T &fields );
+        HNTDRD_RESULT_T decodeHealthChange( HNTD_HEALTH_CHANGE_T &change );
+        HNTDRD_RESULT_T decodeHealthBatch( std::vector< HNTD_HEALTH_CHANGE_T > &changes );
+        HNTDRD_RESULT_T decodeFaultRules( std::vector< HNTD_FAULT_RULE_T > &rules );
+
+        const std::string& getError();
+};
+
+#endif // __HNTD_REQUEST_DECODER_H__
@@ -0,0 +1,121 @@
+#include "HNTDResponseCache.h"
+
+HNTDResponseCache::HNTDResponseCache( uint maxEntries )
+{
+    m_maxShardEntries = ( maxEntries + SHARD_COUNT - 1 ) / SHARD_COUNT;
+}
+
+HNTDResponseCache::~HNTDResponseCache()
+{
+
+}
+
+HNTDResponseCache::Shard&
+HNTDResponseCache::shardFor( const std::string &key )
+{
+    return m_shards[ std::hash< std::string >()( key ) % SHARD_COUNT ];
+}
+
+HNTD_RESPONSE_BODY_T
+HNTDResponseCache::lookup( const std::string &key, uint64_t version )
+{
+    Shard &shard = shardFor( key );
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+
+    std::unordered_map< std::string, ENTRY_T >::iterator it = shard.entries.find( key );
+
+    if( ( it == shard.entries.end() ) || ( it->second.version != version ) )
+        return HNTD_RESPONSE_BODY_T();
+
+    return it->second.body;
+}
+
+void
+HNTDResponseCache::store( const std::string &key, uint64_t version, const HNTD_RESPONSE_BODY_T &body )
+{
+    Shard &shard = shardFor( key );
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+
+    std::unordered_map< std::string, ENTRY_T >::iterator it = shard.entries.find( key );
+
+    if( it != shard.entries.end() )
+    {
+        // Never replace a newer rendering with an older one
+        if( it->second.version > version )
+            return;
+
+        if( it->second.version != version )
+        {
+            for( uint i = 0; i < HNTD_ENCODING_COUNT; i++ )
+                it->second.encoded[ i ].reset();
+        }
+
+        it->second.version = version;
+        it->second.body    = body;
+        return;
+    }
+
+    // Bound the memory held per shard, an arbitrary
+    // victim is fine since a miss only costs a re-render.
+    if( shard.entries.size() >= m_maxShardEntries )
+        shard.entries.erase( shard.entries.begin() );
+
+    ENTRY_T entry;
+    entry.version = version;
+    entry.body    = body;
+
+    shard.entries.insert( std::make_pair( key, entry ) );
+}
+
+HNTD_RESPONSE_BODY_T
+HNTDResponseCache::lookupEncoded( const std::string &key, uint64_t version, HNTD_ENCODING_T encoding )
+{
+    Shard &shard = shardFor( key );
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+
+    std::unordered_map< std::string, ENTRY_T >::iterator it = shard.entries.find( key );
+
+    if( ( it == shard.entries.end() ) || ( it->second.version != version ) )
+        return HNTD_RESPONSE_BODY_T();
+
+    return it->second.encoded[ encoding ];
+}
+
+void
+HNTDResponseCache::storeEncoded( const std::string &key, uint64_t version, HNTD_ENCODING_T encoding, const HNTD_RESPONSE_BODY_T &body )
+{
+    Shard &shard = shardFor( key );
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+
+    std::unordered_map< std::string, ENTRY_T >::iterator it = shard.entries.find( key );
+
+    // Only alongside the body it was compressed from
+    if( ( it == shard.entries.end() ) || ( it->second.version != version ) )
+        return;
+
+    it->second.encoded[ encoding ] = body;
+}
+
+void
+HNTDResponseCache::invalidate( const std::string &key )
+{
+    Shard &shard = shardFor( key );
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+
+    shard.entries.erase( key );
+}
+
+void
+HNTDResponseCache::clear()
+{
+    for( uint i = 0; i < SHARD_COUNT; i++ )
+    {
+        std::lock_guard< std::mutex > lock( m_shards[i].lock );
+        m_shards[i].entries.clear();
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef __HNTD_RESPONSE_CACHE_H__
+#define __HNTD_RESPONSE_CACHE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "HNTDContentEncoder.h"
+
+// Serialized response bodies are shared read-only between the
+// cache and any requests that are still writing them out.
+typedef std::shared_ptr< const std::string > HNTD_RESPONSE_BODY_T;
+
+// Cache of pre-serialized response bodies keyed by resource.  Each
+// entry is tagged with the version of the resource it was rendered
+// from, a lookup with any other version is a miss so writers only
+// need to advance the resource version to invalidate.  The compressed
+// forms of a body are kept with it and go when it is replaced.
+class HNTDResponseCache
+{
+    private:
+        static const uint SHARD_COUNT = 16;
+
+        typedef struct EntryStruct
+        {
+            uint64_t             version;
+            HNTD_RESPONSE_BODY_T body;
+            HNTD_RESPONSE_BODY_T encoded[ HNTD_ENCODING_COUNT ];
+        }ENTRY_T;
+
+        struct alignas(64) Shard
+        {
+            std::mutex                                 lock;
+            std::unordered_map< std::string, ENTRY_T > entries;
+        };
+
+        Shard m_shards[ SHARD_COUNT ];
+
+        uint m_maxShardEntries;
+
+        Shard& shardFor( const std::string &key );
+
+    public:
+        HNTDResponseCache( uint maxEntries = 65536 );
+       ~HNTDResponseCache();
+
+        // Returns the cached body, or an empty pointer if the
+        // resource is absent or was cached at a different version.
+        HNTD_RESPONSE_BODY_T lookup( const std::string &key, uint64_t version );
+
+        void store( const std::string &key, uint64_t version, const HNTD_RESPONSE_BODY_T &body );
+
+        // Compressed form of the body cached at version, only kept
+        // while that body is
+        HNTD_RESPONSE_BODY_T lookupEncoded( const std::string &key, uint64_t version, HNTD_ENCODING_T encoding );
+        void storeEncoded( const std::string &key, uint64_t version, HNTD_ENCODING_T encoding, const HNTD_RESPONSE_BODY_T &body );
+
+        void invalidate( const std::string &key );
+        void clear();
+};
+
+#endif // __HNTD_RESPONSE_CACHE_H__
@@ -0,0 +1,92 @@
+#include <time.h>
+
+#include "HNTDLog.h"
+#include "HNTDStartupProfile.h"
+
+HNTDStartupProfile::HNTDStartupProfile()
+{
+    m_originNS = nowNS();
+}
+
+HNTDStartupProfile::~HNTDStartupProfile()
+{
+
+}
+
+uint64_t
+HNTDStartupProfile::nowNS()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+void
+HNTDStartupProfile::record( const char *phase, uint64_t durationNS )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    for( std::vector< PHASE_T >::iterator it = m_phases.begin(); it != m_phases.end(); it++ )
+    {
+        if( it->name == phase )
+        {
+            it->totalNS += durationNS;
+            it->count   += 1;
+
+            if( durationNS > it->maxNS )
+                it->maxNS = durationNS;
+
+            return;
+        }
+    }
+
+    PHASE_T entry;
+    entry.name    = phase;
+    entry.totalNS = durationNS;
+    entry.maxNS   = durationNS;
+    entry.count   = 1;
+
+    m_phases.push_back( entry );
+}
+
+uint64_t
+HNTDStartupProfile::getElapsedNS()
+{
+    return nowNS() - m_originNS;
+}
+
+void
+HNTDStartupProfile::report()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    HNTD_LOG_INFO( "Startup profile: %-20s %10s %10s %6s", "phase", "total ms", "max ms", "count" );
+
+    for( std::vector< PHASE_T >::iterator it = m_phases.begin(); it != m_phases.end(); it++ )
+    {
+        HNTD_LOG_INFO( "Startup profile: %-20s %10.3f %10.3f %6u", it->name.c_str(),
+                       (double) it->totalNS / 1000000.0, (double) it->maxNS / 1000000.0, it->count );
+    }
+}
+
+HNTDPhaseTimer::HNTDPhaseTimer( HNTDStartupProfile *profile, const char *phase )
+{
+    m_profile = profile;
+    m_phase   = phase;
+    m_startNS = ( profile != NULL ) ? HNTDStartupProfile::nowNS() : 0;
+}
+
+HNTDPhaseTimer::~HNTDPhaseTimer()
+{
+    end();
+}
+
+void
+HNTDPhaseTimer::end()
+{
+    if( m_profile == NULL )
+        return;
+
+    m_profile->record( m_phase, HNTDStartupProfile::nowNS() - m_startNS );
+    m_profile = NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef __HNTD_STARTUP_PROFILE_H__
+#define __HNTD_STARTUP_PROFILE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+// Time spent in each startup phase.  Devices starting in parallel add
+// to the same phases, which keep their total, slowest run and count,
+// so a fleet reports one line per phase rather than one per device.
+class HNTDStartupProfile
+{
+    private:
+        typedef struct PhaseStruct
+        {
+            std::string name;
+            uint64_t    totalNS;
+            uint64_t    maxNS;
+            uint        count;
+        }PHASE_T;
+
+        std::mutex m_lock;
+
+        uint64_t m_originNS;
+
+        // In the order first seen
+        std::vector< PHASE_T > m_phases;
+
+    public:
+        HNTDStartupProfile();
+       ~HNTDStartupProfile();
+
+        static uint64_t nowNS();
+
+        void record( const char *phase, uint64_t durationNS );
+
+        // Since the profile was created, at process start
+        uint64_t getElapsedNS();
+
+        // Log every phase
+        void report();
+};
+
+// Times one phase from construction to end() or destruction.  A NULL
+// profile makes it a no-op.
+class HNTDPhaseTimer
+{
+    private:
+        HNTDStartupProfile *m_profile;
+        const char         *m_phase;
+        uint64_t            m_startNS;
+
+    public:
+        HNTDPhaseTimer( HNTDStartupProfile *profile, const char *phase );
+       ~HNTDPhaseTimer();
+
+        void end();
+};
+
+#endif // __HNTD_STARTUP_PROFILE_H__
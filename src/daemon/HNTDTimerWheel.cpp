@@ -0,0 +1,384 @@
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "HNTDTimerWheel.h"
+
+#define HNTD_WHEEL_TICK_NS  1000000ULL
+
+static uint64_t
+hntdWheelNowNS()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+HNTDTimer::HNTDTimer()
+{
+    m_prev     = NULL;
+    m_next     = NULL;
+    m_expiry   = 0;
+    m_period   = 0;
+    m_armed    = false;
+    m_level    = 0;
+    m_slot     = 0;
+    m_callback = NULL;
+}
+
+HNTDTimer::~HNTDTimer()
+{
+
+}
+
+void
+HNTDTimer::setCallback( HNTDTimerCallback *callback )
+{
+    m_callback = callback;
+}
+
+bool
+HNTDTimer::isArmed()
+{
+    return m_armed;
+}
+
+HNTDTimerWheel::HNTDTimerWheel()
+{
+    m_timerFD     = -1;
+    m_startNS     = hntdWheelNowNS();
+    m_currentTick = 0;
+    m_wakeTick    = 0;
+    m_armedCount  = 0;
+    m_firedCount  = 0;
+
+    memset( m_slots, 0, sizeof( m_slots ) );
+    memset( m_occupied, 0, sizeof( m_occupied ) );
+}
+
+HNTDTimerWheel::~HNTDTimerWheel()
+{
+    stop();
+}
+
+int
+HNTDTimerWheel::start()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_timerFD >= 0 )
+        return m_timerFD;
+
+    m_timerFD = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    if( m_timerFD < 0 )
+        return -1;
+
+    // Timers armed before the start are due from now
+    m_wakeTick = 0;
+    setWake( nextWakeTick() );
+
+    return m_timerFD;
+}
+
+void
+HNTDTimerWheel::stop()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_timerFD < 0 )
+        return;
+
+    close( m_timerFD );
+    m_timerFD  = -1;
+    m_wakeTick = 0;
+}
+
+bool
+HNTDTimerWheel::isMatch( int fd )
+{
+    return ( ( m_timerFD >= 0 ) && ( fd == m_timerFD ) );
+}
+
+uint64_t
+HNTDTimerWheel::nowTick()
+{
+    return ( hntdWheelNowNS() - m_startNS ) / HNTD_WHEEL_TICK_NS;
+}
+
+void
+HNTDTimerWheel::link( HNTDTimer *timer )
+{
+    uint64_t expiry = timer->m_expiry;
+    if( expiry < m_currentTick )
+        expiry = m_currentTick;
+
+    uint64_t delta = expiry - m_currentTick;
+
+    // The lowest level whose span reaches the expiry
+    uint level = 0;
+    while( ( level < ( LEVEL_COUNT - 1 ) ) && ( delta >= ( 1ULL << ( LEVEL_BITS * ( level + 1 ) ) ) ) )
+        level++;
+
+    // Beyond the top level's span the timer waits in its last slot and
+    // is placed again when that slot comes down
+    uint64_t span = 1ULL << ( LEVEL_BITS * LEVEL_COUNT );
+    if( delta >= span )
+        expiry = m_currentTick + span - 1;
+
+    uint slot = ( expiry >> ( LEVEL_BITS * level ) ) & ( LEVEL_SLOTS - 1 );
+
+    timer->m_level = level;
+    timer->m_slot  = slot;
+    timer->m_prev  = NULL;
+    timer->m_next  = m_slots[ level ][ slot ].head;
+
+    if( timer->m_next != NULL )
+        timer->m_next->m_prev = timer;
+
+    m_slots[ level ][ slot ].head = timer;
+    m_occupied[ level ][ slot / 64 ] |= ( 1ULL << ( slot % 64 ) );
+}
+
+void
+HNTDTimerWheel::unlink( HNTDTimer *timer )
+{
+    SLOT_T &slot = m_slots[ timer->m_level ][ timer->m_slot ];
+
+    if( timer->m_prev != NULL )
+        timer->m_prev->m_next = timer->m_next;
+    else
+        slot.head = timer->m_next;
+
+    if( timer->m_next != NULL )
+        timer->m_next->m_prev = timer->m_prev;
+
+    if( slot.head == NULL )
+        m_occupied[ timer->m_level ][ timer->m_slot / 64 ] &= ~( 1ULL << ( timer->m_slot % 64 ) );
+
+    timer->m_prev = NULL;
+    timer->m_next = NULL;
+}
+
+HNTDTimer*
+HNTDTimerWheel::takeSlot( uint level, uint slot )
+{
+    HNTDTimer *list = m_slots[ level ][ slot ].head;
+
+    m_slots[ level ][ slot ].head = NULL;
+    m_occupied[ level ][ slot / 64 ] &= ~( 1ULL << ( slot % 64 ) );
+
+    return list;
+}
+
+void
+HNTDTimerWheel::cascade( uint level )
+{
+    uint slot = ( m_currentTick >> ( LEVEL_BITS * level ) ) & ( LEVEL_SLOTS - 1 );
+
+    HNTDTimer *timer = takeSlot( level, slot );
+
+    // Every timer moves to a lower level, or stays put if clamped
+    while( timer != NULL )
+    {
+        HNTDTimer *next = timer->m_next;
+        link( timer );
+        timer = next;
+    }
+}
+
+void
+HNTDTimerWheel::advance( uint64_t tick )
+{
+    while( m_currentTick < tick )
+    {
+        // Nothing to move or fire, jump straight to the target
+        if( m_armedCount == 0 )
+        {
+            m_currentTick = tick;
+            break;
+        }
+
+        m_currentTick += 1;
+
+        // Bring the next block of each level down as the level below wraps
+        if( ( m_currentTick & ( LEVEL_SLOTS - 1 ) ) == 0 )
+        {
+            uint level = 1;
+            while( ( level < ( LEVEL_COUNT - 1 ) ) && ( ( ( m_currentTick >> ( LEVEL_BITS * level ) ) & ( LEVEL_SLOTS - 1 ) ) == 0 ) )
+                level++;
+
+            for( ; level >= 1; level-- )
+                cascade( level );
+        }
+
+        HNTDTimer *timer = takeSlot( 0, m_currentTick & ( LEVEL_SLOTS - 1 ) );
+
+        while( timer != NULL )
+        {
+            HNTDTimer *next = timer->m_next;
+
+            timer->m_prev = NULL;
+            timer->m_next = NULL;
+
+            m_firing.push_back( timer );
+
+            // Periodic timers keep their cadence, one-shots are done
+            if( timer->m_period > 0 )
+            {
+                timer->m_expiry += timer->m_period;
+                if( timer->m_expiry <= m_currentTick )
+                    timer->m_expiry = m_currentTick + 1;
+                link( timer );
+            }
+            else
+            {
+                timer->m_armed = false;
+                m_armedCount -= 1;
+            }
+
+            timer = next;
+        }
+    }
+}
+
+uint64_t
+HNTDTimerWheel::nextWakeTick()
+{
+    if( m_armedCount == 0 )
+        return 0;
+
+    // First occupied lowest level slot left in this rotation
+    uint first = ( m_currentTick & ( LEVEL_SLOTS - 1 ) ) + 1;
+
+    for( uint word = first / 64; word < ( LEVEL_SLOTS / 64 ); word++ )
+    {
+        uint64_t bits = m_occupied[ 0 ][ word ];
+
+        if( word == ( first / 64 ) )
+            bits &= ( ( first % 64 ) == 0 ) ? ~0ULL : ~( ( 1ULL << ( first % 64 ) ) - 1 );
+
+        if( bits != 0 )
+            return ( m_currentTick & ~( (uint64_t) LEVEL_SLOTS - 1 ) ) + ( word * 64 ) + __builtin_ctzll( bits );
+    }
+
+    // Otherwise the wrap, where the next block comes down
+    return ( m_currentTick | ( LEVEL_SLOTS - 1 ) ) + 1;
+}
+
+void
+HNTDTimerWheel::setWake( uint64_t tick )
+{
+    if( ( m_timerFD < 0 ) || ( tick == m_wakeTick ) )
+        return;
+
+    m_wakeTick = tick;
+
+    struct itimerspec its;
+    memset( &its, 0, sizeof( its ) );
+
+    // A zero value disarms the timerfd
+    if( tick != 0 )
+    {
+        uint64_t wakeNS = m_startNS + ( tick * HNTD_WHEEL_TICK_NS );
+        its.it_value.tv_sec  = wakeNS / 1000000000ULL;
+        its.it_value.tv_nsec = wakeNS % 1000000000ULL;
+    }
+
+    timerfd_settime( m_timerFD, TFD_TIMER_ABSTIME, &its, NULL );
+}
+
+void
+HNTDTimerWheel::run()
+{
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        if( m_timerFD < 0 )
+            return;
+
+        // Drain the timerfd, what is due comes from the clock.  A run
+        // from the loop timeout finds nothing to read.
+        uint64_t expirations;
+        if( read( m_timerFD, &expirations, sizeof( expirations ) ) < 0 )
+            expirations = 0;
+
+        advance( nowTick() );
+
+        m_firedCount += m_firing.size();
+
+        m_wakeTick = 0;
+        setWake( nextWakeTick() );
+    }
+
+    for( std::vector< HNTDTimer* >::iterator it = m_firing.begin(); it != m_firing.end(); it++ )
+    {
+        if( (*it)->m_callback != NULL )
+            (*it)->m_callback->timerFired( *it );
+    }
+
+    m_firing.clear();
+}
+
+void
+HNTDTimerWheel::arm( HNTDTimer *timer, uint64_t delayMS, uint64_t periodMS )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( timer->m_armed == true )
+        unlink( timer );
+    else
+    {
+        // An idle wheel is not advanced, catch it up before placing
+        if( m_armedCount == 0 )
+            m_currentTick = nowTick();
+
+        m_armedCount += 1;
+    }
+
+    // Round up, the current tick may be almost over
+    timer->m_expiry = nowTick() + delayMS + 1;
+    if( timer->m_expiry <= m_currentTick )
+        timer->m_expiry = m_currentTick + 1;
+
+    timer->m_period = periodMS;
+    timer->m_armed  = true;
+
+    link( timer );
+
+    // Only an earlier deadline needs the timerfd moved
+    if( ( m_wakeTick == 0 ) || ( timer->m_expiry < m_wakeTick ) )
+        setWake( timer->m_expiry );
+}
+
+bool
+HNTDTimerWheel::cancel( HNTDTimer *timer )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( timer->m_armed == false )
+        return false;
+
+    unlink( timer );
+
+    timer->m_armed = false;
+    m_armedCount -= 1;
+
+    return true;
+}
+
+uint64_t
+HNTDTimerWheel::getArmedCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_armedCount;
+}
+
+uint64_t
+HNTDTimerWheel::getFiredCount()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_firedCount;
+}
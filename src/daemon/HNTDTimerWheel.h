@@ -0,0 +1,127 @@
+#ifndef __HNTD_TIMER_WHEEL_H__
+#define __HNTD_TIMER_WHEEL_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <mutex>
+#include <vector>
+
+class HNTDTimer;
+
+// Implemented by timer owners, called on the event loop thread
+class HNTDTimerCallback
+{
+    public:
+        virtual void timerFired( HNTDTimer *timer ) = 0;
+};
+
+// One one-shot or periodic timer.  The storage belongs to the owner
+// and is linked into the wheel while armed, so arming never allocates.
+class HNTDTimer
+{
+    private:
+        friend class HNTDTimerWheel;
+
+        HNTDTimer *m_prev;
+        HNTDTimer *m_next;
+
+        uint64_t m_expiry;
+        uint64_t m_period;
+        bool     m_armed;
+
+        // Position while linked
+        uint     m_level;
+        uint     m_slot;
+
+        HNTDTimerCallback *m_callback;
+
+    public:
+        HNTDTimer();
+       ~HNTDTimer();
+
+        void setCallback( HNTDTimerCallback *callback );
+
+        bool isArmed();
+};
+
+// Hierarchical timer wheel with 1 ms ticks, run from the event loop.
+// Four levels of 256 slots cover 2^32 ms.  A timer is placed on the
+// lowest level whose span reaches its expiry and moves down a level
+// each time the level below wraps, so arming and cancelling are O(1)
+// list operations whatever the number of timers.  The wheel's timerfd
+// is always set to the next point where work may be due, the next
+// occupied slot of the lowest level or its next wrap, so the loop
+// sleeps until then.
+//
+// arm() and cancel() may be called from any thread.  Callbacks run on
+// the loop thread without the wheel lock held; a cancel() that races a
+// firing timer returns false and the callback still runs.
+class HNTDTimerWheel
+{
+    private:
+        static const uint LEVEL_BITS  = 8;
+        static const uint LEVEL_SLOTS = ( 1 << LEVEL_BITS );
+        static const uint LEVEL_COUNT = 4;
+
+        typedef struct SlotStruct
+        {
+            HNTDTimer *head;
+        }SLOT_T;
+
+        std::mutex m_lock;
+
+        int m_timerFD;
+
+        uint64_t m_startNS;
+        uint64_t m_currentTick;
+
+        // Tick the timerfd is set for, 0 when disarmed
+        uint64_t m_wakeTick;
+
+        SLOT_T   m_slots[ LEVEL_COUNT ][ LEVEL_SLOTS ];
+        uint64_t m_occupied[ LEVEL_COUNT ][ LEVEL_SLOTS / 64 ];
+
+        uint64_t m_armedCount;
+        uint64_t m_firedCount;
+
+        // Timers due in the current run(), only touched on the loop thread
+        std::vector< HNTDTimer* > m_firing;
+
+        uint64_t nowTick();
+
+        void link( HNTDTimer *timer );
+        void unlink( HNTDTimer *timer );
+        HNTDTimer* takeSlot( uint level, uint slot );
+
+        void cascade( uint level );
+        void advance( uint64_t tick );
+
+        uint64_t nextWakeTick();
+        void setWake( uint64_t tick );
+
+    public:
+        HNTDTimerWheel();
+       ~HNTDTimerWheel();
+
+        // Returns the timerfd to add to the event loop or -1 on failure
+        int start();
+        void stop();
+
+        bool isMatch( int fd );
+
+        // Fire everything that is due, called when the timerfd is ready
+        void run();
+
+        // periodMS of 0 makes a one-shot timer.  Rearming an armed
+        // timer moves it.
+        void arm( HNTDTimer *timer, uint64_t delayMS, uint64_t periodMS );
+
+        // False if the timer was not armed
+        bool cancel( HNTDTimer *timer );
+
+        uint64_t getArmedCount();
+        uint64_t getFiredCount();
+};
+
+#endif // __HNTD_TIMER_WHEEL_H__
@@ -0,0 +1,92 @@
+#include "HNTDWidgetIndex.h"
+
+HNTDWidgetIndex::HNTDWidgetIndex()
+{
+
+}
+
+HNTDWidgetIndex::~HNTDWidgetIndex()
+{
+
+}
+
+// Empty colors are dropped so a color that is no longer used costs
+// nothing.
+void
+HNTDWidgetIndex::eraseColor( uint64_t id, const std::string &color )
+{
+    std::unordered_map< std::string, std::set< uint64_t > >::iterator it = m_colors.find( color );
+    if( it == m_colors.end() )
+        return;
+
+    it->second.erase( id );
+
+    if( it->second.empty() )
+        m_colors.erase( it );
+}
+
+void
+HNTDWidgetIndex::insert( uint64_t id, const std::string &color )
+{
+    // Ids are handed out in order, so the hints make most inserts O(1)
+    std::set< uint64_t > &colorIDs = m_colors[ color ];
+
+    m_all.insert( m_all.end(), id );
+    colorIDs.insert( colorIDs.end(), id );
+}
+
+void
+HNTDWidgetIndex::recolor( uint64_t id, const std::string &oldColor, const std::string &newColor )
+{
+    if( oldColor == newColor )
+        return;
+
+    eraseColor( id, oldColor );
+    m_colors[ newColor ].insert( id );
+}
+
+void
+HNTDWidgetIndex::erase( uint64_t id, const std::string &color )
+{
+    m_all.erase( id );
+    eraseColor( id, color );
+}
+
+void
+HNTDWidgetIndex::clear()
+{
+    m_all.clear();
+    m_colors.clear();
+}
+
+void
+HNTDWidgetIndex::getIDs( const std::string *color, bool descending, bool hasAfter, uint64_t after, size_t max, std::vector< uint64_t > &ids )
+{
+    ids.clear();
+
+    const std::set< uint64_t > *set = &m_all;
+
+    if( color != NULL )
+    {
+        std::unordered_map< std::string, std::set< uint64_t > >::const_iterator cit = m_colors.find( *color );
+        if( cit == m_colors.end() )
+            return;
+
+        set = &cit->second;
+    }
+
+    if( descending == false )
+    {
+        std::set< uint64_t >::const_iterator it = hasAfter ? set->upper_bound( after ) : set->begin();
+
+        for( ; ( it != set->end() ) && ( ids.size() < max ); it++ )
+            ids.push_back( *it );
+    }
+    else
+    {
+        std::set< uint64_t >::const_reverse_iterator it( hasAfter ? set->lower_bound( after ) : set->end() );
+
+        for( ; ( it != set->rend() ) && ( ids.size() < max ); it++ )
+            ids.push_back( *it );
+    }
+}
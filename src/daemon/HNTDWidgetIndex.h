@@ -0,0 +1,43 @@
+#ifndef __HNTD_WIDGET_INDEX_H__
+#define __HNTD_WIDGET_INDEX_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+// Ordered secondary indexes over one widget store shard, one set of
+// every id and one set per color.  Id ordered pages and color filters
+// are walked from here instead of scanning the shard.  Each shard owns
+// its index and keeps it under the shard lock, so the index has no
+// lock of its own and writers in different shards never meet.
+class HNTDWidgetIndex
+{
+    private:
+        std::set< uint64_t > m_all;
+
+        std::unordered_map< std::string, std::set< uint64_t > > m_colors;
+
+        void eraseColor( uint64_t id, const std::string &color );
+
+    public:
+        HNTDWidgetIndex();
+       ~HNTDWidgetIndex();
+
+        // Cheapest when ids arrive in increasing order
+        void insert( uint64_t id, const std::string &color );
+        void recolor( uint64_t id, const std::string &oldColor, const std::string &newColor );
+        void erase( uint64_t id, const std::string &color );
+
+        void clear();
+
+        // Up to max ids in id order, or reverse id order if descending,
+        // from every widget or those of one color.  With hasAfter set
+        // the walk starts past the after id.
+        void getIDs( const std::string *color, bool descending, bool hasAfter, uint64_t after, size_t max, std::vector< uint64_t > &ids );
+};
+
+#endif // __HNTD_WIDGET_INDEX_H__
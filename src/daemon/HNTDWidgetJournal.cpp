@@ -0,0 +1,890 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <algorithm>
+
+#include "Poco/Checksum.h"
+#include <Poco/File.h>
+#include <Poco/Exception.h>
+
+#include "HNTDLog.h"
+#include "HNTDWidgetJournal.h"
+
+#define HNTDWJ_SNAPSHOT_MAGIC  "HNTDWSN1"
+#define HNTDWJ_LOG_MAGIC       "HNTDWLG1"
+#define HNTDWJ_MAGIC_LEN       8
+
+#define HNTDWJ_FORMAT_VERSION  1
+
+// Snapshot: magic, format, reserved, generation, next id ... records ... count, crc
+#define HNTDWJ_SNAPSHOT_HEADER_LEN   32
+#define HNTDWJ_SNAPSHOT_TRAILER_LEN  12
+
+// Log: magic, generation ... records of length, crc, payload
+#define HNTDWJ_LOG_HEADER_LEN     16
+#define HNTDWJ_RECORD_HEADER_LEN  8
+#define HNTDWJ_PAYLOAD_FIXED_LEN  17
+
+#define HNTDWJ_OP_STORE   1
+#define HNTDWJ_OP_DELETE  2
+
+// Snapshot records are written out in chunks of about this size
+#define HNTDWJ_WRITE_CHUNK  ( 1024 * 1024 )
+
+#define HNTDWJ_FLUSH_INTERVAL_MS  200
+
+// Files are only ever read back on the same host, so integers
+// are stored in host byte order.
+static inline void
+putU32( std::string &buf, uint32_t value )
+{
+    buf.append( (const char *) &value, sizeof( value ) );
+}
+
+static inline void
+putU64( std::string &buf, uint64_t value )
+{
+    buf.append( (const char *) &value, sizeof( value ) );
+}
+
+static inline uint32_t
+getU32( const uint8_t *ptr )
+{
+    uint32_t value;
+    memcpy( &value, ptr, sizeof( value ) );
+    return value;
+}
+
+static inline uint64_t
+getU64( const uint8_t *ptr )
+{
+    uint64_t value;
+    memcpy( &value, ptr, sizeof( value ) );
+    return value;
+}
+
+static uint32_t
+crc32Of( const uint8_t *data, size_t length )
+{
+    Poco::Checksum crc( Poco::Checksum::TYPE_CRC32 );
+    crc.update( (const char *) data, length );
+    return crc.checksum();
+}
+
+static bool
+writeAll( int fd, const char *data, size_t length )
+{
+    while( length > 0 )
+    {
+        ssize_t result = ::write( fd, data, length );
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return false;
+        }
+
+        data   += result;
+        length -= result;
+    }
+
+    return true;
+}
+
+static void
+syncDirectory( const std::string &dir )
+{
+    int fd = ::open( dir.c_str(), O_RDONLY | O_DIRECTORY );
+    if( fd < 0 )
+        return;
+
+    fsync( fd );
+    ::close( fd );
+}
+
+// A read only mapping of a whole file
+class HNTDMappedFile
+{
+    private:
+        int       m_fd;
+        uint8_t  *m_data;
+        uint64_t  m_length;
+
+    public:
+        HNTDMappedFile()
+        {
+            m_fd     = -1;
+            m_data   = NULL;
+            m_length = 0;
+        }
+
+       ~HNTDMappedFile()
+        {
+            if( m_data != NULL )
+                munmap( m_data, m_length );
+
+            if( m_fd >= 0 )
+                ::close( m_fd );
+        }
+
+        // False if the file could not be mapped, exists tells whether it was there
+        bool map( const std::string &path, bool &exists )
+        {
+            exists = false;
+
+            m_fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+            if( m_fd < 0 )
+                return ( errno == ENOENT );
+
+            exists = true;
+
+            struct stat st;
+            if( fstat( m_fd, &st ) != 0 )
+                return false;
+
+            m_length = st.st_size;
+            if( m_length == 0 )
+                return true;
+
+            void *addr = mmap( NULL, m_length, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+            if( addr == MAP_FAILED )
+                return false;
+
+            m_data = (uint8_t *) addr;
+
+            // Loading walks the file once from start to end
+            madvise( m_data, m_length, MADV_SEQUENTIAL );
+
+            return true;
+        }
+
+        const uint8_t* getData() { return m_data; }
+        uint64_t getLength() { return m_length; }
+};
+
+HNTDWidgetJournal::HNTDWidgetJournal()
+{
+    m_store            = NULL;
+    m_fd               = -1;
+    m_generation       = 0;
+    m_logBytes         = 0;
+    m_failed           = false;
+    m_compactThreshold = HNTD_DEFAULT_WIDGET_COMPACT_SIZE;
+    m_snapshotBytes    = 0;
+    m_compactCount     = 0;
+}
+
+HNTDWidgetJournal::~HNTDWidgetJournal()
+{
+    close();
+}
+
+void
+HNTDWidgetJournal::setCompactThreshold( uint64_t bytes )
+{
+    m_compactThreshold = bytes;
+}
+
+std::string
+HNTDWidgetJournal::getSnapshotPath()
+{
+    return m_dir + "/" + m_baseName + ".wsnap";
+}
+
+std::string
+HNTDWidgetJournal::getLogPath( uint64_t generation )
+{
+    return m_dir + "/" + m_baseName + ".wlog." + std::to_string( generation );
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::open( const std::string &dir, const std::string &baseName, HNTDWidgetStore &store )
+{
+    m_dir      = dir;
+    m_baseName = baseName;
+
+    try
+    {
+        Poco::File( m_dir ).createDirectories();
+    }
+    catch( Poco::Exception ex )
+    {
+        HNTD_LOG_ERROR( "%s: Could not create widget data directory %s: %s", m_baseName.c_str(), m_dir.c_str(), ex.displayText().c_str() );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    m_store = &store;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    uint64_t snapGeneration = 0;
+    uint64_t snapCount = 0;
+
+    HNTDWJ_RESULT_T result = loadSnapshot( snapGeneration, snapCount );
+    if( result != HNTDWJ_RESULT_SUCCESS )
+    {
+        m_store = NULL;
+        return result;
+    }
+
+    std::vector< uint64_t > generations;
+    listLogs( generations );
+
+    // Logs older than the snapshot are left over from an interrupted compaction
+    uint64_t logCount = 0;
+    uint64_t validEnd = 0;
+    uint64_t current  = std::max( snapGeneration, (uint64_t) 1 );
+    bool     haveCurrent = false;
+
+    for( std::vector< uint64_t >::iterator it = generations.begin(); it != generations.end(); it++ )
+    {
+        if( *it < snapGeneration )
+            continue;
+
+        result = replayLog( *it, validEnd, logCount );
+        if( result != HNTDWJ_RESULT_SUCCESS )
+        {
+            m_store = NULL;
+            return result;
+        }
+
+        current     = *it;
+        haveCurrent = true;
+    }
+
+    // Continue the newest log, cutting off a record torn by a crash
+    if( ( haveCurrent == true ) && ( validEnd >= HNTDWJ_LOG_HEADER_LEN ) )
+    {
+        m_fd = ::open( getLogPath( current ).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC );
+        if( ( m_fd >= 0 ) && ( ftruncate( m_fd, validEnd ) != 0 ) )
+        {
+            ::close( m_fd );
+            m_fd = -1;
+        }
+        m_logBytes = validEnd;
+    }
+    else
+    {
+        m_fd = createLog( current );
+        m_logBytes = HNTDWJ_LOG_HEADER_LEN;
+    }
+
+    if( m_fd < 0 )
+    {
+        HNTD_LOG_ERROR( "%s: Could not open widget log %s: %s", m_baseName.c_str(), getLogPath( current ).c_str(), strerror( errno ) );
+        m_store = NULL;
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    m_generation = current;
+
+    removeLogsBefore( snapGeneration );
+
+    m_store->addListener( this );
+
+    uint64_t elapsedMS = std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now() - startTime ).count();
+
+    HNTD_LOG_INFO( "%s: Restored %lu widgets (%lu snapshot records, %lu log records) in %lu ms", m_baseName.c_str(),
+                   (unsigned long) m_store->getCount(), (unsigned long) snapCount, (unsigned long) logCount, (unsigned long) elapsedMS );
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+void
+HNTDWidgetJournal::close()
+{
+    if( m_store == NULL )
+        return;
+
+    m_store->removeListener( this );
+
+    flush();
+
+    std::lock_guard< std::mutex > syncLock( m_syncLock );
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_fd >= 0 )
+        ::close( m_fd );
+
+    m_fd    = -1;
+    m_store = NULL;
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::loadSnapshot( uint64_t &generation, uint64_t &count )
+{
+    std::string path = getSnapshotPath();
+
+    HNTDMappedFile file;
+    bool exists;
+
+    generation = 0;
+    count = 0;
+
+    if( file.map( path, exists ) == false )
+    {
+        HNTD_LOG_ERROR( "%s: Could not map widget snapshot %s: %s", m_baseName.c_str(), path.c_str(), strerror( errno ) );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    if( exists == false )
+        return HNTDWJ_RESULT_SUCCESS;
+
+    const uint8_t *data = file.getData();
+    uint64_t length = file.getLength();
+
+    // The snapshot is renamed into place complete, so any damage is real corruption
+    if( ( length < ( HNTDWJ_SNAPSHOT_HEADER_LEN + HNTDWJ_SNAPSHOT_TRAILER_LEN ) )
+        || ( memcmp( data, HNTDWJ_SNAPSHOT_MAGIC, HNTDWJ_MAGIC_LEN ) != 0 )
+        || ( getU32( data + 8 ) != HNTDWJ_FORMAT_VERSION )
+        || ( getU32( data + length - 4 ) != crc32Of( data, length - 4 ) ) )
+    {
+        HNTD_LOG_ERROR( "%s: Widget snapshot %s is damaged, leaving it untouched", m_baseName.c_str(), path.c_str() );
+        return HNTDWJ_RESULT_CORRUPT;
+    }
+
+    generation = getU64( data + 16 );
+    m_store->restoreNextID( getU64( data + 24 ) );
+
+    uint64_t expected = getU64( data + length - HNTDWJ_SNAPSHOT_TRAILER_LEN );
+
+    const uint8_t *pos = data + HNTDWJ_SNAPSHOT_HEADER_LEN;
+    const uint8_t *end = data + length - HNTDWJ_SNAPSHOT_TRAILER_LEN;
+
+    HNTD_WIDGET_T widget;
+
+    while( pos < end )
+    {
+        if( ( end - pos ) < 16 )
+            break;
+
+        widget.id = getU64( pos );
+        uint32_t colorLen = getU32( pos + 8 );
+        uint32_t nameLen  = getU32( pos + 12 );
+        pos += 16;
+
+        if( (uint64_t)( end - pos ) < ( (uint64_t) colorLen + nameLen ) )
+            break;
+
+        widget.color.assign( (const char *) pos, colorLen );
+        pos += colorLen;
+        widget.name.assign( (const char *) pos, nameLen );
+        pos += nameLen;
+
+        m_store->restoreWidget( widget );
+        count += 1;
+    }
+
+    if( ( pos != end ) || ( count != expected ) )
+    {
+        HNTD_LOG_ERROR( "%s: Widget snapshot %s has bad records, leaving it untouched", m_baseName.c_str(), path.c_str() );
+        return HNTDWJ_RESULT_CORRUPT;
+    }
+
+    m_snapshotBytes = length;
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::replayLog( uint64_t generation, uint64_t &validEnd, uint64_t &count )
+{
+    std::string path = getLogPath( generation );
+
+    HNTDMappedFile file;
+    bool exists;
+
+    validEnd = HNTDWJ_LOG_HEADER_LEN;
+
+    if( ( file.map( path, exists ) == false ) || ( exists == false ) )
+    {
+        HNTD_LOG_ERROR( "%s: Could not map widget log %s: %s", m_baseName.c_str(), path.c_str(), strerror( errno ) );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    const uint8_t *data = file.getData();
+    uint64_t length = file.getLength();
+
+    // A log cut short while its header was written holds no records
+    if( length < HNTDWJ_LOG_HEADER_LEN )
+    {
+        validEnd = 0;
+        return HNTDWJ_RESULT_SUCCESS;
+    }
+
+    if( ( memcmp( data, HNTDWJ_LOG_MAGIC, HNTDWJ_MAGIC_LEN ) != 0 ) || ( getU64( data + 8 ) != generation ) )
+    {
+        HNTD_LOG_ERROR( "%s: Widget log %s has a bad header, leaving it untouched", m_baseName.c_str(), path.c_str() );
+        return HNTDWJ_RESULT_CORRUPT;
+    }
+
+    uint64_t pos = HNTDWJ_LOG_HEADER_LEN;
+
+    HNTD_WIDGET_T widget;
+
+    while( ( length - pos ) >= HNTDWJ_RECORD_HEADER_LEN )
+    {
+        uint32_t payloadLen = getU32( data + pos );
+        uint32_t crc        = getU32( data + pos + 4 );
+
+        if( ( payloadLen < HNTDWJ_PAYLOAD_FIXED_LEN ) || ( ( length - pos - HNTDWJ_RECORD_HEADER_LEN ) < payloadLen ) )
+            break;
+
+        const uint8_t *payload = data + pos + HNTDWJ_RECORD_HEADER_LEN;
+
+        if( crc32Of( payload, payloadLen ) != crc )
+            break;
+
+        uint8_t  op       = payload[0];
+        uint32_t colorLen = getU32( payload + 9 );
+        uint32_t nameLen  = getU32( payload + 13 );
+
+        if( ( (uint64_t) HNTDWJ_PAYLOAD_FIXED_LEN + colorLen + nameLen ) != payloadLen )
+            break;
+
+        widget.id = getU64( payload + 1 );
+
+        if( op == HNTDWJ_OP_STORE )
+        {
+            widget.color.assign( (const char *) payload + HNTDWJ_PAYLOAD_FIXED_LEN, colorLen );
+            widget.name.assign( (const char *) payload + HNTDWJ_PAYLOAD_FIXED_LEN + colorLen, nameLen );
+            m_store->restoreWidget( widget );
+        }
+        else if( op == HNTDWJ_OP_DELETE )
+            m_store->restoreDelete( widget.id );
+        else
+            break;
+
+        pos += HNTDWJ_RECORD_HEADER_LEN + payloadLen;
+        count += 1;
+    }
+
+    if( pos != length )
+        HNTD_LOG_WARN( "%s: Widget log %s ends in a partial record, %lu bytes dropped", m_baseName.c_str(), path.c_str(), (unsigned long)( length - pos ) );
+
+    validEnd = pos;
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+void
+HNTDWidgetJournal::listLogs( std::vector< uint64_t > &generations )
+{
+    std::string prefix = m_baseName + ".wlog.";
+
+    generations.clear();
+
+    DIR *dir = opendir( m_dir.c_str() );
+    if( dir == NULL )
+        return;
+
+    struct dirent *entry;
+    while( ( entry = readdir( dir ) ) != NULL )
+    {
+        if( strncmp( entry->d_name, prefix.c_str(), prefix.size() ) != 0 )
+            continue;
+
+        const char *genStr = entry->d_name + prefix.size();
+        char *genEnd;
+
+        uint64_t generation = strtoull( genStr, &genEnd, 10 );
+        if( ( *genStr == '\0' ) || ( *genEnd != '\0' ) )
+            continue;
+
+        generations.push_back( generation );
+    }
+
+    closedir( dir );
+
+    std::sort( generations.begin(), generations.end() );
+}
+
+void
+HNTDWidgetJournal::removeLogsBefore( uint64_t generation )
+{
+    std::vector< uint64_t > generations;
+    listLogs( generations );
+
+    for( std::vector< uint64_t >::iterator it = generations.begin(); it != generations.end(); it++ )
+    {
+        if( *it < generation )
+            unlink( getLogPath( *it ).c_str() );
+    }
+}
+
+int
+HNTDWidgetJournal::createLog( uint64_t generation )
+{
+    int fd = ::open( getLogPath( generation ).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644 );
+    if( fd < 0 )
+        return -1;
+
+    std::string header( HNTDWJ_LOG_MAGIC, HNTDWJ_MAGIC_LEN );
+    putU64( header, generation );
+
+    if( ( writeAll( fd, header.data(), header.size() ) == false ) || ( fdatasync( fd ) != 0 ) )
+    {
+        ::close( fd );
+        return -1;
+    }
+
+    syncDirectory( m_dir );
+
+    return fd;
+}
+
+void
+HNTDWidgetJournal::appendRecord( uint8_t op, const HNTD_WIDGET_T &widget )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_failed == true )
+        return;
+
+    // Delete records carry empty strings
+    const std::string &color = widget.color;
+    const std::string &name  = widget.name;
+
+    uint32_t payloadLen = HNTDWJ_PAYLOAD_FIXED_LEN + color.size() + name.size();
+
+    size_t start = m_buffer.size();
+
+    // Length, crc placeholder, then the payload
+    putU32( m_buffer, payloadLen );
+    putU32( m_buffer, 0 );
+
+    m_buffer.push_back( (char) op );
+    putU64( m_buffer, widget.id );
+    putU32( m_buffer, color.size() );
+    putU32( m_buffer, name.size() );
+    m_buffer.append( color );
+    m_buffer.append( name );
+
+    uint32_t crc = crc32Of( (const uint8_t *) m_buffer.data() + start + HNTDWJ_RECORD_HEADER_LEN, payloadLen );
+    memcpy( &m_buffer[ start + 4 ], &crc, sizeof( crc ) );
+
+    m_logBytes += HNTDWJ_RECORD_HEADER_LEN + payloadLen;
+}
+
+void
+HNTDWidgetJournal::widgetStored( const HNTD_WIDGET_T &widget, bool created )
+{
+    appendRecord( HNTDWJ_OP_STORE, widget );
+}
+
+void
+HNTDWidgetJournal::widgetDeleted( uint64_t id )
+{
+    HNTD_WIDGET_T widget;
+    widget.id = id;
+
+    appendRecord( HNTDWJ_OP_DELETE, widget );
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::flush()
+{
+    std::lock_guard< std::mutex > syncLock( m_syncLock );
+
+    std::string pending;
+    int fd;
+
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        if( ( m_fd < 0 ) || ( m_failed == true ) )
+            return HNTDWJ_RESULT_FAILURE;
+
+        if( m_buffer.empty() )
+            return HNTDWJ_RESULT_SUCCESS;
+
+        pending.swap( m_buffer );
+        fd = m_fd;
+    }
+
+    // Only this thread writes the log, the callbacks keep filling a new buffer
+    if( ( writeAll( fd, pending.data(), pending.size() ) == false ) || ( fdatasync( fd ) != 0 ) )
+    {
+        HNTD_LOG_ERROR( "%s: Widget log write failed, changes are no longer persisted: %s", m_baseName.c_str(), strerror( errno ) );
+
+        std::lock_guard< std::mutex > lock( m_lock );
+        m_failed = true;
+        m_buffer.clear();
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    // Hand the capacity back for the next round
+    pending.clear();
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+        if( m_buffer.empty() )
+            m_buffer.swap( pending );
+    }
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+bool
+HNTDWidgetJournal::needsCompaction()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    // Never rewrite a snapshot larger than the log it replaces
+    return ( m_failed == false ) && ( m_fd >= 0 ) && ( m_logBytes > std::max( m_compactThreshold, m_snapshotBytes ) );
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::compact()
+{
+    std::lock_guard< std::mutex > syncLock( m_syncLock );
+
+    uint64_t next;
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        if( ( m_fd < 0 ) || ( m_failed == true ) )
+            return HNTDWJ_RESULT_FAILURE;
+
+        next = m_generation + 1;
+    }
+
+    int newFD = createLog( next );
+    if( newFD < 0 )
+    {
+        HNTD_LOG_ERROR( "%s: Could not create widget log %s: %s", m_baseName.c_str(), getLogPath( next ).c_str(), strerror( errno ) );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    // Switch logs.  Every change buffered so far is already in the
+    // store, so the snapshot taken below covers it.
+    std::string pending;
+    int oldFD;
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        pending.swap( m_buffer );
+        oldFD        = m_fd;
+        m_fd         = newFD;
+        m_generation = next;
+        m_logBytes   = HNTDWJ_LOG_HEADER_LEN;
+    }
+
+    bool oldComplete = writeAll( oldFD, pending.data(), pending.size() ) && ( fdatasync( oldFD ) == 0 );
+    ::close( oldFD );
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // If the snapshot fails the older logs stay and still replay
+    if( writeSnapshot( next ) != HNTDWJ_RESULT_SUCCESS )
+        return HNTDWJ_RESULT_FAILURE;
+
+    if( oldComplete == false )
+        HNTD_LOG_WARN( "%s: Widget log tail could not be written, the new snapshot covers it", m_baseName.c_str() );
+
+    removeLogsBefore( next );
+
+    m_compactCount += 1;
+
+    uint64_t elapsedMS = std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now() - startTime ).count();
+
+    HNTD_LOG_INFO( "%s: Widget log compacted to generation %lu, %lu byte snapshot in %lu ms", m_baseName.c_str(),
+                   (unsigned long) next, (unsigned long) m_snapshotBytes, (unsigned long) elapsedMS );
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+HNTDWJ_RESULT_T
+HNTDWidgetJournal::writeSnapshot( uint64_t generation )
+{
+    std::string path    = getSnapshotPath();
+    std::string tmpPath = path + ".tmp";
+
+    int fd = ::open( tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+    if( fd < 0 )
+    {
+        HNTD_LOG_ERROR( "%s: Could not create widget snapshot %s: %s", m_baseName.c_str(), tmpPath.c_str(), strerror( errno ) );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    Poco::Checksum crc( Poco::Checksum::TYPE_CRC32 );
+
+    std::string chunk;
+    chunk.reserve( HNTDWJ_WRITE_CHUNK + 4096 );
+
+    chunk.append( HNTDWJ_SNAPSHOT_MAGIC, HNTDWJ_MAGIC_LEN );
+    putU32( chunk, HNTDWJ_FORMAT_VERSION );
+    putU32( chunk, 0 );
+    putU64( chunk, generation );
+    putU64( chunk, m_store->getNextID() );
+
+    uint64_t count = 0;
+    uint64_t total = 0;
+    bool     ok    = true;
+
+    // One shard at a time, so writers are only held off for a copy
+    std::vector< HNTD_WIDGET_T > records;
+
+    for( uint shard = 0; ( shard < HNTDWidgetStore::getShardCount() ) && ( ok == true ); shard++ )
+    {
+        m_store->getShardWidgets( shard, records );
+
+        for( std::vector< HNTD_WIDGET_T >::iterator it = records.begin(); it != records.end(); it++ )
+        {
+            putU64( chunk, it->id );
+            putU32( chunk, it->color.size() );
+            putU32( chunk, it->name.size() );
+            chunk.append( it->color );
+            chunk.append( it->name );
+            count += 1;
+
+            if( chunk.size() >= HNTDWJ_WRITE_CHUNK )
+            {
+                crc.update( chunk.data(), chunk.size() );
+                ok = writeAll( fd, chunk.data(), chunk.size() );
+                total += chunk.size();
+                chunk.clear();
+
+                if( ok == false )
+                    break;
+            }
+        }
+    }
+
+    if( ok == true )
+    {
+        putU64( chunk, count );
+        crc.update( chunk.data(), chunk.size() );
+        putU32( chunk, crc.checksum() );
+
+        ok = writeAll( fd, chunk.data(), chunk.size() ) && ( fsync( fd ) == 0 );
+        total += chunk.size();
+    }
+
+    ::close( fd );
+
+    if( ( ok == false ) || ( rename( tmpPath.c_str(), path.c_str() ) != 0 ) )
+    {
+        HNTD_LOG_ERROR( "%s: Could not write widget snapshot %s: %s", m_baseName.c_str(), path.c_str(), strerror( errno ) );
+        unlink( tmpPath.c_str() );
+        return HNTDWJ_RESULT_FAILURE;
+    }
+
+    syncDirectory( m_dir );
+
+    m_snapshotBytes = total;
+
+    return HNTDWJ_RESULT_SUCCESS;
+}
+
+uint64_t
+HNTDWidgetJournal::getGeneration()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_generation;
+}
+
+uint64_t
+HNTDWidgetJournal::getLogBytes()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    return m_logBytes;
+}
+
+uint64_t
+HNTDWidgetJournal::getCompactCount()
+{
+    std::lock_guard< std::mutex > syncLock( m_syncLock );
+
+    return m_compactCount;
+}
+
+HNTDJournalFlusher::HNTDJournalFlusher()
+{
+    m_running = false;
+}
+
+HNTDJournalFlusher::~HNTDJournalFlusher()
+{
+    stop();
+}
+
+void
+HNTDJournalFlusher::start()
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    if( m_running == true )
+        return;
+
+    m_running = true;
+
+    m_thread = std::thread( &HNTDJournalFlusher::flushLoop, this );
+}
+
+void
+HNTDJournalFlusher::stop()
+{
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+
+        if( m_running == false )
+            return;
+
+        m_running = false;
+    }
+
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+void
+HNTDJournalFlusher::addJournal( HNTDWidgetJournal *journal )
+{
+    std::lock_guard< std::mutex > lock( m_lock );
+
+    m_journals.push_back( journal );
+}
+
+void
+HNTDJournalFlusher::flushLoop()
+{
+    std::unique_lock< std::mutex > lock( m_lock );
+
+    while( true )
+    {
+        bool running = m_running;
+
+        if( running == true )
+        {
+            m_wakeup.wait_for( lock, std::chrono::milliseconds( HNTDWJ_FLUSH_INTERVAL_MS ) );
+            running = m_running;
+        }
+
+        std::vector< HNTDWidgetJournal* > journals = m_journals;
+        lock.unlock();
+
+        for( std::vector< HNTDWidgetJournal* >::iterator it = journals.begin(); it != journals.end(); it++ )
+        {
+            HNTDWidgetJournal *journal = *it;
+
+            journal->flush();
+
+            if( ( running == true ) && ( journal->needsCompaction() == true ) )
+                journal->compact();
+        }
+
+        lock.lock();
+
+        if( running == false )
+            break;
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef __HNTD_WIDGET_JOURNAL_H__
+#define __HNTD_WIDGET_JOURNAL_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "HNTDWidgetStore.h"
+
+#define HNTD_DEFAULT_WIDGET_COMPACT_SIZE  ( 64 * 1024 * 1024 )
+
+typedef enum HNTDWidgetJournalResultEnum
+{
+  HNTDWJ_RESULT_SUCCESS,
+  HNTDWJ_RESULT_FAILURE,
+  HNTDWJ_RESULT_CORRUPT
+}HNTDWJ_RESULT_T;
+
+// Durable widget state for one device.  The store is kept on disk as
+// a binary snapshot plus an append-only log of the changes made since
+// the snapshot was taken.  Every log record carries the full state of
+// the widget, so replaying a record twice is harmless.
+//
+// On open the snapshot is memory mapped and loaded, the logs are
+// replayed in generation order and a torn record at the tail of the
+// newest log is cut off.  Changes are encoded into a memory buffer
+// while the store's shard lock is held, the journal flusher thread
+// writes and syncs the buffer and, once the log outgrows the
+// threshold, rotates to a new log generation and writes a fresh
+// snapshot from a copy of the store.
+//
+//   <instance>.wsnap        snapshot, covers the logs before its generation
+//   <instance>.wlog.<gen>   log generations, replayed oldest first
+class HNTDWidgetJournal : public HNTDWidgetStoreListener
+{
+    private:
+        std::string m_dir;
+        std::string m_baseName;
+
+        HNTDWidgetStore *m_store;
+
+        // Guards the buffer and the current log, taken by the store callbacks
+        std::mutex  m_lock;
+        std::string m_buffer;
+        int         m_fd;
+        uint64_t    m_generation;
+        uint64_t    m_logBytes;
+        bool        m_failed;
+
+        // Serializes flush, compaction and close
+        std::mutex  m_syncLock;
+
+        uint64_t m_compactThreshold;
+        uint64_t m_snapshotBytes;
+        uint64_t m_compactCount;
+
+        std::string getSnapshotPath();
+        std::string getLogPath( uint64_t generation );
+
+        void appendRecord( uint8_t op, const HNTD_WIDGET_T &widget );
+
+        HNTDWJ_RESULT_T loadSnapshot( uint64_t &generation, uint64_t &count );
+        HNTDWJ_RESULT_T replayLog( uint64_t generation, uint64_t &validEnd, uint64_t &count );
+        void listLogs( std::vector< uint64_t > &generations );
+        void removeLogsBefore( uint64_t generation );
+
+        int createLog( uint64_t generation );
+        HNTDWJ_RESULT_T writeSnapshot( uint64_t generation );
+
+    public:
+        HNTDWidgetJournal();
+       ~HNTDWidgetJournal();
+
+        void setCompactThreshold( uint64_t bytes );
+
+        // Load the persisted state into an empty store and start
+        // logging its changes.  Nothing is written if this fails.
+        HNTDWJ_RESULT_T open( const std::string &dir, const std::string &baseName, HNTDWidgetStore &store );
+
+        // Write out anything buffered and release the log
+        void close();
+
+        // Write the buffered records to the log and sync it
+        HNTDWJ_RESULT_T flush();
+
+        bool needsCompaction();
+
+        // Start a new log generation and snapshot the store
+        HNTDWJ_RESULT_T compact();
+
+        // HNTDWidgetStoreListener
+        virtual void widgetStored( const HNTD_WIDGET_T &widget, bool created );
+        virtual void widgetDeleted( uint64_t id );
+
+        uint64_t getGeneration();
+        uint64_t getLogBytes();
+        uint64_t getCompactCount();
+};
+
+// One background thread that flushes and compacts the widget
+// journals of every device in the process.
+class HNTDJournalFlusher
+{
+    private:
+        std::mutex              m_lock;
+        std::condition_variable m_wakeup;
+        std::thread             m_thread;
+
+        bool m_running;
+
+        std::vector< HNTDWidgetJournal* > m_journals;
+
+        void flushLoop();
+
+    public:
+        HNTDJournalFlusher();
+       ~HNTDJournalFlusher();
+
+        void start();
+
+        // Flush every journal one last time and stop the thread
+        void stop();
+
+        void addJournal( HNTDWidgetJournal *journal );
+};
+
+#endif // __HNTD_WIDGET_JOURNAL_H__
@@ -0,0 +1,782 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <mutex>
+#include <queue>
+
+#include "HNTDWidgetStore.h"
+
+#define HNTDWS_INITIAL_SLOTS  64
+
+// Ids read from the index at a time by an id ordered query
+#define HNTDWS_QUERY_BATCH    256
+
+// Extra ids read from each shard's index per merge step, above its share
+#define HNTDWS_MERGE_CHUNK    32
+
+// Indexed by HNTD_WIDGET_SORT_T, tags the sort a cursor was made for
+static const char g_HNTDWSSortCodes[] = { 'i', 'n', 'c' };
+
+// splitmix64 finalizer, the low bits pick the slot within a
+// shard and the top bits pick the shard.
+static inline uint64_t
+hntdwsHash( uint64_t key )
+{
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+HNTDWidgetShard::HNTDWidgetShard()
+{
+    m_slots.resize( HNTDWS_INITIAL_SLOTS, SLOT_T{ 0, 0 } );
+    m_mask = HNTDWS_INITIAL_SLOTS - 1;
+}
+
+HNTDWidgetShard::~HNTDWidgetShard()
+{
+
+}
+
+std::shared_mutex&
+HNTDWidgetShard::getLock()
+{
+    return m_lock;
+}
+
+bool
+HNTDWidgetShard::findSlot( uint64_t key, uint64_t &slot )
+{
+    slot = hntdwsHash( key ) & m_mask;
+
+    while( m_slots[ slot ].key != 0 )
+    {
+        if( m_slots[ slot ].key == key )
+            return true;
+
+        slot = ( slot + 1 ) & m_mask;
+    }
+
+    // slot is the empty position where key would be placed
+    return false;
+}
+
+void
+HNTDWidgetShard::growSlots()
+{
+    std::vector< SLOT_T > oldSlots( ( m_mask + 1 ) * 2, SLOT_T{ 0, 0 } );
+
+    oldSlots.swap( m_slots );
+    m_mask = m_slots.size() - 1;
+
+    for( std::vector< SLOT_T >::iterator it = oldSlots.begin(); it != oldSlots.end(); it++ )
+    {
+        if( it->key == 0 )
+            continue;
+
+        uint64_t slot;
+        findSlot( it->key, slot );
+        m_slots[ slot ] = *it;
+    }
+}
+
+void
+HNTDWidgetShard::eraseSlot( uint64_t slot )
+{
+    // Backward shift deletion keeps probe chains intact without tombstones
+    uint64_t hole = slot;
+    uint64_t next = ( slot + 1 ) & m_mask;
+
+    while( m_slots[ next ].key != 0 )
+    {
+        uint64_t home = hntdwsHash( m_slots[ next ].key ) & m_mask;
+
+        // Move the entry into the hole if its home position
+        // is not cyclically within (hole, next]
+        if( ( ( next - home ) & m_mask ) >= ( ( next - hole ) & m_mask ) )
+        {
+            m_slots[ hole ] = m_slots[ next ];
+            hole = next;
+        }
+
+        next = ( next + 1 ) & m_mask;
+    }
+
+    m_slots[ hole ].key   = 0;
+    m_slots[ hole ].index = 0;
+}
+
+HNTD_WIDGET_T*
+HNTDWidgetShard::find( uint64_t key )
+{
+    uint64_t slot;
+
+    if( findSlot( key, slot ) == false )
+        return NULL;
+
+    return &m_records[ m_slots[ slot ].index ];
+}
+
+HNTD_WIDGET_T*
+HNTDWidgetShard::insert( const HNTD_WIDGET_T &widget )
+{
+    uint64_t slot;
+
+    if( findSlot( widget.id, slot ) == true )
+    {
+        m_records[ m_slots[ slot ].index ] = widget;
+        return &m_records[ m_slots[ slot ].index ];
+    }
+
+    // Keep the load factor under 3/4
+    if( ( m_records.size() + 1 ) * 4 > ( m_mask + 1 ) * 3 )
+    {
+        growSlots();
+        findSlot( widget.id, slot );
+    }
+
+    m_slots[ slot ].key   = widget.id;
+    m_slots[ slot ].index = m_records.size();
+    m_records.push_back( widget );
+
+    return &m_records.back();
+}
+
+bool
+HNTDWidgetShard::erase( uint64_t key )
+{
+    uint64_t slot;
+
+    if( findSlot( key, slot ) == false )
+        return false;
+
+    uint32_t index = m_slots[ slot ].index;
+    eraseSlot( slot );
+
+    // Keep the records dense by moving the last record into the gap.
+    uint32_t last = m_records.size() - 1;
+    if( index != last )
+    {
+        uint64_t movedKey = m_records[ last ].id;
+        uint64_t movedSlot;
+
+        findSlot( movedKey, movedSlot );
+        m_slots[ movedSlot ].index = index;
+
+        m_records[ index ] = std::move( m_records[ last ] );
+    }
+
+    m_records.pop_back();
+
+    return true;
+}
+
+const std::vector< HNTD_WIDGET_T >&
+HNTDWidgetShard::getRecords()
+{
+    return m_records;
+}
+
+HNTDWidgetIndex&
+HNTDWidgetShard::getIndex()
+{
+    return m_index;
+}
+
+void
+HNTDWidgetShard::rebuildIndex()
+{
+    // In id order every insert lands at the end of its sets
+    std::vector< const HNTD_WIDGET_T* > sorted;
+    sorted.reserve( m_records.size() );
+
+    for( std::vector< HNTD_WIDGET_T >::const_iterator it = m_records.begin(); it != m_records.end(); it++ )
+        sorted.push_back( &( *it ) );
+
+    std::sort( sorted.begin(), sorted.end(), []( const HNTD_WIDGET_T *a, const HNTD_WIDGET_T *b ) { return a->id < b->id; } );
+
+    m_index.clear();
+
+    for( std::vector< const HNTD_WIDGET_T* >::iterator it = sorted.begin(); it != sorted.end(); it++ )
+        m_index.insert( ( *it )->id, ( *it )->color );
+}
+
+HNTDWidgetStore::HNTDWidgetStore()
+: m_nextID( 1 ), m_count( 0 ), m_version( 0 )
+{
+
+}
+
+HNTDWidgetStore::~HNTDWidgetStore()
+{
+
+}
+
+HNTDWidgetShard&
+HNTDWidgetStore::shardFor( uint64_t id )
+{
+    return m_shards[ hntdwsHash( id ) >> ( 64 - SHARD_BITS ) ];
+}
+
+uint
+HNTDWidgetStore::getShardCount()
+{
+    return SHARD_COUNT;
+}
+
+void
+HNTDWidgetStore::addListener( HNTDWidgetStoreListener *listener )
+{
+    m_listeners.push_back( listener );
+}
+
+void
+HNTDWidgetStore::removeListener( HNTDWidgetStoreListener *listener )
+{
+    m_listeners.erase( std::remove( m_listeners.begin(), m_listeners.end(), listener ), m_listeners.end() );
+}
+
+std::string
+HNTDWidgetStore::formatID( uint64_t id )
+{
+    return "w" + std::to_string( id );
+}
+
+bool
+HNTDWidgetStore::parseID( const std::string &widgetID, uint64_t &id )
+{
+    if( ( widgetID.size() < 2 ) || ( widgetID.size() > 21 ) || ( widgetID[0] != 'w' ) )
+        return false;
+
+    id = 0;
+    for( std::string::const_iterator it = widgetID.begin() + 1; it != widgetID.end(); it++ )
+    {
+        if( ( *it < '0' ) || ( *it > '9' ) )
+            return false;
+
+        // Past UINT64_MAX the id would wrap onto a real widget
+        uint digit = *it - '0';
+        if( id > ( ( UINT64_MAX - digit ) / 10 ) )
+            return false;
+
+        id = ( id * 10 ) + digit;
+    }
+
+    return ( id != 0 );
+}
+
+HNTDWS_RESULT_T
+HNTDWidgetStore::createWidget( const HNTD_WIDGET_FIELDS_T &fields, HNTD_WIDGET_T &result )
+{
+    result.id    = m_nextID.fetch_add( 1, std::memory_order_relaxed );
+    result.color = fields.hasColor ? fields.color : "black";
+    result.name  = fields.hasName ? fields.name : "";
+
+    HNTDWidgetShard &shard = shardFor( result.id );
+
+    std::unique_lock< std::shared_mutex > lock( shard.getLock() );
+
+    result.version = m_version.fetch_add( 1 ) + 1;
+    shard.insert( result );
+
+    shard.getIndex().insert( result.id, result.color );
+
+    m_count.fetch_add( 1, std::memory_order_relaxed );
+
+    for( std::vector< HNTDWidgetStoreListener* >::iterator it = m_listeners.begin(); it != m_listeners.end(); it++ )
+        (*it)->widgetStored( result, true );
+
+    return HNTDWS_RESULT_SUCCESS;
+}
+
+HNTDWS_RESULT_T
+HNTDWidgetStore::getWidget( const std::string &widgetID, HNTD_WIDGET_T &result )
+{
+    uint64_t id;
+
+    if( parseID( widgetID, id ) == false )
+        return HNTDWS_RESULT_BAD_ID;
+
+    HNTDWidgetShard &shard = shardFor( id );
+
+    std::shared_lock< std::shared_mutex > lock( shard.getLock() );
+
+    HNTD_WIDGET_T *widget = shard.find( id );
+    if( widget == NULL )
+        return HNTDWS_RESULT_NOT_FOUND;
+
+    result = *widget;
+
+    return HNTDWS_RESULT_SUCCESS;
+}
+
+HNTDWS_RESULT_T
+HNTDWidgetStore::updateWidget( const std::string &widgetID, const HNTD_WIDGET_FIELDS_T &fields, HNTD_WIDGET_T &result )
+{
+    uint64_t id;
+
+    if( parseID( widgetID, id ) == false )
+        return HNTDWS_RESULT_BAD_ID;
+
+    HNTDWidgetShard &shard = shardFor( id );
+
+    std::unique_lock< std::shared_mutex > lock( shard.getLock() );
+
+    HNTD_WIDGET_T *widget = shard.find( id );
+    if( widget == NULL )
+        return HNTDWS_RESULT_NOT_FOUND;
+
+    if( fields.hasColor )
+    {
+        shard.getIndex().recolor( id, widget->color, fields.color );
+        widget->color = fields.color;
+    }
+
+    if( fields.hasName )
+        widget->name = fields.name;
+
+    widget->version = m_version.fetch_add( 1 ) + 1;
+
+    result = *widget;
+
+    for( std::vector< HNTDWidgetStoreListener* >::iterator it = m_listeners.begin(); it != m_listeners.end(); it++ )
+        (*it)->widgetStored( result, false );
+
+    return HNTDWS_RESULT_SUCCESS;
+}
+
+HNTDWS_RESULT_T
+HNTDWidgetStore::deleteWidget( const std::string &widgetID )
+{
+    uint64_t id;
+
+    if( parseID( widgetID, id ) == false )
+        return HNTDWS_RESULT_BAD_ID;
+
+    HNTDWidgetShard &shard = shardFor( id );
+
+    std::unique_lock< std::shared_mutex > lock( shard.getLock() );
+
+    HNTD_WIDGET_T *widget = shard.find( id );
+    if( widget == NULL )
+        return HNTDWS_RESULT_NOT_FOUND;
+
+    shard.getIndex().erase( id, widget->color );
+    shard.erase( id );
+
+    m_version.fetch_add( 1 );
+
+    m_count.fetch_sub( 1, std::memory_order_relaxed );
+
+    for( std::vector< HNTDWidgetStoreListener* >::iterator it = m_listeners.begin(); it != m_listeners.end(); it++ )
+        (*it)->widgetDeleted( id );
+
+    return HNTDWS_RESULT_SUCCESS;
+}
+
+void
+HNTDWidgetStore::getWidgetList( std::vector< HNTD_WIDGET_T > &list )
+{
+    list.clear();
+    list.reserve( m_count.load( std::memory_order_relaxed ) );
+
+    for( uint i = 0; i < SHARD_COUNT; i++ )
+    {
+        std::shared_lock< std::shared_mutex > lock( m_shards[i].getLock() );
+
+        const std::vector< HNTD_WIDGET_T > &records = m_shards[i].getRecords();
+        list.insert( list.end(), records.begin(), records.end() );
+    }
+
+    std::sort( list.begin(), list.end(), []( const HNTD_WIDGET_T &a, const HNTD_WIDGET_T &b ) { return a.id < b.id; } );
+}
+
+bool
+HNTDWidgetStore::fetchWidget( uint64_t id, HNTD_WIDGET_T &result )
+{
+    HNTDWidgetShard &shard = shardFor( id );
+
+    std::shared_lock< std::shared_mutex > lock( shard.getLock() );
+
+    HNTD_WIDGET_T *widget = shard.find( id );
+    if( widget == NULL )
+        return false;
+
+    result = *widget;
+
+    return true;
+}
+
+bool
+HNTDWidgetStore::queryMatch( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget )
+{
+    if( ( query.hasColor == true ) && ( widget.color != query.color ) )
+        return false;
+
+    if( ( query.hasName == true ) && ( widget.name != query.name ) )
+        return false;
+
+    return true;
+}
+
+const std::string&
+HNTDWidgetStore::getSortKey( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget )
+{
+    return ( query.sort == HNTD_WIDGET_SORT_COLOR ) ? widget.color : widget.name;
+}
+
+// A k-way merge of the shard indexes.  Each shard is read a chunk at a
+// time under its own lock, so writers elsewhere are never held up, and
+// a chunk that runs out is refilled from past its last id.
+void
+HNTDWidgetStore::getIndexIDs( const std::string *color, bool descending, bool hasAfter, uint64_t after, size_t max, std::vector< uint64_t > &ids )
+{
+    ids.clear();
+
+    if( max == 0 )
+        return;
+
+    size_t chunkSize = ( max / SHARD_COUNT ) + HNTDWS_MERGE_CHUNK;
+    if( chunkSize > max )
+        chunkSize = max;
+
+    std::vector< uint64_t > chunks[ SHARD_COUNT ];
+    size_t                  positions[ SHARD_COUNT ];
+
+    // Smallest id on top, or largest when descending
+    auto later = [descending]( const std::pair< uint64_t, uint > &a, const std::pair< uint64_t, uint > &b )
+    {
+        return ( descending == true ) ? ( a.first < b.first ) : ( a.first > b.first );
+    };
+
+    std::priority_queue< std::pair< uint64_t, uint >, std::vector< std::pair< uint64_t, uint > >, decltype( later ) > heads( later );
+
+    for( uint i = 0; i < SHARD_COUNT; i++ )
+    {
+        {
+            std::shared_lock< std::shared_mutex > lock( m_shards[i].getLock() );
+            m_shards[i].getIndex().getIDs( color, descending, hasAfter, after, chunkSize, chunks[i] );
+        }
+
+        positions[i] = 0;
+
+        if( chunks[i].empty() == false )
+            heads.push( std::make_pair( chunks[i][0], i ) );
+    }
+
+    while( ( heads.empty() == false ) && ( ids.size() < max ) )
+    {
+        uint64_t id    = heads.top().first;
+        uint     shard = heads.top().second;
+        heads.pop();
+
+        ids.push_back( id );
+
+        positions[ shard ] += 1;
+
+        // A short chunk was the rest of the shard
+        if( positions[ shard ] == chunks[ shard ].size() )
+        {
+            if( chunks[ shard ].size() < chunkSize )
+                continue;
+
+            std::shared_lock< std::shared_mutex > lock( m_shards[ shard ].getLock() );
+            m_shards[ shard ].getIndex().getIDs( color, descending, true, id, chunkSize, chunks[ shard ] );
+
+            positions[ shard ] = 0;
+        }
+
+        if( positions[ shard ] < chunks[ shard ].size() )
+            heads.push( std::make_pair( chunks[ shard ][ positions[ shard ] ], shard ) );
+    }
+}
+
+void
+HNTDWidgetStore::queryWidgets( const HNTD_WIDGET_QUERY_T &query, std::vector< HNTD_WIDGET_T > &page, bool &more )
+{
+    page.clear();
+    more = false;
+
+    // One past the limit tells if there is another page
+    size_t want = ( query.limit == 0 ) ? SIZE_MAX : ( (size_t) query.limit + 1 );
+
+    if( query.sort == HNTD_WIDGET_SORT_ID )
+    {
+        // Walk the index in batches.  The name filter, and widgets
+        // changed since the index was read, can drop some of a batch.
+        const std::string *color = ( query.hasColor == true ) ? &query.color : NULL;
+
+        bool     hasAfter = query.hasAfter;
+        uint64_t after    = query.afterID;
+
+        std::vector< uint64_t > ids;
+
+        while( page.size() < want )
+        {
+            size_t batch = HNTDWS_QUERY_BATCH;
+            if( ( query.hasName == false ) && ( ( want - page.size() ) < batch ) )
+                batch = want - page.size();
+
+            getIndexIDs( color, query.descending, hasAfter, after, batch, ids );
+
+            for( std::vector< uint64_t >::iterator it = ids.begin(); ( it != ids.end() ) && ( page.size() < want ); it++ )
+            {
+                HNTD_WIDGET_T widget;
+
+                if( ( fetchWidget( *it, widget ) == true ) && ( queryMatch( query, widget ) == true ) )
+                    page.push_back( widget );
+            }
+
+            if( ids.size() < batch )
+                break;
+
+            hasAfter = true;
+            after    = ids.back();
+        }
+    }
+    else
+    {
+        // Name and color order need every candidate before a page can
+        // be picked, the color index still narrows down the candidates.
+        std::vector< HNTD_WIDGET_T > matches;
+
+        if( query.hasColor == true )
+        {
+            std::vector< uint64_t > ids;
+            getIndexIDs( &query.color, false, false, 0, SIZE_MAX, ids );
+
+            matches.reserve( ids.size() );
+            for( std::vector< uint64_t >::iterator it = ids.begin(); it != ids.end(); it++ )
+            {
+                HNTD_WIDGET_T widget;
+
+                if( ( fetchWidget( *it, widget ) == true ) && ( queryMatch( query, widget ) == true ) )
+                    matches.push_back( widget );
+            }
+        }
+        else
+        {
+            for( uint i = 0; i < SHARD_COUNT; i++ )
+            {
+                std::shared_lock< std::shared_mutex > lock( m_shards[i].getLock() );
+
+                const std::vector< HNTD_WIDGET_T > &records = m_shards[i].getRecords();
+                for( std::vector< HNTD_WIDGET_T >::const_iterator it = records.begin(); it != records.end(); it++ )
+                {
+                    if( queryMatch( query, *it ) == true )
+                        matches.push_back( *it );
+                }
+            }
+        }
+
+        // Sort key then id, both reversed for a descending sort
+        auto before = [&query]( const HNTD_WIDGET_T &a, const HNTD_WIDGET_T &b )
+        {
+            int cmp = getSortKey( query, a ).compare( getSortKey( query, b ) );
+            if( cmp == 0 )
+                return ( query.descending == true ) ? ( a.id > b.id ) : ( a.id < b.id );
+
+            return ( query.descending == true ) ? ( cmp > 0 ) : ( cmp < 0 );
+        };
+
+        if( query.hasAfter == true )
+        {
+            HNTD_WIDGET_T position;
+            position.id = query.afterID;
+
+            if( query.sort == HNTD_WIDGET_SORT_COLOR )
+                position.color = query.afterKey;
+            else
+                position.name = query.afterKey;
+
+            matches.erase( std::remove_if( matches.begin(), matches.end(),
+                           [&before, &position]( const HNTD_WIDGET_T &w ) { return ( before( position, w ) == false ); } ),
+                           matches.end() );
+        }
+
+        // Only the page itself has to be put in order
+        if( matches.size() > want )
+        {
+            std::partial_sort( matches.begin(), matches.begin() + want, matches.end(), before );
+            matches.resize( want );
+        }
+        else
+            std::sort( matches.begin(), matches.end(), before );
+
+        page.swap( matches );
+    }
+
+    if( ( query.limit != 0 ) && ( page.size() > query.limit ) )
+    {
+        page.pop_back();
+        more = true;
+    }
+}
+
+// The cursor is the hex encoding of the sort and direction, the id
+// and, for name or color order, the sort key.
+std::string
+HNTDWidgetStore::makeCursor( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget )
+{
+    static const char *hexDigits = "0123456789abcdef";
+
+    std::string plain;
+    plain += g_HNTDWSSortCodes[ query.sort ];
+    plain += ( query.descending == true ) ? '-' : '+';
+    plain += std::to_string( widget.id );
+    plain += ':';
+
+    if( query.sort != HNTD_WIDGET_SORT_ID )
+        plain += getSortKey( query, widget );
+
+    std::string cursor;
+    cursor.reserve( plain.size() * 2 );
+
+    for( std::string::iterator it = plain.begin(); it != plain.end(); it++ )
+    {
+        cursor += hexDigits[ ( (uint8_t) *it ) >> 4 ];
+        cursor += hexDigits[ ( (uint8_t) *it ) & 0xF ];
+    }
+
+    return cursor;
+}
+
+bool
+HNTDWidgetStore::parseCursor( const std::string &cursor, HNTD_WIDGET_QUERY_T &query )
+{
+    if( ( cursor.empty() == true ) || ( ( cursor.size() & 1 ) != 0 ) )
+        return false;
+
+    std::string plain;
+    plain.reserve( cursor.size() / 2 );
+
+    for( std::string::size_type i = 0; i < cursor.size(); i += 2 )
+    {
+        uint8_t byte = 0;
+
+        for( uint j = 0; j < 2; j++ )
+        {
+            char c = cursor[ i + j ];
+
+            byte <<= 4;
+            if( ( c >= '0' ) && ( c <= '9' ) )
+                byte |= c - '0';
+            else if( ( c >= 'a' ) && ( c <= 'f' ) )
+                byte |= c - 'a' + 10;
+            else
+                return false;
+        }
+
+        plain += (char) byte;
+    }
+
+    // A cursor only resumes the sort it was made for
+    if( ( plain.size() < 4 ) || ( plain[0] != g_HNTDWSSortCodes[ query.sort ] ) || ( plain[1] != ( query.descending ? '-' : '+' ) ) )
+        return false;
+
+    std::string::size_type colon = plain.find( ':', 2 );
+    if( ( colon == std::string::npos ) || ( colon == 2 ) || ( colon > 22 ) )
+        return false;
+
+    uint64_t id = 0;
+    for( std::string::size_type i = 2; i < colon; i++ )
+    {
+        if( ( plain[i] < '0' ) || ( plain[i] > '9' ) )
+            return false;
+
+        // A wrapped id would resume the page at the wrong widget
+        uint digit = plain[i] - '0';
+        if( id > ( ( UINT64_MAX - digit ) / 10 ) )
+            return false;
+
+        id = ( id * 10 ) + digit;
+    }
+
+    query.hasAfter = true;
+    query.afterID  = id;
+    query.afterKey = plain.substr( colon + 1 );
+
+    return true;
+}
+
+void
+HNTDWidgetStore::getShardWidgets( uint shard, std::vector< HNTD_WIDGET_T > &list )
+{
+    std::shared_lock< std::shared_mutex > lock( m_shards[ shard ].getLock() );
+
+    list = m_shards[ shard ].getRecords();
+}
+
+void
+HNTDWidgetStore::restoreWidget( const HNTD_WIDGET_T &widget )
+{
+    HNTDWidgetShard &shard = shardFor( widget.id );
+
+    std::unique_lock< std::shared_mutex > lock( shard.getLock() );
+
+    HNTD_WIDGET_T record = widget;
+    record.version = m_version.fetch_add( 1 ) + 1;
+
+    if( shard.find( widget.id ) == NULL )
+        m_count.fetch_add( 1, std::memory_order_relaxed );
+
+    shard.insert( record );
+
+    // Ids are never reused, even those of restored widgets deleted later
+    restoreNextID( widget.id + 1 );
+}
+
+void
+HNTDWidgetStore::restoreDelete( uint64_t id )
+{
+    HNTDWidgetShard &shard = shardFor( id );
+
+    std::unique_lock< std::shared_mutex > lock( shard.getLock() );
+
+    if( shard.erase( id ) == true )
+    {
+        m_version.fetch_add( 1 );
+        m_count.fetch_sub( 1, std::memory_order_relaxed );
+    }
+
+    restoreNextID( id + 1 );
+}
+
+void
+HNTDWidgetStore::rebuildIndex()
+{
+    for( uint i = 0; i < SHARD_COUNT; i++ )
+    {
+        std::unique_lock< std::shared_mutex > lock( m_shards[i].getLock() );
+
+        m_shards[i].rebuildIndex();
+    }
+}
+
+void
+HNTDWidgetStore::restoreNextID( uint64_t nextID )
+{
+    uint64_t current = m_nextID.load();
+    while( ( current < nextID ) && ( m_nextID.compare_exchange_weak( current, nextID ) == false ) );
+}
+
+uint64_t
+HNTDWidgetStore::getNextID()
+{
+    return m_nextID.load();
+}
+
+uint64_t
+HNTDWidgetStore::getCount()
+{
+    return m_count.load( std::memory_order_relaxed );
+}
+
+uint64_t
+HNTDWidgetStore::getVersion()
+{
+    return m_version.load();
+}
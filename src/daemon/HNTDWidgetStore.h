@@ -0,0 +1,208 @@
+#ifndef __HNTD_WIDGET_STORE_H__
+#define __HNTD_WIDGET_STORE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <shared_mutex>
+
+#include "HNTDWidgetIndex.h"
+
+typedef enum HNTDWidgetStoreResultEnum
+{
+  HNTDWS_RESULT_SUCCESS,
+  HNTDWS_RESULT_FAILURE,
+  HNTDWS_RESULT_BAD_ID,
+  HNTDWS_RESULT_NOT_FOUND
+}HNTDWS_RESULT_T;
+
+// A single widget record.  The id is assigned by the store
+// and never reused, the external form is "w<id>".  The version
+// is the store version of the last change to the widget.
+typedef struct HNTDWidgetStruct
+{
+    uint64_t    id;
+    uint64_t    version;
+    std::string color;
+    std::string name;
+}HNTD_WIDGET_T;
+
+// Field values for create/update requests, only the fields
+// with the has flag set are applied during an update.
+typedef struct HNTDWidgetFieldsStruct
+{
+    bool        hasColor = false;
+    std::string color;
+
+    bool        hasName = false;
+    std::string name;
+}HNTD_WIDGET_FIELDS_T;
+
+typedef enum HNTDWidgetSortEnum
+{
+  HNTD_WIDGET_SORT_ID,
+  HNTD_WIDGET_SORT_NAME,
+  HNTD_WIDGET_SORT_COLOR
+}HNTD_WIDGET_SORT_T;
+
+// A filtered, sorted page of the widget list.  Ties in the sort key
+// are broken by id so every widget has a fixed position, a page picks
+// up past the afterKey/afterID position of the last one.
+typedef struct HNTDWidgetQueryStruct
+{
+    bool        hasColor = false;
+    std::string color;
+
+    bool        hasName = false;
+    std::string name;
+
+    HNTD_WIDGET_SORT_T sort = HNTD_WIDGET_SORT_ID;
+    bool               descending = false;
+
+    // 0 for no limit
+    uint limit = 0;
+
+    bool        hasAfter = false;
+    uint64_t    afterID = 0;
+    std::string afterKey;
+}HNTD_WIDGET_QUERY_T;
+
+// One lock shard of the widget store.  Keys live in a compact
+// open addressed slot array (linear probing, backward shift delete)
+// that points into a dense record vector, so probes stay within
+// a few cache lines and iteration never touches empty slots.  The
+// shard's own id and color index is kept under the same lock.
+class alignas(64) HNTDWidgetShard
+{
+    private:
+        typedef struct SlotStruct
+        {
+            uint64_t key;   // 0 marks an empty slot
+            uint32_t index; // Position in m_records
+        }SLOT_T;
+
+        std::shared_mutex m_lock;
+
+        std::vector< SLOT_T >        m_slots;
+        std::vector< HNTD_WIDGET_T > m_records;
+
+        uint64_t m_mask;
+
+        HNTDWidgetIndex m_index;
+
+        bool findSlot( uint64_t key, uint64_t &slot );
+        void growSlots();
+        void eraseSlot( uint64_t slot );
+
+    public:
+        HNTDWidgetShard();
+       ~HNTDWidgetShard();
+
+        std::shared_mutex& getLock();
+
+        // Callers must hold the shard lock for the following.
+        HNTD_WIDGET_T* find( uint64_t key );
+        HNTD_WIDGET_T* insert( const HNTD_WIDGET_T &widget );
+        bool erase( uint64_t key );
+
+        const std::vector< HNTD_WIDGET_T >& getRecords();
+
+        HNTDWidgetIndex& getIndex();
+
+        // Index every record from scratch, in id order
+        void rebuildIndex();
+};
+
+// Told about every change to the store.  Calls are made while the
+// widget's shard lock is held, so the calls for any one widget arrive
+// in the order the changes were applied.  Must not block.
+class HNTDWidgetStoreListener
+{
+    public:
+        // created is set for a new widget, clear for an update
+        virtual void widgetStored( const HNTD_WIDGET_T &widget, bool created ) = 0;
+        virtual void widgetDeleted( uint64_t id ) = 0;
+};
+
+class HNTDWidgetStore
+{
+    private:
+        static const uint SHARD_BITS  = 6;
+        static const uint SHARD_COUNT = (1 << SHARD_BITS);
+
+        HNTDWidgetShard m_shards[ SHARD_COUNT ];
+
+        std::atomic< uint64_t > m_nextID;
+        std::atomic< uint64_t > m_count;
+        std::atomic< uint64_t > m_version;
+
+        std::vector< HNTDWidgetStoreListener* > m_listeners;
+
+        HNTDWidgetShard& shardFor( uint64_t id );
+
+        // HNTDWidgetIndex::getIDs() over every shard's index, merged
+        void getIndexIDs( const std::string *color, bool descending, bool hasAfter, uint64_t after, size_t max, std::vector< uint64_t > &ids );
+
+        bool fetchWidget( uint64_t id, HNTD_WIDGET_T &result );
+
+        static bool queryMatch( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget );
+        static const std::string& getSortKey( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget );
+
+    public:
+        HNTDWidgetStore();
+       ~HNTDWidgetStore();
+
+        static uint getShardCount();
+
+        // Added before the store is shared between threads, removed
+        // once nothing changes it any more
+        void addListener( HNTDWidgetStoreListener *listener );
+        void removeListener( HNTDWidgetStoreListener *listener );
+
+        static std::string formatID( uint64_t id );
+        static bool parseID( const std::string &widgetID, uint64_t &id );
+
+        HNTDWS_RESULT_T createWidget( const HNTD_WIDGET_FIELDS_T &fields, HNTD_WIDGET_T &result );
+        HNTDWS_RESULT_T getWidget( const std::string &widgetID, HNTD_WIDGET_T &result );
+        HNTDWS_RESULT_T updateWidget( const std::string &widgetID, const HNTD_WIDGET_FIELDS_T &fields, HNTD_WIDGET_T &result );
+        HNTDWS_RESULT_T deleteWidget( const std::string &widgetID );
+
+        // Copy of every widget, ordered by id.
+        void getWidgetList( std::vector< HNTD_WIDGET_T > &list );
+
+        // One page of the widgets a query matches, more is set if there
+        // are matches past the page.  Color filters and id ordered pages
+        // are walked from the index, name and color ordering have to
+        // sort every candidate.
+        void queryWidgets( const HNTD_WIDGET_QUERY_T &query, std::vector< HNTD_WIDGET_T > &page, bool &more );
+
+        // Opaque resume position after widget for the query's sort.
+        // parseCursor() fails if the cursor is malformed or was made
+        // for a different sort.
+        static std::string makeCursor( const HNTD_WIDGET_QUERY_T &query, const HNTD_WIDGET_T &widget );
+        static bool parseCursor( const std::string &cursor, HNTD_WIDGET_QUERY_T &query );
+
+        // Copy of the widgets in one shard, unordered.
+        void getShardWidgets( uint shard, std::vector< HNTD_WIDGET_T > &list );
+
+        // Rebuild state from persisted records, the listener is not told.
+        // The index is left alone, rebuildIndex() once after the last
+        // restore and before the store is shared builds it in bulk.
+        void restoreWidget( const HNTD_WIDGET_T &widget );
+        void restoreDelete( uint64_t id );
+        void restoreNextID( uint64_t nextID );
+        void rebuildIndex();
+
+        // The id the next created widget will get
+        uint64_t getNextID();
+
+        uint64_t getCount();
+
+        // Advanced by every create, update and delete.
+        uint64_t getVersion();
+};
+
+#endif // __HNTD_WIDGET_STORE_H__
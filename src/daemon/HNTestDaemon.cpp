@@ -0,0 +1,547 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <iostream>
+#include <thread>
+
+#include "Poco/Util/ServerApplication.h"
+#include "Poco/Util/Option.h"
+#include "Poco/Util/OptionSet.h"
+#include "Poco/Util/HelpFormatter.h"
+#include <Poco/NumberParser.h>
+#include <Poco/Exception.h>
+
+#include "HNTDLog.h"
+#include "HNTestDaemonPrivate.h"
+
+using namespace Poco::Util;
+
+HNTestDaemon::HNTestDaemon()
+: m_startNext( 0 ), m_startFailed( false )
+{
+    m_churnNext = 0;
+
+    m_churnTimer.setCallback( this );
+}
+
+HNTestDaemon::~HNTestDaemon()
+{
+    for( std::vector< HNTestDevice* >::iterator it = m_devices.begin(); it != m_devices.end(); it++ )
+        delete *it;
+}
+
+void
+HNTestDaemon::defineOptions( OptionSet& options )
+{
+    ServerApplication::defineOptions( options );
+
+    options.addOption(
+              Option("help", "h", "display help").required(false).repeatable(false));
+
+    options.addOption(
+              Option("debug","d", "Enable debug logging").required(false).repeatable(false));
+
+    options.addOption(
+              Option("instance", "", "Specify the instance name of this daemon.").required(false).repeatable(false).argument("name"));
+
+    options.addOption(
+              Option("fleet-size", "", "Number of device instances to host, named <instance>-<n> when more than one.").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("rest-port", "", "REST port of the first device, further devices use the following ports (default 8088).").required(false).repeatable(false).argument("port"));
+
+    options.addOption(
+              Option("max-body-size", "", "Largest request body accepted, in bytes (default 1048576).").required(false).repeatable(false).argument("bytes"));
+
+    options.addOption(
+              Option("compress-min-size", "", "Smallest response body sent gzip or deflate compressed to clients that accept it, in bytes (default 1024).").required(false).repeatable(false).argument("bytes"));
+
+    options.addOption(
+              Option("change-feed-size", "", "Change events kept per device for feed readers that fall behind (default 4096).").required(false).repeatable(false).argument("events"));
+
+    options.addOption(
+              Option("change-feed-clients", "", "Change feed long-polls and streams served at once per device, more get 503 (default 8).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("fault-max-delayed", "", "Requests held for injected latency at once per device, more get 503 (default 4).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("health-history-size", "", "Health transitions kept per device for history queries, rounded up to a power of two, 0 for none (default 262144).").required(false).repeatable(false).argument("transitions"));
+
+    options.addOption(
+              Option("config-save-window", "", "Milliseconds to collect config changes before saving (default 500).").required(false).repeatable(false).argument("ms"));
+
+    options.addOption(
+              Option("health-churn-rate", "", "Generate health transitions at this rate per second per device (0.0167 is one per minute).").required(false).repeatable(false).argument("rate"));
+
+    options.addOption(
+              Option("health-churn-mode", "", "Churn component selection, 'sequence' (scripted) or 'random'.").required(false).repeatable(false).argument("mode"));
+
+    options.addOption(
+              Option("health-churn-seed", "", "Seed for random churn selection.").required(false).repeatable(false).argument("seed"));
+
+    options.addOption(
+              Option("health-tree-fanout", "", "Generate a synthetic health tree with this many children per component.").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("health-tree-depth", "", "Levels in the synthetic health tree (default 2).").required(false).repeatable(false).argument("levels"));
+
+    options.addOption(
+              Option("data-dir", "", "Directory for widget snapshots and logs, 'none' keeps widgets in memory only (default /var/lib/hnode2).").required(false).repeatable(false).argument("path"));
+
+    options.addOption(
+              Option("widget-compact-size", "", "Compact a widget log once it grows past this many bytes (default 67108864).").required(false).repeatable(false).argument("bytes"));
+
+    options.addOption(
+              Option("payload-size", "", "Pad getWidgetInfo responses to this many bytes (100 to 104857600) unless the request asks otherwise.").required(false).repeatable(false).argument("bytes"));
+
+    options.addOption(
+              Option("payload-shape", "", "Synthetic payload shape, 'blob' (default) or 'records'.").required(false).repeatable(false).argument("shape"));
+
+    options.addOption(
+              Option("startup-profile", "", "Log the time spent in each startup phase.").required(false).repeatable(false));
+
+    options.addOption(
+              Option("startup-threads", "", "Threads starting fleet devices in parallel (default 1).").required(false).repeatable(false).argument("count"));
+
+    options.addOption(
+              Option("ready-file", "", "Write this file once every device is serving, removed on exit.").required(false).repeatable(false).argument("path"));
+
+}
+
+void
+HNTestDaemon::handleOption( const std::string& name, const std::string& value )
+{
+    ServerApplication::handleOption( name, value );
+    if( "help" == name )
+        _helpRequested = true;
+    else if( "debug" == name )
+        _debugLogging = true;
+    else if( "instance" == name )
+    {
+         _instancePresent = true;
+         _instance = value;
+    }
+    else if( "fleet-size" == name )
+        _fleetSize = Poco::NumberParser::parseUnsigned( value );
+    else if( "rest-port" == name )
+        _restPort = Poco::NumberParser::parseUnsigned( value );
+    else if( "max-body-size" == name )
+        _maxBodySize = Poco::NumberParser::parseUnsigned( value );
+    else if( "compress-min-size" == name )
+        _compressMinSize = Poco::NumberParser::parseUnsigned( value );
+    else if( "change-feed-size" == name )
+        _changeFeedSize = Poco::NumberParser::parseUnsigned( value );
+    else if( "change-feed-clients" == name )
+        _changeFeedClients = Poco::NumberParser::parseUnsigned( value );
+    else if( "fault-max-delayed" == name )
+        _faultMaxDelayed = Poco::NumberParser::parseUnsigned( value );
+    else if( "health-history-size" == name )
+        _healthHistorySize = Poco::NumberParser::parseUnsigned64( value );
+    else if( "config-save-window" == name )
+        _configSaveWindow = Poco::NumberParser::parseUnsigned( value );
+    else if( "health-churn-rate" == name )
+        _healthChurnRate = Poco::NumberParser::parseFloat( value );
+    else if( "health-churn-mode" == name )
+    {
+        if( "random" == value )
+            _healthChurnMode = HNTD_CHURN_MODE_RANDOM;
+        else if( "sequence" == value )
+            _healthChurnMode = HNTD_CHURN_MODE_SEQUENCE;
+        else
+            throw Poco::InvalidArgumentException( "health-churn-mode must be 'sequence' or 'random'" );
+    }
+    else if( "health-churn-seed" == name )
+        _healthChurnSeed = Poco::NumberParser::parseUnsigned( value );
+    else if( "health-tree-fanout" == name )
+        _healthTreeFanout = Poco::NumberParser::parseUnsigned( value );
+    else if( "health-tree-depth" == name )
+        _healthTreeDepth = Poco::NumberParser::parseUnsigned( value );
+    else if( "data-dir" == name )
+        _dataDir = ( "none" == value ) ? "" : value;
+    else if( "widget-compact-size" == name )
+        _widgetCompactSize = Poco::NumberParser::parseUnsigned64( value );
+    else if( "payload-size" == name )
+    {
+        _payloadSize = Poco::NumberParser::parseUnsigned64( value );
+        if( ( _payloadSize != 0 ) && ( ( _payloadSize < HNTD_PAYLOAD_MIN_SIZE ) || ( _payloadSize > HNTD_PAYLOAD_MAX_SIZE ) ) )
+            throw Poco::InvalidArgumentException( "payload-size must be from 100 to 104857600" );
+    }
+    else if( "payload-shape" == name )
+    {
+        if( HNTDPayloadArena::parseShapeName( value, _payloadShape ) == false )
+            throw Poco::InvalidArgumentException( "payload-shape must be 'blob' or 'records'" );
+    }
+    else if( "startup-profile" == name )
+        _startupProfile = true;
+    else if( "startup-threads" == name )
+    {
+        _startupThreads = Poco::NumberParser::parseUnsigned( value );
+        if( _startupThreads == 0 )
+            throw Poco::InvalidArgumentException( "startup-threads must be at least 1" );
+    }
+    else if( "ready-file" == name )
+        _readyFile = value;
+}
+
+void
+HNTestDaemon::displayHelp()
+{
+    HelpFormatter helpFormatter(options());
+    helpFormatter.setCommand(commandName());
+    helpFormatter.setUsage("[options]");
+    helpFormatter.setHeader("HNode2 Test Device Daemon.");
+    helpFormatter.format(std::cout);
+}
+
+int
+HNTestDaemon::main( const std::vector<std::string>& args )
+{
+    if( _helpRequested == true )
+    {
+        displayHelp();
+        return Application::EXIT_OK;
+    }
+
+    // Request path logging is only formatted when --debug is given
+    HNTDLog::getInstance().setLevel( _debugLogging ? HNTD_LOG_LEVEL_DEBUG : HNTD_LOG_LEVEL_INFO );
+    HNTDLog::getInstance().start();
+
+    if( ( _fleetSize == 0 ) || ( ( _restPort + _fleetSize - 1 ) > 65535 ) )
+    {
+        HNTD_LOG_ERROR( "Fleet of %u devices does not fit the port range from %u", _fleetSize, _restPort );
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_USAGE;
+    }
+
+    std::string baseName = "default";
+    if( _instancePresent == true )
+        baseName = _instance;
+
+    HNTDStartupProfile *profile = _startupProfile ? &m_startupProfile : NULL;
+
+    HNTDPhaseTimer setupPhase( profile, "daemon setup" );
+
+    // Setup the event loop
+    m_evLoop.setup( this );
+
+    int wheelFD = m_timerWheel.start();
+    if( ( wheelFD < 0 ) || ( m_evLoop.addFDToEPoll( wheelFD ) != HNEP_RESULT_SUCCESS ) )
+    {
+        HNTD_LOG_ERROR( "Could not add the timer wheel to the event loop" );
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_SOFTWARE;
+    }
+
+    m_configPersister.setWindow( _configSaveWindow );
+    m_configPersister.start();
+
+    m_journalFlusher.start();
+
+    m_delayScheduler.start( &m_timerWheel );
+
+    // Only address space until payloads are asked for
+    bool payloadsReady = m_payloadArena.reserve();
+    if( payloadsReady == false )
+        HNTD_LOG_WARN( "Could not reserve the payload arena, synthetic payloads are disabled" );
+
+    setupPhase.end();
+
+    HNTD_DEVICE_SETTINGS_T settings;
+    settings.healthTreeFanout  = _healthTreeFanout;
+    settings.healthTreeDepth   = _healthTreeDepth;
+    settings.maxBodySize       = _maxBodySize;
+    settings.compressMinSize   = _compressMinSize;
+    settings.changeFeedSize    = _changeFeedSize;
+    settings.changeFeedClients = _changeFeedClients;
+    settings.maxDelayed        = _faultMaxDelayed;
+    settings.healthHistorySize = _healthHistorySize;
+    settings.dataDir           = _dataDir;
+    settings.widgetCompactSize = _widgetCompactSize;
+    settings.fleetSize         = _fleetSize;
+    settings.configPersister   = &m_configPersister;
+    settings.churnPacer        = &m_healthChurn;
+    settings.journalFlusher    = &m_journalFlusher;
+    settings.delayScheduler    = &m_delayScheduler;
+    settings.payloadSize       = _payloadSize;
+    settings.payloadShape      = _payloadShape;
+    settings.payloadArena      = payloadsReady ? &m_payloadArena : NULL;
+    settings.startupProfile    = profile;
+    settings.standalone        = false;
+
+    HNTDPhaseTimer devicePhase( profile, "devices" );
+
+    std::vector< HNTD_DEVICE_SETTINGS_T > deviceSettings;
+    deviceSettings.reserve( _fleetSize );
+
+    for( uint i = 0; i < _fleetSize; i++ )
+    {
+        // A single device keeps the plain instance name
+        settings.instance  = ( _fleetSize == 1 ) ? baseName : ( baseName + "-" + std::to_string( i ) );
+        settings.restPort  = _restPort + i;
+        settings.churnSeed = _healthChurnSeed + i;
+
+        deviceSettings.push_back( settings );
+        m_devices.push_back( new HNTestDevice );
+    }
+
+    // This thread starts devices too
+    std::vector< std::thread > starters;
+    uint threadCount = ( _startupThreads < _fleetSize ) ? _startupThreads : _fleetSize;
+
+    for( uint i = 1; i < threadCount; i++ )
+        starters.push_back( std::thread( &HNTestDaemon::startDevices, this, std::cref( deviceSettings ) ) );
+
+    startDevices( deviceSettings );
+
+    for( std::vector< std::thread >::iterator it = starters.begin(); it != starters.end(); it++ )
+        it->join();
+
+    if( m_startFailed.load() == true )
+    {
+        m_delayScheduler.stop();
+        m_journalFlusher.stop();
+        m_configPersister.stop();
+        m_timerWheel.stop();
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_CONFIG;
+    }
+
+    devicePhase.end();
+
+    HNTD_LOG_INFO( "Started %u device instance(s) on ports %u-%u", _fleetSize, _restPort, _restPort + _fleetSize - 1 );
+
+    HNTDPhaseTimer churnPhase( profile, "health churn" );
+
+    // Reporting ready without the churn asked for would skew the test
+    if( ( _healthChurnRate > 0 ) && ( startHealthChurn() != HNTD_RESULT_SUCCESS ) )
+    {
+        HNTD_LOG_ERROR( "Health churn did not start, exiting" );
+
+        for( std::vector< HNTestDevice* >::iterator it = m_devices.begin(); it != m_devices.end(); it++ )
+            (*it)->stop();
+
+        m_delayScheduler.stop();
+        m_journalFlusher.stop();
+        m_configPersister.stop();
+        m_timerWheel.stop();
+        HNTDLog::getInstance().stop();
+        return Application::EXIT_SOFTWARE;
+    }
+
+    churnPhase.end();
+
+    // Start event processing loop
+    HNTDPhaseTimer loopPhase( profile, "event loop" );
+
+    m_evLoop.run();
+
+    loopPhase.end();
+
+    uint64_t readyMS = m_startupProfile.getElapsedNS() / 1000000;
+
+    HNTD_LOG_INFO( "Ready in %lu ms", (unsigned long) readyMS );
+
+    if( profile != NULL )
+        profile->report();
+
+    signalReady( readyMS );
+
+    waitForTerminationRequest();
+
+    signalStopping();
+
+    // End change feed waits and streams
+    for( std::vector< HNTestDevice* >::iterator it = m_devices.begin(); it != m_devices.end(); it++ )
+        (*it)->stop();
+
+    // Let delayed requests finish
+    m_delayScheduler.stop();
+
+    // Flush any config change still inside the save window
+    m_configPersister.stop();
+
+    // Write out the widget changes not yet in the logs
+    m_journalFlusher.stop();
+
+    m_timerWheel.stop();
+
+    HNTDLog::getInstance().stop();
+
+    return Application::EXIT_OK;
+}
+
+void
+HNTestDaemon::startDevices( const std::vector< HNTD_DEVICE_SETTINGS_T > &settings )
+{
+    // Take devices in turn until all are started or one fails
+    while( m_startFailed.load() == false )
+    {
+        uint i = m_startNext.fetch_add( 1 );
+        if( i >= settings.size() )
+            return;
+
+        if( m_devices[ i ]->start( settings[ i ] ) != HNTD_RESULT_SUCCESS )
+        {
+            HNTD_LOG_ERROR( "Could not start device instance %s", settings[ i ].instance.c_str() );
+            m_startFailed.store( true );
+        }
+    }
+}
+
+// Tell systemd, when it started us as Type=notify, without linking
+// libsystemd.  A leading '@' names an abstract socket.
+static void
+hntdNotifySystemd( const char *state )
+{
+    const char *path = getenv( "NOTIFY_SOCKET" );
+    if( ( path == NULL ) || ( path[0] == '\0' ) )
+        return;
+
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+
+    size_t pathLen = strlen( path );
+    if( pathLen >= sizeof( addr.sun_path ) )
+        return;
+
+    memcpy( addr.sun_path, path, pathLen );
+    if( addr.sun_path[0] == '@' )
+        addr.sun_path[0] = '\0';
+
+    int fd = socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+    if( fd < 0 )
+        return;
+
+    if( sendto( fd, state, strlen( state ), MSG_NOSIGNAL, (struct sockaddr *) &addr, offsetof( struct sockaddr_un, sun_path ) + pathLen ) < 0 )
+        HNTD_LOG_WARN( "Could not notify systemd: %s", strerror( errno ) );
+
+    close( fd );
+}
+
+void
+HNTestDaemon::signalReady( uint64_t readyMS )
+{
+    hntdNotifySystemd( "READY=1" );
+
+    if( _readyFile.empty() )
+        return;
+
+    // Written aside and renamed so a watcher never reads it partial
+    std::string tmpPath = _readyFile + ".tmp";
+
+    FILE *fp = fopen( tmpPath.c_str(), "w" );
+    if( fp == NULL )
+    {
+        HNTD_LOG_WARN( "Could not write ready file %s: %s", tmpPath.c_str(), strerror( errno ) );
+        return;
+    }
+
+    fprintf( fp, "{\"pid\":%d,\"readyMs\":%lu,\"devices\":%u,\"firstPort\":%u,\"lastPort\":%u}\n",
+             (int) getpid(), (unsigned long) readyMS, _fleetSize, _restPort, _restPort + _fleetSize - 1 );
+
+    if( ( fclose( fp ) != 0 ) || ( rename( tmpPath.c_str(), _readyFile.c_str() ) != 0 ) )
+    {
+        HNTD_LOG_WARN( "Could not write ready file %s: %s", _readyFile.c_str(), strerror( errno ) );
+        unlink( tmpPath.c_str() );
+    }
+}
+
+void
+HNTestDaemon::signalStopping()
+{
+    hntdNotifySystemd( "STOPPING=1" );
+
+    if( _readyFile.empty() == false )
+        unlink( _readyFile.c_str() );
+}
+
+HNTD_RESULT_T
+HNTestDaemon::startHealthChurn()
+{
+    // The rate option is per device, one timer drives them all
+    if( m_healthChurn.start( _healthChurnRate * _fleetSize ) == false )
+    {
+        HNTD_LOG_ERROR( "Could not start health churn at rate %f", _healthChurnRate );
+        return HNTD_RESULT_FAILURE;
+    }
+
+    m_timerWheel.arm( &m_churnTimer, m_healthChurn.getTickMS(), m_healthChurn.getTickMS() );
+
+    HNTD_LOG_INFO( "Health churn started: %.4f transitions/sec per device, %s selection", _healthChurnRate,
+                   ( _healthChurnMode == HNTD_CHURN_MODE_RANDOM ) ? "random" : "sequence" );
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+void
+HNTestDaemon::runHealthChurn()
+{
+    uint due = m_healthChurn.getDueCount();
+
+    // Spread the transitions round robin over the fleet
+    for( uint i = 0; i < due; i++ )
+    {
+        m_devices[ m_churnNext ]->churnStep( _healthChurnMode );
+
+        m_churnNext += 1;
+        if( m_churnNext >= m_devices.size() )
+            m_churnNext = 0;
+    }
+
+    m_healthChurn.markIssued( due );
+
+    if( m_healthChurn.reportDue( 10 ) )
+    {
+        HNTD_LOG_INFO( "Health churn: target %.4f/sec, achieved %.4f/sec, %lu transitions",
+                       m_healthChurn.getTargetRate(), m_healthChurn.getAchievedRate(),
+                       (unsigned long) m_healthChurn.getIssuedCount() );
+    }
+}
+
+void
+HNTestDaemon::loopIteration()
+{
+
+}
+
+void
+HNTestDaemon::timeoutEvent()
+{
+    // Harmless if nothing is due, the wheel works from the clock
+    m_timerWheel.run();
+}
+
+void
+HNTestDaemon::fdEvent( int sfd )
+{
+    HNTD_LOG_DEBUG( "HNTestDaemon::fdEvent() - entry: %d", sfd );
+
+    if( m_timerWheel.isMatch( sfd ) )
+    {
+        m_timerWheel.run();
+    }
+}
+
+void
+HNTestDaemon::timerFired( HNTDTimer *timer )
+{
+    if( timer == &m_churnTimer )
+    {
+        runHealthChurn();
+    }
+}
+
+void
+HNTestDaemon::fdError( int sfd )
+{
+    HNTD_LOG_ERROR( "HNTestDaemon::fdError() - entry: %d", sfd );
+
+}
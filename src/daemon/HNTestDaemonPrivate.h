@@ -0,0 +1,119 @@
+#ifndef __HN_TEST_DAEMON_PRIVATE_H__
+#define __HN_TEST_DAEMON_PRIVATE_H__
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "Poco/Util/ServerApplication.h"
+#include "Poco/Util/OptionSet.h"
+
+#include <hnode2/HNEPLoop.h>
+
+#include "HNTestDevicePrivate.h"
+#include "HNTDConfigPersister.h"
+#include "HNTDChurnPacer.h"
+#include "HNTDWidgetJournal.h"
+#include "HNTDDelayScheduler.h"
+#include "HNTDTimerWheel.h"
+#include "HNTDPayloadArena.h"
+#include "HNTDStartupProfile.h"
+
+#define HNTD_DEFAULT_DATA_DIR  "/var/lib/hnode2"
+
+// The hntestd process.  Owns the command line options, the event
+// loop and the helpers shared by every simulated device, and hosts
+// one device or, in fleet mode, many of them.
+class HNTestDaemon : public Poco::Util::ServerApplication, public HNEPLoopCallbacks, public HNTDTimerCallback
+{
+    private:
+        bool _helpRequested   = false;
+        bool _debugLogging    = false;
+        bool _instancePresent = false;
+        bool _startupProfile  = false;
+        uint _fleetSize = 1;
+        uint _startupThreads = 1;
+        uint _restPort = 8088;
+        uint _configSaveWindow = 500;
+        uint _maxBodySize = HNTD_DEFAULT_MAX_BODY_SIZE;
+        uint _compressMinSize = HNTD_DEFAULT_COMPRESS_MIN_SIZE;
+        uint _changeFeedSize = HNTD_DEFAULT_CHANGE_FEED_SIZE;
+        uint _changeFeedClients = HNTD_DEFAULT_CHANGE_FEED_CLIENTS;
+        uint _faultMaxDelayed = HNTD_DEFAULT_MAX_DELAYED;
+        uint64_t _healthHistorySize = HNTD_DEFAULT_HEALTH_HISTORY_SIZE;
+        double _healthChurnRate = 0;
+        uint _healthChurnSeed = 1;
+        HNTD_CHURN_MODE_T _healthChurnMode = HNTD_CHURN_MODE_SEQUENCE;
+        uint _healthTreeFanout = 0;
+        uint _healthTreeDepth = 2;
+        uint64_t _widgetCompactSize = HNTD_DEFAULT_WIDGET_COMPACT_SIZE;
+        uint64_t _payloadSize = 0;
+        HNTD_PAYLOAD_SHAPE_T _payloadShape = HNTD_PAYLOAD_SHAPE_BLOB;
+
+        std::string _instance;
+        std::string _dataDir = HNTD_DEFAULT_DATA_DIR;
+        std::string _readyFile;
+
+        HNEPLoop m_evLoop;
+
+        // Every timer of the daemon and its devices runs off the loop
+        HNTDTimerWheel m_timerWheel;
+
+        // Config changes of every device are written behind the event loop
+        HNTDConfigPersister m_configPersister;
+
+        // One timer paces churn for the whole fleet
+        HNTDChurnPacer m_healthChurn;
+        HNTDTimer m_churnTimer;
+        uint m_churnNext;
+
+        // Widget logs of every device are written and compacted by one thread
+        HNTDJournalFlusher m_journalFlusher;
+
+        // Releases the requests held back by injected latency
+        HNTDDelayScheduler m_delayScheduler;
+
+        // Synthetic response filler shared by every device
+        HNTDPayloadArena m_payloadArena;
+
+        std::vector< HNTestDevice* > m_devices;
+
+        // Startup timing, from construction until the daemon is ready
+        HNTDStartupProfile m_startupProfile;
+
+        // Next device to start and whether one has failed, shared by
+        // the startup threads
+        std::atomic< uint > m_startNext;
+        std::atomic< bool > m_startFailed;
+
+        void displayHelp();
+
+        void startDevices( const std::vector< HNTD_DEVICE_SETTINGS_T > &settings );
+
+        void signalReady( uint64_t readyMS );
+        void signalStopping();
+
+        HNTD_RESULT_T startHealthChurn();
+        void runHealthChurn();
+
+    public:
+        HNTestDaemon();
+       ~HNTestDaemon();
+
+    protected:
+        // Event loop functions
+        virtual void loopIteration();
+        virtual void timeoutEvent();
+        virtual void fdEvent( int sfd );
+        virtual void fdError( int sfd );
+
+        // Timer wheel callback
+        virtual void timerFired( HNTDTimer *timer );
+
+        // Poco funcions
+        void defineOptions( Poco::Util::OptionSet& options );
+        void handleOption( const std::string& name, const std::string& value );
+        int main( const std::vector<std::string>& args );
+};
+
+#endif // __HN_TEST_DAEMON_PRIVATE_H__
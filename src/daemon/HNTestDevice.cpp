@@ -1,79 +1,98 @@
 #include <unistd.h>
 #include <string.h>
 #include <syslog.h>
+#include <time.h>
 
 #include <iostream>
 #include <sstream>
 #include <thread>
 
-#include "Poco/Util/ServerApplication.h"
-#include "Poco/Util/Option.h"
-#include "Poco/Util/OptionSet.h"
-#include "Poco/Util/HelpFormatter.h"
 #include "Poco/Checksum.h"
 #include <Poco/JSON/Object.h>
-#include <Poco/JSON/Parser.h>
-#include <Poco/StreamCopier.h>
+#include <Poco/Exception.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
 
 #include <hnode2/HNodeDevice.h>
 
+#include "HNTDLog.h"
+#include "HNTDLineReader.h"
+#include "HNTDRequestDecoder.h"
 #include "HNTestDevicePrivate.h"
 
-using namespace Poco::Util;
-
 namespace pjs = Poco::JSON;
 namespace pdy = Poco::Dynamic;
 
-// Forward declaration
-extern const std::string g_HNode2TestRest;
-
-void 
-HNTestDevice::defineOptions( OptionSet& options )
-{
-    ServerApplication::defineOptions( options );
-
-    options.addOption(
-              Option("help", "h", "display help").required(false).repeatable(false));
+// Limits for newline delimited bulk requests
+#define HNTD_BULK_MAX_LINE    65536
+#define HNTD_BULK_MAX_ERRORS  1000
 
-    options.addOption(
-              Option("debug","d", "Enable debug logging").required(false).repeatable(false));
+// Change feed long-poll and stream limits
+#define HNTD_CHANGES_DEFAULT_WAIT_MS  30000
+#define HNTD_CHANGES_MAX_WAIT_MS      300000
+#define HNTD_CHANGES_MAX_EVENTS       1000
+#define HNTD_CHANGES_KEEPALIVE_MS     15000
 
-    options.addOption(
-              Option("instance", "", "Specify the instance name of this daemon.").required(false).repeatable(false).argument("name"));
+// Health history query bounds
+#define HNTD_HEALTH_HISTORY_DEFAULT_LIMIT    1000
+#define HNTD_HEALTH_HISTORY_MAX_LIMIT        100000
+#define HNTD_HEALTH_HISTORY_DEFAULT_BUCKETS  60
+#define HNTD_HEALTH_HISTORY_MAX_BUCKETS      10000
+#define HNTD_HEALTH_HISTORY_MAX_CELLS        1000000  // Components times buckets
 
-}
+// Largest page of a widget list query
+#define HNTD_WIDGET_QUERY_MAX_LIMIT   10000
 
-void 
-HNTestDevice::handleOption( const std::string& name, const std::string& value )
+HNTestDevice::HNTestDevice()
+: m_deviceConfigChanged( false ), m_churnTransitions( 0 ), m_delayedNow( 0 ), m_delayRejects( 0 )
 {
-    ServerApplication::handleOption( name, value );
-    if( "help" == name )
-        _helpRequested = true;
-    else if( "debug" == name )
-        _debugLogging = true;
-    else if( "instance" == name )
-    {
-         _instancePresent = true;
-         _instance = value;
-    }
+    m_metrics         = NULL;
+    m_faults          = NULL;
+    m_delayScheduler  = NULL;
+    m_maxDelayed      = HNTD_DEFAULT_MAX_DELAYED;
+    m_payloadArena    = NULL;
+    m_payloadSize     = 0;
+    m_payloadShape    = HNTD_PAYLOAD_SHAPE_BLOB;
+    m_configPersister = NULL;
+    m_savedRulesValid = false;
+    m_churnPacer      = NULL;
+    m_fleetSize       = 1;
+    m_maxBodySize     = HNTD_DEFAULT_MAX_BODY_SIZE;
+    m_compressMinSize = HNTD_DEFAULT_COMPRESS_MIN_SIZE;
+    m_widgetsPersisted = false;
 }
 
-void 
-HNTestDevice::displayHelp()
+HNTestDevice::~HNTestDevice()
 {
-    HelpFormatter helpFormatter(options());
-    helpFormatter.setCommand(commandName());
-    helpFormatter.setUsage("[options]");
-    helpFormatter.setHeader("HNode2 Switch Daemon.");
-    helpFormatter.format(std::cout);
+    if( m_metrics != NULL )
+        delete m_metrics;
+
+    if( m_faults != NULL )
+        delete m_faults;
 }
 
-int 
-HNTestDevice::main( const std::vector<std::string>& args )
+HNTD_RESULT_T
+HNTestDevice::start( const HNTD_DEVICE_SETTINGS_T &settings )
 {
-    m_instanceName = "default";
-    if( _instancePresent == true )
-        m_instanceName = _instance;
+    m_instanceName    = settings.instance;
+    m_maxBodySize     = settings.maxBodySize;
+    m_compressMinSize = settings.compressMinSize;
+
+    m_changeFeed.setCapacity( settings.changeFeedSize );
+    m_changeFeed.setMaxClients( settings.changeFeedClients );
+    m_healthHistory.setCapacity( settings.healthHistorySize );
+    m_configPersister = settings.configPersister;
+    m_churnPacer      = settings.churnPacer;
+    m_fleetSize       = settings.fleetSize;
+    m_delayScheduler  = settings.delayScheduler;
+    m_maxDelayed      = settings.maxDelayed;
+    m_payloadArena    = settings.payloadArena;
+    m_payloadSize     = settings.payloadSize;
+    m_payloadShape    = settings.payloadShape;
+
+    HNTDPhaseTimer endpointPhase( settings.startupProfile, "device endpoint" );
 
     m_hnodeDev.setDeviceType( HNODE_TEST_DEVTYPE );
     m_hnodeDev.setInstance( m_instanceName );
@@ -83,23 +102,48 @@ HNTestDevice::main( const std::vector<std::string>& args )
     hndEP.setDispatch( "hnode2Test", this );
     hndEP.setOpenAPIJson( g_HNode2TestRest ); 
 
+    registerOperations();
+
     m_hnodeDev.addEndpoint( hndEP );
 
-    m_hnodeDev.setRestPort(8088);
+    m_hnodeDev.setRestPort( settings.restPort );
 
-    std::cout << "Looking for config file" << std::endl;
-    
-    if( configExists() == false )
+    endpointPhase.end();
+
+    HNTDPhaseTimer configPhase( settings.startupProfile, "device config" );
+
+    HNTD_LOG_DEBUG( "%s: Looking for config file", m_instanceName.c_str() );
+
+    // A new config is applied as built rather than read back from disk
+    if( settings.standalone == true )
+    {
+        HNodeConfig cfg;
+
+        m_hnodeDev.initConfigSections( cfg );
+        applyConfig( cfg );
+    }
+    else if( configExists() == false )
     {
-        initConfig();
+        HNodeConfig cfg;
+
+        if( initConfig( cfg ) == HNTD_RESULT_SUCCESS )
+            applyConfig( cfg );
     }
+    else
+        readConfig();
+
+    configPhase.end();
+
+    // Widgets must be back before the REST server starts
+    HNTDPhaseTimer widgetPhase( settings.startupProfile, "device widgets" );
 
-    readConfig();
+    restoreWidgets( settings );
 
-    // Setup the event loop
-    m_testDeviceEvLoop.setup( this );
+    m_widgetStore.addListener( this );
 
-    m_testDeviceEvLoop.setupTriggerFD( m_configUpdateTrigger );
+    widgetPhase.end();
+
+    HNTDPhaseTimer healthPhase( settings.startupProfile, "device health" );
 
     // Register some format strings
     m_hnodeDev.registerFormatString( "Error: %u", m_errStrCode );
@@ -108,83 +152,210 @@ HNTestDevice::main( const std::vector<std::string>& args )
     // Enable the health monitoring and add some fake components
     m_hnodeDev.enableHealthMonitoring();
 
-    m_hnodeDev.getHealthRef().registerComponent( "test device hc1", HNDH_ROOT_COMPID, m_hc1ID );
-    std::cout << "Health Component 1 id: " << m_hc1ID << std::endl;
-    m_hnodeDev.getHealthRef().registerComponent( "test device hc2", HNDH_ROOT_COMPID, m_hc2ID );
-    std::cout << "Health Component 2 id: " << m_hc2ID << std::endl;
-    m_hnodeDev.getHealthRef().registerComponent( "test device hc2.1", m_hc2ID, m_hc3ID );
-    std::cout << "Health Component 3 id: " << m_hc3ID << std::endl;
+    if( buildHealthComponents( settings.healthTreeFanout, settings.healthTreeDepth ) != HNTD_RESULT_SUCCESS )
+        return HNTD_RESULT_FAILURE;
+
+    initHealthState();
+
+    m_churnRandom.seed( settings.churnSeed );
 
-    m_healthStateSeq = 0;
-    generateNewHealthState();
+    // The status resource is static, so it is only ever rendered once
+    m_statusVersion = 1;
+
+    struct timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts );
+    char epoch[ 32 ];
+    snprintf( epoch, sizeof( epoch ), "%lx%09lx", (unsigned long) ts.tv_sec, (unsigned long) ts.tv_nsec );
+    m_etagEpoch = epoch;
+
+    healthPhase.end();
 
     // Start accepting device notifications
     m_hnodeDev.setNotifySink( this );
 
+    if( settings.standalone == true )
+        return HNTD_RESULT_SUCCESS;
+
     // Start up the hnode device
+    HNTDPhaseTimer hnodePhase( settings.startupProfile, "device hnode start" );
+
     m_hnodeDev.start();
 
-    // Start event processing loop
-    m_testDeviceEvLoop.run();
+    return HNTD_RESULT_SUCCESS;
+}
+
+void
+HNTestDevice::restoreWidgets( const HNTD_DEVICE_SETTINGS_T &settings )
+{
+    if( settings.dataDir.empty() || ( settings.journalFlusher == NULL ) )
+        return;
+
+    m_widgetJournal.setCompactThreshold( settings.widgetCompactSize );
+
+    HNTDWJ_RESULT_T result = m_widgetJournal.open( settings.dataDir + "/" + HNODE_TEST_DEVTYPE, m_instanceName, m_widgetStore );
+
+    // Whatever was restored, even from a journal that failed part way,
+    // is indexed in one pass rather than widget by widget
+    m_widgetStore.rebuildIndex();
+
+    // Run on without persistence rather than risk overwriting damaged files
+    if( result != HNTDWJ_RESULT_SUCCESS )
+    {
+        HNTD_LOG_ERROR( "%s: Widgets will not be persisted", m_instanceName.c_str() );
+        return;
+    }
+
+    settings.journalFlusher->addJournal( &m_widgetJournal );
+    m_widgetsPersisted = true;
+}
+
+void
+HNTestDevice::stop()
+{
+    m_changeFeed.stop();
+}
+
+const std::string&
+HNTestDevice::getInstanceName()
+{
+    return m_instanceName;
+}
+
+HNTD_RESULT_T
+HNTestDevice::buildHealthComponents( uint fanout, uint depth )
+{
+    if( fanout == 0 )
+        m_healthTable.buildDefault();
+    else
+    {
+        switch( m_healthTable.buildTree( fanout, depth ) )
+        {
+            case HNTDHT_RESULT_SUCCESS:
+            break;
+
+            case HNTDHT_RESULT_TOO_LARGE:
+                HNTD_LOG_ERROR( "Health tree of fanout %u, depth %u exceeds %u components", fanout, depth, HNTD_HEALTH_TABLE_MAX );
+                return HNTD_RESULT_FAILURE;
+
+            default:
+                HNTD_LOG_ERROR( "Health tree fanout and depth must be non-zero" );
+                return HNTD_RESULT_FAILURE;
+        }
+    }
+
+    // Parents precede children, so their ids are always known here
+    for( uint32_t i = 0; i < m_healthTable.size(); i++ )
+    {
+        uint32_t parent = m_healthTable.getParent( i );
+        std::string parentID = ( parent == HNTD_HEALTH_NO_PARENT ) ? std::string( HNDH_ROOT_COMPID ) : m_healthTable.getID( parent );
+        std::string compID;
+
+        m_hnodeDev.getHealthRef().registerComponent( m_healthTable.getName( i ), parentID, compID );
+        m_healthTable.setID( i, compID );
+
+        HNTD_LOG_DEBUG( "Health component %s id: %s", m_healthTable.getName( i ).c_str(), compID.c_str() );
+    }
+
+    HNTD_LOG_INFO( "%s: Registered %u health components", m_instanceName.c_str(), m_healthTable.size() );
+
+    // The scripted sequence works on hc1, hc2 and hc2.1, which
+    // fall back to the first component in small synthetic trees.
+    if( m_healthTable.findByName( "test device hc1", m_seqComp[0] ) == false )
+        m_seqComp[0] = 0;
+    if( m_healthTable.findByName( "test device hc2", m_seqComp[1] ) == false )
+        m_seqComp[1] = 0;
+    if( m_healthTable.findByName( "test device hc2.1", m_seqComp[2] ) == false )
+        m_seqComp[2] = 0;
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+void
+HNTestDevice::initHealthState()
+{
+    std::lock_guard< std::mutex > lock( m_healthLock );
+
+    m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
+
+    m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
 
-    waitForTerminationRequest();
+    for( uint32_t i = 0; i < m_healthTable.size(); i++ )
+    {
+        m_hnodeDev.getHealthRef().setComponentStatus( m_healthTable.getID( i ), HNDH_CSTAT_OK );
+        m_healthTable.setFailed( i, false );
+    }
 
-    return Application::EXIT_OK;
+    m_hnodeDev.getHealthRef().completeUpdateCycle();
+
+    // Everything is OK, which is the first step of the sequence
+    m_healthStateSeq = 1;
 }
 
 void
 HNTestDevice::generateNewHealthState()
 {
+    std::lock_guard< std::mutex > lock( m_healthLock );
+
+    const std::string &hc1ID = m_healthTable.getID( m_seqComp[0] );
+    const std::string &hc2ID = m_healthTable.getID( m_seqComp[1] );
+    const std::string &hc3ID = m_healthTable.getID( m_seqComp[2] );
+
     m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
 
     switch( m_healthStateSeq )
     {
         case 0:
           m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc1ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc2ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc3ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc1ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc2ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc3ID, HNDH_CSTAT_OK );
         break;
 
         case 1:
           m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc1ID, HNDH_CSTAT_FAILED );
-          m_hnodeDev.getHealthRef().setComponentErrMsg( m_hc1ID, 200, m_errStrCode, 200 );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc1ID, HNDH_CSTAT_FAILED );
+          m_hnodeDev.getHealthRef().setComponentErrMsg( hc1ID, 200, m_errStrCode, 200 );
+          m_healthHistory.record( m_seqComp[0], HNTD_HH_STATUS_FAILED, 200 );
           
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc2ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc3ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc2ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc3ID, HNDH_CSTAT_OK );
         break;
 
         case 2:
           m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc1ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().clearComponentErrMsg( m_hc1ID );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc1ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().clearComponentErrMsg( hc1ID );
+          m_healthHistory.record( m_seqComp[0], HNTD_HH_STATUS_OK, 0 );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc2ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc2ID, HNDH_CSTAT_OK );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc3ID, HNDH_CSTAT_FAILED );
-          m_hnodeDev.getHealthRef().setComponentErrMsg( m_hc3ID, 400, m_errStrCode, 400 );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc3ID, HNDH_CSTAT_FAILED );
+          m_hnodeDev.getHealthRef().setComponentErrMsg( hc3ID, 400, m_errStrCode, 400 );
+          m_healthHistory.record( m_seqComp[2], HNTD_HH_STATUS_FAILED, 400 );
         break;
 
         case 3:
           m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc1ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc1ID, HNDH_CSTAT_OK );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc2ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentNote( m_hc2ID, m_noteStrCode );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc2ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentNote( hc2ID, m_noteStrCode );
+          m_healthHistory.record( m_seqComp[1], HNTD_HH_STATUS_NOTE, 0 );
 
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc3ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().clearComponentErrMsg( m_hc3ID );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc3ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().clearComponentErrMsg( hc3ID );
+          m_healthHistory.record( m_seqComp[2], HNTD_HH_STATUS_OK, 0 );
         break;
 
         case 4:
           m_hnodeDev.getHealthRef().setComponentStatus( HNDH_ROOT_COMPID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc1ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc2ID, HNDH_CSTAT_OK );
-          m_hnodeDev.getHealthRef().clearComponentNote( m_hc2ID );
-          m_hnodeDev.getHealthRef().setComponentStatus( m_hc3ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc1ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc2ID, HNDH_CSTAT_OK );
+          m_hnodeDev.getHealthRef().clearComponentNote( hc2ID );
+          m_healthHistory.record( m_seqComp[1], HNTD_HH_STATUS_OK, 0 );
+          m_hnodeDev.getHealthRef().setComponentStatus( hc3ID, HNDH_CSTAT_OK );
         break;
     }
 
@@ -193,9 +364,54 @@ HNTestDevice::generateNewHealthState()
     if( m_healthStateSeq > 4 )
       m_healthStateSeq = 0;
 
-    bool changed = m_hnodeDev.getHealthRef().completeUpdateCycle();
+    // The scripted steps touch several components, report the cycle
+    if( m_hnodeDev.getHealthRef().completeUpdateCycle() == true )
+        m_changeFeed.publishHealth( "", "", 0 );
 } 
 
+void
+HNTestDevice::generateRandomHealthChange()
+{
+    std::lock_guard< std::mutex > lock( m_healthLock );
+
+    // Flip one component between OK and FAILED so every step is a change
+    uint32_t index = m_churnRandom() % m_healthTable.size();
+    const std::string &compID = m_healthTable.getID( index );
+
+    m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
+
+    if( m_healthTable.isFailed( index ) )
+    {
+        m_hnodeDev.getHealthRef().setComponentStatus( compID, HNDH_CSTAT_OK );
+        m_hnodeDev.getHealthRef().clearComponentErrMsg( compID );
+        m_changeFeed.publishHealth( compID, "OK", 0 );
+        m_healthHistory.record( index, HNTD_HH_STATUS_OK, 0 );
+    }
+    else
+    {
+        uint errCode = 400 + ( m_churnRandom() % 100 );
+        m_hnodeDev.getHealthRef().setComponentStatus( compID, HNDH_CSTAT_FAILED );
+        m_hnodeDev.getHealthRef().setComponentErrMsg( compID, errCode, m_errStrCode, errCode );
+        m_changeFeed.publishHealth( compID, "FAILED", errCode );
+        m_healthHistory.record( index, HNTD_HH_STATUS_FAILED, errCode );
+    }
+
+    m_healthTable.setFailed( index, !m_healthTable.isFailed( index ) );
+
+    m_hnodeDev.getHealthRef().completeUpdateCycle();
+}
+
+void
+HNTestDevice::churnStep( HNTD_CHURN_MODE_T mode )
+{
+    if( mode == HNTD_CHURN_MODE_RANDOM )
+        generateRandomHealthChange();
+    else
+        generateNewHealthState();
+
+    m_churnTransitions.store( m_churnTransitions.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+}
+
 bool 
 HNTestDevice::configExists()
 {
@@ -205,19 +421,19 @@ HNTestDevice::configExists()
 }
 
 HNTD_RESULT_T
-HNTestDevice::initConfig()
+HNTestDevice::initConfig( HNodeConfig &cfg )
 {
     HNodeConfigFile cfgFile;
-    HNodeConfig     cfg;
 
     m_hnodeDev.initConfigSections( cfg );
 
-    cfg.debugPrint(2);
+    if( HNTDLog::getInstance().isEnabled( HNTD_LOG_LEVEL_DEBUG ) )
+        cfg.debugPrint(2);
     
-    std::cout << "Saving config..." << std::endl;
+    HNTD_LOG_INFO( "%s: Saving initial config", m_instanceName.c_str() );
     if( cfgFile.saveConfig( HNODE_TEST_DEVTYPE, m_instanceName, cfg ) != HNC_RESULT_SUCCESS )
     {
-        std::cout << "ERROR: Could not save initial configuration." << std::endl;
+        HNTD_LOG_ERROR( "Could not save initial configuration." );
         return HNTD_RESULT_FAILURE;
     }
 
@@ -230,486 +446,1888 @@ HNTestDevice::readConfig()
     HNodeConfigFile cfgFile;
     HNodeConfig     cfg;
 
-    if( configExists() == false )
-        return HNTD_RESULT_FAILURE;
-
-    std::cout << "Loading config..." << std::endl;
+    HNTD_LOG_DEBUG( "%s: Loading config", m_instanceName.c_str() );
 
+    // The caller has already seen the file, a failed load covers it vanishing
     if( cfgFile.loadConfig( HNODE_TEST_DEVTYPE, m_instanceName, cfg ) != HNC_RESULT_SUCCESS )
     {
-        std::cout << "ERROR: Could not load saved configuration." << std::endl;
+        HNTD_LOG_ERROR( "Could not load saved configuration." );
         return HNTD_RESULT_FAILURE;
     }
-  
-    std::cout << "cl1" << std::endl;
+
+    return applyConfig( cfg );
+}
+
+HNTD_RESULT_T
+HNTestDevice::applyConfig( HNodeConfig &cfg )
+{
     m_hnodeDev.readConfigSections( cfg );
 
-    std::cout << "Config loaded" << std::endl;
+    // Fault rules are kept as the JSON given to putFaults
+    HNCSection *secPtr;
+    std::string faultRules;
+
+    if( ( cfg.getSectionPtr( "testFaults", &secPtr ) == HNC_RESULT_SUCCESS ) && ( secPtr->getValueByName( "rules", faultRules ) == HNC_RESULT_SUCCESS ) )
+    {
+        HNTDRequestDecoder decoder( m_maxBodySize );
+        std::string error;
+
+        decoder.setInput( faultRules.data(), faultRules.size() );
+
+        if( applyFaultRules( decoder, error ) != HNTD_RESULT_SUCCESS )
+            HNTD_LOG_ERROR( "%s: Ignoring saved fault rules: %s", m_instanceName.c_str(), error.c_str() );
+
+        // What is on disk now, putting the same rules again writes nothing
+        m_savedRules      = faultRules;
+        m_savedRulesValid = true;
+    }
+
+    HNTD_LOG_DEBUG( "%s: Config loaded", m_instanceName.c_str() );
 
     return HNTD_RESULT_SUCCESS;
 }
 
+// Runs on the persister thread.  A save asked for only by putFaults is
+// skipped when the rules are the ones already on disk; a change from
+// libhnode2 is always saved, the device sections cannot be compared.
 HNTD_RESULT_T
 HNTestDevice::updateConfig()
 {
     HNodeConfigFile cfgFile;
     HNodeConfig     cfg;
 
+    bool deviceChanged = m_deviceConfigChanged.exchange( false );
+
+    pjs::Object jsFaults;
+    HNTD_RESPONSE_BODY_T faultRules;
+    HNCSection *secPtr;
+
+    buildFaultRules( jsFaults );
+
+    if( renderResponse( jsFaults, faultRules ) != HNTD_RESULT_SUCCESS )
+    {
+        if( deviceChanged == true )
+            m_deviceConfigChanged = true;
+
+        HNTD_LOG_ERROR( "Could not render fault rules for the configuration." );
+        return HNTD_RESULT_FAILURE;
+    }
+
+    if( ( deviceChanged == false ) && ( m_savedRulesValid == true ) && ( *faultRules == m_savedRules ) )
+    {
+        HNTD_LOG_DEBUG( "%s: Config unchanged, not saved", m_instanceName.c_str() );
+        return HNTD_RESULT_SUCCESS;
+    }
+
     m_hnodeDev.updateConfigSections( cfg );
 
-    cfg.debugPrint(2);
+    if( cfg.updateSection( "testFaults", &secPtr ) == HNC_RESULT_SUCCESS )
+        secPtr->updateValue( "rules", *faultRules );
+
+    if( HNTDLog::getInstance().isEnabled( HNTD_LOG_LEVEL_DEBUG ) )
+        cfg.debugPrint(2);
     
-    std::cout << "Saving config..." << std::endl;
     if( cfgFile.saveConfig( HNODE_TEST_DEVTYPE, m_instanceName, cfg ) != HNC_RESULT_SUCCESS )
     {
-        std::cout << "ERROR: Could not save configuration." << std::endl;
+        // Keep the device change for the next save to pick up
+        if( deviceChanged == true )
+            m_deviceConfigChanged = true;
+
+        HNTD_LOG_ERROR( "Could not save configuration." );
         return HNTD_RESULT_FAILURE;
     }
-    std::cout << "Config saved" << std::endl;
+
+    m_savedRules      = *faultRules;
+    m_savedRulesValid = true;
 
     return HNTD_RESULT_SUCCESS;
 }
 
 void
-HNTestDevice::loopIteration()
+HNTestDevice::hndnConfigChange( HNodeDevice *parent )
 {
-    // std::cout << "HNManagementDevice::loopIteration() - entry" << std::endl;
+    HNTD_LOG_DEBUG( "HNTestDevice::hndnConfigChange() - entry" );
 
+    m_deviceConfigChanged = true;
+
+    if( m_configPersister != NULL )
+        m_configPersister->requestSave( this );
 }
 
-void
-HNTestDevice::timeoutEvent()
+bool
+HNTestDevice::persistConfig()
 {
-    // std::cout << "HNManagementDevice::timeoutEvent() - entry" << std::endl;
-
+    return ( updateConfig() == HNTD_RESULT_SUCCESS );
 }
 
 void
-HNTestDevice::fdEvent( int sfd )
+HNTestDevice::widgetStored( const HNTD_WIDGET_T &widget, bool created )
 {
-    std::cout << "HNManagementDevice::fdEvent() - entry: " << sfd << std::endl;
-
-    if( m_configUpdateTrigger.isMatch( sfd ) )
-    {
-        std::cout << "m_configUpdateTrigger - updating config" << std::endl;
-        m_configUpdateTrigger.reset();
-        updateConfig();
-    }
+    m_changeFeed.publishWidget( ( created == true ) ? HNTD_CHANGE_WIDGET_CREATED : HNTD_CHANGE_WIDGET_UPDATED,
+                                HNTDWidgetStore::formatID( widget.id ), widget.color, widget.name );
 }
 
 void
-HNTestDevice::fdError( int sfd )
+HNTestDevice::widgetDeleted( uint64_t id )
 {
-    std::cout << "HNManagementDevice::fdError() - entry: " << sfd << std::endl;
-
+    m_changeFeed.publishWidget( HNTD_CHANGE_WIDGET_DELETED, HNTDWidgetStore::formatID( id ), "", "" );
 }
 
-void
-HNTestDevice::hndnConfigChange( HNodeDevice *parent )
+// Read the request body into the decoder, a body over the size limit
+// is answered here with 413 and the connection is not reused.
+HNTD_RESULT_T
+HNTestDevice::loadRequestBody( HNOperationData *opData, HNTDRequestDecoder &decoder )
 {
-    std::cout << "HNManagementDevice::hndnConfigChange() - entry" << std::endl;
-    m_configUpdateTrigger.trigger();
+    if( decoder.load( opData->requestBody(), opData->getRequest().getContentLength() ) == HNTDRD_RESULT_SUCCESS )
+        return HNTD_RESULT_SUCCESS;
+
+    HNTD_LOG_WARN( "%s: rejected request body: %s", opData->getOpID().c_str(), decoder.getError().c_str() );
+
+    opData->getResponse().setKeepAlive( false );
+    opData->getResponse().setStatusAndReason( Poco::Net::HTTPResponse::HTTP_REQUEST_ENTITY_TOO_LARGE );
+    opData->responseSend();
+
+    return HNTD_RESULT_FAILURE;
 }
 
-void 
-HNTestDevice::dispatchEP( HNodeDevice *parent, HNOperationData *opData )
+// Decode a widget body, any error has already been answered
+HNTD_RESULT_T
+HNTestDevice::parseWidgetFields( HNOperationData *opData, HNTD_WIDGET_FIELDS_T &fields )
 {
-    std::cout << "HNTestDevice::dispatchEP() - entry" << std::endl;
-    std::cout << "  dispatchID: " << opData->getDispatchID() << std::endl;
-    std::cout << "  opID: " << opData->getOpID() << std::endl;
-    std::cout << "  thread: " << std::this_thread::get_id() << std::endl;
+    HNTDRequestDecoder decoder( m_maxBodySize );
 
-    std::string opID = opData->getOpID();
-          
-    // GET "/hnode2/test/status"
-    if( "getStatus" == opID )
+    if( loadRequestBody( opData, decoder ) != HNTD_RESULT_SUCCESS )
+        return HNTD_RESULT_BAD_REQUEST;
+
+    if( decoder.decodeWidgetFields( fields ) != HNTDRD_RESULT_SUCCESS )
     {
-        std::cout << "=== Get Status Request ===" << std::endl;
-    
-        // Set response content type
-        opData->responseSetChunkedTransferEncoding( true );
-        opData->responseSetContentType( "application/json" );
+        HNTD_LOG_DEBUG( "parseWidgetFields: %s", decoder.getError().c_str() );
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return HNTD_RESULT_BAD_REQUEST;
+    }
 
-        // Create a json status object
-        pjs::Object jsRoot;
-        jsRoot.set( "overallStatus", "OK" );
+    return HNTD_RESULT_SUCCESS;
+}
 
-        // Render response content
-        std::ostream& ostr = opData->responseSend();
-        try{ 
-            pjs::Stringifier::stringify( jsRoot, ostr, 1 ); 
-        } catch( ... ) {
-            std::cout << "ERROR: Exception while serializing comment" << std::endl;
-        }
+HNTD_RESULT_T
+HNTestDevice::renderResponse( const pdy::Var &jsRoot, HNTD_RESPONSE_BODY_T &body )
+{
+    std::ostringstream ostr;
 
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
+    try{ 
+        pjs::Stringifier::stringify( jsRoot, ostr, 1 ); 
+    } catch( ... ) {
+        HNTD_LOG_ERROR( "Exception while serializing response" );
+        return HNTD_RESULT_SERVER_ERROR;
     }
-    // GET "/hnode2/test/widgets"
-    else if( "getWidgetList" == opID )
-    {
-        std::cout << "=== Get Widget List Request ===" << std::endl;
 
-        // Set response content type
-        opData->responseSetChunkedTransferEncoding( true );
-        opData->responseSetContentType( "application/json" );
+    body = std::make_shared< const std::string >( ostr.str() );
 
-        // Create a json root object
-        pjs::Array jsRoot;
-
-        pjs::Object w1Obj;
-        w1Obj.set( "id", "w1" );
-        w1Obj.set( "color", "red" );
-        jsRoot.add( w1Obj );
+    return HNTD_RESULT_SUCCESS;
+}
 
-        pjs::Object w2Obj;
-        w2Obj.set( "id", "w2" );
-        w2Obj.set( "color", "green" );
-        jsRoot.add( w2Obj );
+// Compressed form of body, from the response cache when the body came
+// from it under cacheKey.  Returns body itself when compressing does not
+// make it smaller, and caches that too so it is not tried again.
+HNTD_RESPONSE_BODY_T
+HNTestDevice::encodeBody( const HNTD_RESPONSE_BODY_T &body, HNTD_ENCODING_T encoding, const std::string &cacheKey, uint64_t version )
+{
+    HNTD_RESPONSE_BODY_T encoded;
 
-        pjs::Object w3Obj;
-        w3Obj.set( "id", "w3" );
-        w3Obj.set( "color", "blue" );
-        jsRoot.add( w3Obj );
-          
-        // Render response content
-        std::ostream& ostr = opData->responseSend();
-        try{ 
-            pjs::Stringifier::stringify( jsRoot, ostr, 1 ); 
-        } catch( ... ) {
-            std::cout << "ERROR: Exception while serializing comment" << std::endl;
-        }
-            
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
-    }
-    // GET "/hnode2/test/widgets/{widgetid}"
-    else if( "getWidgetInfo" == opID )
+    if( cacheKey.empty() == false )
     {
-        std::string widgetID;
-
-        if( opData->getParam( "widgetid", widgetID ) == true )
-        {
-            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
-            opData->responseSend();
-            return; 
-        }
+        encoded = m_responseCache.lookupEncoded( cacheKey, version, encoding );
+        if( encoded )
+            return encoded;
+    }
 
-        std::cout << "=== Get Widget Info Request (id: " << widgetID << ") ===" << std::endl;
+    std::string out;
+    if( ( HNTDContentEncoder::encode( encoding, *body, out ) == true ) && ( out.size() < body->size() ) )
+        encoded = std::make_shared< const std::string >( std::move( out ) );
+    else
+        encoded = body;
 
-        // Set response content type
-        opData->responseSetChunkedTransferEncoding( true );
-        opData->responseSetContentType( "application/json" );
-        
-        // Create a json root object
-        pjs::Array jsRoot;
+    if( cacheKey.empty() == false )
+        m_responseCache.storeEncoded( cacheKey, version, encoding, encoded );
 
-        pjs::Object w1Obj;
-        w1Obj.set( "id", widgetID );
-        w1Obj.set( "color", "black" );
-        jsRoot.add( w1Obj );
-          
-        // Render response content
-        std::ostream& ostr = opData->responseSend();
-        try{ 
-            pjs::Stringifier::stringify( jsRoot, ostr, 1 ); 
-        } catch( ... ) {
-            std::cout << "ERROR: Exception while serializing comment" << std::endl;
-        }            
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
+    return encoded;
+}
 
-    }
-    // POST "/hnode2/test/widgets"
-    else if( "createWidget" == opID )
-    {
-        std::istream& rs = opData->requestBody();
-        std::string body;
-        Poco::StreamCopier::copyToString( rs, body );
-        
-        std::cout << "=== Create Widget Post Data ===" << std::endl;
-        std::cout << body << std::endl;
+// Send a serialized body, compressed if the client accepts it and the
+// body is large enough.  A body from the response cache passes its
+// key and version so its compressed form is cached with it, others
+// pass an empty key.
+void
+HNTestDevice::sendResponseBody( HNOperationData *opData, const HNTD_RESPONSE_BODY_T &body, const std::string &cacheKey, uint64_t version )
+{
+    HNTD_RESPONSE_BODY_T sendBody = body;
+    HNTD_ENCODING_T encoding = HNTD_ENCODING_IDENTITY;
 
-        // Object was created return info
-        opData->responseSetCreated( "w1" );
-        opData->responseSetStatusAndReason( HNR_HTTP_CREATED );
-    }
-    // PUT "/hnode2/test/widgets/{widgetid}"
-    else if( "updateWidget" == opID )
+    if( ( body->size() >= m_compressMinSize ) && opData->getRequest().has( "Accept-Encoding" ) )
     {
-        std::string widgetID;
+        encoding = HNTDContentEncoder::negotiate( opData->getRequest().get( "Accept-Encoding" ) );
 
-        // Make sure zoneid was provided
-        if( opData->getParam( "widgetid", widgetID ) == true )
-        {
-            // widgetid parameter is required
-            opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
-            opData->responseSend();
-            return; 
-        }
-        
-        std::istream& rs = opData->requestBody();
-        std::string body;
-        Poco::StreamCopier::copyToString( rs, body );
-        
-        std::cout << "=== Update Widget Put Data (id: " << widgetID << ") ===" << std::endl;
-        std::cout << body << std::endl;
-
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
-    }    
-    // DELETE "/hnode2/test/widgets/{widgetid}"
-    else if( "deleteWidget" == opID )
-    {
-        std::string widgetID;
-
-        // Make sure zoneid was provided
-        if( opData->getParam( "widgetid", widgetID ) == true )
+        if( encoding != HNTD_ENCODING_IDENTITY )
         {
-            // widgetid parameter is required
-            opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
-            opData->responseSend();
-            return; 
+            sendBody = encodeBody( body, encoding, cacheKey, version );
+            if( sendBody == body )
+                encoding = HNTD_ENCODING_IDENTITY;
         }
+    }
 
-        std::cout << "=== Delete Widget Request (id: " << widgetID << ") ===" << std::endl;
+    opData->getResponse().set( "Vary", "Accept-Encoding" );
 
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
-    }
-    // PUT "/hnode2/test/health"
-    else if( "putTestHealth" == opID )
+    if( encoding != HNTD_ENCODING_IDENTITY )
     {
-        // Get access to payload
-        std::istream& rs = opData->requestBody();
+        opData->getResponse().set( "Content-Encoding", HNTDContentEncoder::getName( encoding ) );
 
-        // Parse the json body of the request
-        try
+        // Each coding is its own representation, with its own strong tag
+        if( opData->getResponse().has( "ETag" ) )
         {
-            std::string component = HNDH_ROOT_COMPID;
-            std::string status = "OK";
-            uint errCode = 200;
+            std::string etag = opData->getResponse().get( "ETag" );
+            etag.insert( etag.size() - 1, std::string( "-" ) + HNTDContentEncoder::getName( encoding ) );
+            opData->getResponse().set( "ETag", etag );
+        }
+    }
 
-            // Attempt to parse the json
-            pjs::Parser parser;
-            pdy::Var varRoot = parser.parse( rs );
+    // The body is already serialized so send it with an exact length
+    opData->responseSetChunkedTransferEncoding( false );
+    opData->responseSetContentType( "application/json" );
+    opData->getResponse().setContentLength( sendBody->size() );
 
-            // Get a pointer to the root object
-            pjs::Object::Ptr jsRoot = varRoot.extract< pjs::Object::Ptr >();
+    // Request was successful
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
 
-            if( jsRoot->has( "component" ) )
-                component = jsRoot->getValue<std::string>( "component" );
+    std::ostream& ostr = opData->responseSend();
+    ostr.write( sendBody->data(), sendBody->size() );
+}
 
-            if( jsRoot->has( "status" ) )
-                status = jsRoot->getValue<std::string>( "status" );
+// Strong entity tag for one representation of a resource at version.
+// variant tells apart representations of the same version.
+std::string
+HNTestDevice::makeETag( uint64_t version, const std::string &variant )
+{
+    return "\"" + m_etagEpoch + "-" + std::to_string( version ) + variant + "\"";
+}
 
-            if( jsRoot->has( "errCode" ) )
-                errCode = jsRoot->getValue<uint>( "errCode" );
+// Tag the response with etag and, if If-None-Match names it in any
+// content coding, answer 304 without a body.  Returns true if the
+// response has been sent.
+bool
+HNTestDevice::sendNotModified( HNOperationData *opData, const std::string &etag )
+{
+    opData->getResponse().set( "ETag", etag );
 
-            m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
+    if( opData->getRequest().has( "If-None-Match" ) == false )
+        return false;
 
-            if( status == "OK" )
-            {
-                m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_OK );
-                m_hnodeDev.getHealthRef().clearComponentErrMsg( component );
-                m_hnodeDev.getHealthRef().clearComponentNote( component );
-            }
-            else if( status == "UNKNOWN" )
-            {
-                m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_UNKNOWN );
-                m_hnodeDev.getHealthRef().clearComponentErrMsg( component );
-            }
-            else if( status == "FAILED" )
-            {
-                m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_FAILED );
-                m_hnodeDev.getHealthRef().setComponentErrMsg( component, errCode, m_errStrCode, errCode );
-            }
-            else if( status == "NOTE" )
-            {
-                m_hnodeDev.getHealthRef().setComponentNote( component, m_noteStrCode );
-            }
+    // A comma separated list, compared weakly as RFC 7232 asks
+    const std::string &header = opData->getRequest().get( "If-None-Match" );
 
-            m_hnodeDev.getHealthRef().completeUpdateCycle();
+    bool match = false;
+    std::string::size_type pos = 0;
 
-        }
-        catch( Poco::Exception ex )
+    while( ( match == false ) && ( pos < header.size() ) )
+    {
+        std::string::size_type end = header.find( ',', pos );
+        if( end == std::string::npos )
+            end = header.size();
+
+        std::string::size_type first = header.find_first_not_of( " \t", pos );
+        std::string::size_type last  = header.find_last_not_of( " \t", end - 1 );
+
+        if( ( first != std::string::npos ) && ( first < end ) && ( last >= first ) )
         {
-            std::cout << "putTestHealth exception: " << ex.displayText() << std::endl;
-            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
-            opData->responseSend();
-            return;
-        }
+            std::string tag = header.substr( first, last - first + 1 );
 
-        // Request was successful
-        opData->responseSetStatusAndReason( HNR_HTTP_OK );
-    }        
-    else
-    {
-        // Send back not implemented
-        opData->responseSetStatusAndReason( HNR_HTTP_NOT_IMPLEMENTED );
-        opData->responseSend();
-        return;
-    }
+            if( tag.compare( 0, 2, "W/" ) == 0 )
+                tag.erase( 0, 2 );
 
-    // Return to caller
-    opData->responseSend();
-}
+            match = ( tag == "*" ) || ( tag == etag );
 
-const std::string g_HNode2TestRest = R"(
-{
-  "openapi": "3.0.0",
-  "info": {
-    "description": "",
-    "version": "1.0.0",
-    "title": ""
-  },
-  "paths": {
-      "/hnode2/test/status": {
-        "get": {
-          "summary": "Get test device status.",
-          "operationId": "getStatus",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "array"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        }
-      },
-
-      "/hnode2/test/widgets": {
-        "get": {
-          "summary": "Return made up widget list.",
-          "operationId": "getWidgetList",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "object"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        },
-
-        "post": {
-          "summary": "Create a new widget - dummy.",
-          "operationId": "createWidget",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "object"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        }
-      },
-
-      "/hnode2/test/widgets/{widgetid}": {
-        "get": {
-          "summary": "Get information about a specific widget - dummy.",
-          "operationId": "getWidgetInfo",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "object"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        },
-        "put": {
-          "summary": "Update a specific widget - dummy.",
-          "operationId": "updateWidget",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "object"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        },
-        "delete": {
-          "summary": "Delete a specific widget - dummy",
-          "operationId": "deleteWidget",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "object"
-                  }
-                }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
-            }
-          }
-        }
-      },
-
-      "/hnode2/test/health": {
-        "put": {
-          "summary": "Cause a health state transistion",
-          "operationId": "putTestHealth",
-          "responses": {
-            "200": {
-              "description": "successful operation",
-              "content": {
-                "application/json": {
-                  "schema": {
-                    "type": "array"
-                  }
+            // The client may hold a compressed representation
+            for( uint i = HNTD_ENCODING_GZIP; ( match == false ) && ( i < HNTD_ENCODING_COUNT ); i++ )
+            {
+                std::string suffix = std::string( "-" ) + HNTDContentEncoder::getName( (HNTD_ENCODING_T) i ) + "\"";
+
+                if( ( tag.size() == ( etag.size() + suffix.size() - 1 ) )
+                    && ( tag.compare( 0, etag.size() - 1, etag, 0, etag.size() - 1 ) == 0 )
+                    && ( tag.compare( etag.size() - 1, std::string::npos, suffix ) == 0 ) )
+                {
+                    // Answer with the tag of the representation it has
+                    opData->getResponse().set( "ETag", tag );
+                    match = true;
                 }
-              }
-            },
-            "400": {
-              "description": "Invalid status value"
             }
-          }
         }
-      }
+
+        pos = end + 1;
+    }
+
+    if( match == false )
+        return false;
+
+    opData->responseSetChunkedTransferEncoding( false );
+    opData->getResponse().setStatusAndReason( Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED );
+    opData->responseSend();
+
+    return true;
+}
+
+// Synthetic payload size and shape for a request, from the payloadSize
+// and payloadShape query parameters or else the device default.  A
+// size of 0 asks for the plain response.
+HNTD_RESULT_T
+HNTestDevice::getPayloadRequest( const HNTD_GET_WIDGET_INFO_PARAMS_T &params, uint64_t &size, HNTD_PAYLOAD_SHAPE_T &shape )
+{
+    size  = ( params.hasPayloadSize == true ) ? params.payloadSize : m_payloadSize;
+    shape = m_payloadShape;
+
+    if( ( params.hasPayloadShape == true ) && ( HNTDPayloadArena::parseShapeName( params.payloadShape, shape ) == false ) )
+        return HNTD_RESULT_BAD_REQUEST;
+
+    if( ( size != 0 ) && ( ( size < HNTD_PAYLOAD_MIN_SIZE ) || ( size > HNTD_PAYLOAD_MAX_SIZE ) ) )
+        return HNTD_RESULT_BAD_REQUEST;
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+// Widget list query from the getWidgetList query parameters.  A
+// cursor must come back with the sort it was made for.
+HNTD_RESULT_T
+HNTestDevice::getWidgetQuery( const HNTD_GET_WIDGET_LIST_PARAMS_T &params, HNTD_WIDGET_QUERY_T &query )
+{
+    query.hasColor = params.hasColor;
+    query.color    = params.color;
+    query.hasName  = params.hasName;
+    query.name     = params.name;
+
+    if( params.hasSort == true )
+    {
+        std::string field = params.sort;
+
+        query.descending = ( field.empty() == false ) && ( field[0] == '-' );
+        if( query.descending == true )
+            field.erase( 0, 1 );
+
+        if( field == "id" )
+            query.sort = HNTD_WIDGET_SORT_ID;
+        else if( field == "name" )
+            query.sort = HNTD_WIDGET_SORT_NAME;
+        else if( field == "color" )
+            query.sort = HNTD_WIDGET_SORT_COLOR;
+        else
+            return HNTD_RESULT_BAD_REQUEST;
+    }
+
+    if( params.hasLimit == true )
+    {
+        if( ( params.limit < 1 ) || ( params.limit > HNTD_WIDGET_QUERY_MAX_LIMIT ) )
+            return HNTD_RESULT_BAD_REQUEST;
+
+        query.limit = params.limit;
+    }
+
+    if( ( params.hasCursor == true ) && ( HNTDWidgetStore::parseCursor( params.cursor, query ) == false ) )
+        return HNTD_RESULT_BAD_REQUEST;
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+// Answer a widget list query with one page, an object holding the
+// widgets and, if there are more, the cursor for the next page.  Each
+// distinct query is its own representation of the list, with its own
+// entity tag variant and response cache entry.
+void
+HNTestDevice::queryWidgetList( HNOperationData *opData, const HNTD_GET_WIDGET_LIST_PARAMS_T &params )
+{
+    HNTD_WIDGET_QUERY_T query;
+
+    if( getWidgetQuery( params, query ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    // Length prefixed so no parameter value can pass for another
+    std::string cacheKey = "widgets?";
+    if( params.hasColor )
+        cacheKey += "c" + std::to_string( params.color.size() ) + ":" + params.color;
+    if( params.hasName )
+        cacheKey += "n" + std::to_string( params.name.size() ) + ":" + params.name;
+    if( params.hasSort )
+        cacheKey += "s" + params.sort + ":";
+    if( params.hasLimit )
+        cacheKey += "l" + std::to_string( params.limit ) + ":";
+    if( params.hasCursor )
+        cacheKey += "p" + params.cursor;
+
+    Poco::Checksum crc( Poco::Checksum::TYPE_CRC32 );
+    crc.update( cacheKey );
+
+    std::string variant = "-q" + std::to_string( crc.checksum() ) + "." + std::to_string( cacheKey.size() );
+
+    uint64_t version = m_widgetStore.getVersion();
+
+    if( sendNotModified( opData, makeETag( version, variant ) ) == true )
+        return;
+
+    HNTD_RESPONSE_BODY_T body = m_responseCache.lookup( cacheKey, version );
+
+    if( !body )
+    {
+        std::vector< HNTD_WIDGET_T > page;
+        bool more;
+
+        m_widgetStore.queryWidgets( query, page, more );
+
+        // Create a json root object
+        pjs::Object jsRoot;
+        pjs::Array  jsWidgets;
+
+        for( std::vector< HNTD_WIDGET_T >::iterator it = page.begin(); it != page.end(); it++ )
+        {
+            pjs::Object wObj;
+            wObj.set( "id", HNTDWidgetStore::formatID( it->id ) );
+            wObj.set( "color", it->color );
+            wObj.set( "name", it->name );
+            jsWidgets.add( wObj );
+        }
+
+        jsRoot.set( "widgets", jsWidgets );
+
+        if( more == true )
+            jsRoot.set( "nextCursor", HNTDWidgetStore::makeCursor( query, page.back() ) );
+
+        if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+            opData->responseSend();
+            return;
+        }
+
+        m_responseCache.store( cacheKey, version, body );
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, cacheKey, version );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// Send a widget with a payload field that brings the body to exactly
+// size bytes, or to the bare widget if that is already larger.  Only
+// the widget fields are rendered, the payload is written straight out
+// of the shared arena and records are padded to length with whitespace.
+void
+HNTestDevice::sendSyntheticPayload( HNOperationData *opData, const std::string &widgetID, const HNTD_WIDGET_T &widget, uint64_t size, HNTD_PAYLOAD_SHAPE_T shape )
+{
+    static const std::string spaces( HNTDPayloadArena::RECORD_SIZE, ' ' );
+
+    pjs::Object wObj;
+    wObj.set( "id", widgetID );
+    wObj.set( "color", widget.color );
+    wObj.set( "name", widget.name );
+
+    std::ostringstream hstr;
+    try{
+        pjs::Stringifier::stringify( wObj, hstr );
+    } catch( ... ) {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Reopen the widget object to append the payload member
+    std::string head = hstr.str();
+    head.pop_back();
+    head = "[" + head + ",\"payload\":" + ( ( shape == HNTD_PAYLOAD_SHAPE_BLOB ) ? "\"" : "[" );
+
+    const char *tail = ( shape == HNTD_PAYLOAD_SHAPE_BLOB ) ? "\"}]" : "]}]";
+
+    uint64_t fixedLen = head.size() + strlen( tail );
+    uint64_t fillLen  = ( size > fixedLen ) ? ( size - fixedLen ) : 0;
+
+    // Records are whole, less the last comma, and the rest is spaces
+    uint64_t arenaLen = fillLen;
+    if( shape == HNTD_PAYLOAD_SHAPE_RECORDS )
+    {
+        arenaLen = ( fillLen / HNTDPayloadArena::RECORD_SIZE ) * HNTDPayloadArena::RECORD_SIZE;
+        if( arenaLen > 0 )
+            arenaLen -= 1;
+    }
+
+    const char *filler = m_payloadArena->getFiller( shape, arenaLen );
+    if( filler == NULL )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    opData->responseSetChunkedTransferEncoding( false );
+    opData->responseSetContentType( "application/json" );
+    opData->getResponse().setContentLength( fixedLen + fillLen );
+
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+
+    std::ostream& ostr = opData->responseSend();
+    ostr.write( head.data(), head.size() );
+    ostr.write( filler, arenaLen );
+    ostr.write( spaces.data(), fillLen - arenaLen );
+    ostr.write( tail, strlen( tail ) );
+}
+
+static uint64_t
+hntdNowNS()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL ) + ts.tv_nsec;
+}
+
+void
+HNTestDevice::registerOperations()
+{
+    if( m_metrics == NULL )
+        m_metrics = new HNTDMetrics( HNTD_OPERATION_COUNT );
+
+    if( m_faults == NULL )
+        m_faults = new HNTDFaultInjector( HNTD_OPERATION_COUNT );
+}
+
+void
+HNTestDevice::recordMetrics( uint opIndex, HNOperationData *opData, uint64_t startNS )
+{
+    uint64_t latencyNS = hntdNowNS() - startNS;
+
+    // Content lengths are -1 when not known, e.g. chunked bodies
+    std::streamsize bytesIn  = opData->getRequest().getContentLength();
+    std::streamsize bytesOut = opData->getResponse().getContentLength();
+
+    bool error = ( opData->getResponse().getStatus() >= Poco::Net::HTTPResponse::HTTP_BAD_REQUEST );
+
+    m_metrics->record( opIndex, latencyNS, error, ( bytesIn > 0 ) ? bytesIn : 0, ( bytesOut > 0 ) ? bytesOut : 0 );
+}
+
+void 
+HNTestDevice::dispatchEP( HNodeDevice *parent, HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "HNTestDevice::dispatchEP() - dispatchID: %s  opID: %s", opData->getDispatchID().c_str(), opData->getOpID().c_str() );
+
+    // The operation table is generated from the spec, so every operation
+    // it names has a handler
+    int opIndex = hntdFindOperation( opData->getOpID() );
+
+    if( opIndex < 0 )
+    {
+        // Send back not implemented
+        opData->responseSetStatusAndReason( HNR_HTTP_NOT_IMPLEMENTED );
+        opData->responseSend();
+        return;
+    }
+
+    uint64_t startNS = hntdNowNS();
+
+    if( ( g_HNTDOperations[ opIndex ].faultable == true ) && ( injectFaults( opIndex, opData, startNS ) == true ) )
+        return;
+
+    ( this->*( g_HNTDOperations[ opIndex ].handler ) )( opData );
+
+    recordMetrics( opIndex, opData, startNS );
+}
+
+// Apply the injected faults for one request.  Returns true if the
+// request has been answered or dropped and the handler must not run.
+bool
+HNTestDevice::injectFaults( uint opIndex, HNOperationData *opData, uint64_t startNS )
+{
+    HNTD_FAULT_DECISION_T fault;
+
+    m_faults->decide( opIndex, fault );
+
+    if( ( fault.delayNS > 0 ) && ( m_delayScheduler != NULL ) )
+    {
+        // Each delay blocks its worker, so past the cap answer straight
+        // away and leave the rest of the pool to undelayed requests
+        if( m_delayedNow.fetch_add( 1 ) >= m_maxDelayed )
+        {
+            m_delayedNow.fetch_sub( 1 );
+            m_delayRejects++;
+
+            if( opData->getRequest().hasContentLength() || opData->getRequest().getChunkedTransferEncoding() )
+                opData->getResponse().setKeepAlive( false );
+
+            opData->getResponse().set( "Retry-After", "1" );
+            opData->getResponse().setStatusAndReason( Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE );
+            opData->responseSend();
+
+            recordMetrics( opIndex, opData, startNS );
+            return true;
+        }
+
+        m_delayScheduler->delay( fault.delayNS );
+        m_delayedNow.fetch_sub( 1 );
+    }
+
+    if( fault.drop == true )
+    {
+        dropConnection( opData );
+        m_metrics->record( opIndex, hntdNowNS() - startNS, true, 0, 0 );
+        return true;
+    }
+
+    if( fault.errorStatus != 0 )
+    {
+        // An unread request body must not be taken for the next request
+        if( opData->getRequest().hasContentLength() || opData->getRequest().getChunkedTransferEncoding() )
+            opData->getResponse().setKeepAlive( false );
+
+        opData->getResponse().setStatusAndReason( (Poco::Net::HTTPResponse::HTTPStatus) fault.errorStatus );
+        opData->responseSend();
+
+        recordMetrics( opIndex, opData, startNS );
+        return true;
+    }
+
+    return false;
+}
+
+// Close the client's connection without a response
+void
+HNTestDevice::dropConnection( HNOperationData *opData )
+{
+    opData->getResponse().setKeepAlive( false );
+
+    Poco::Net::HTTPServerRequestImpl *request = dynamic_cast< Poco::Net::HTTPServerRequestImpl* >( &opData->getRequest() );
+    if( request == NULL )
+        return;
+
+    try
+    {
+        // A zero linger turns the server's close into a reset
+        request->socket().setLinger( true, 0 );
+        request->socket().shutdown();
+    }
+    catch( Poco::Exception ex )
+    {
+        HNTD_LOG_DEBUG( "dropConnection: %s", ex.displayText().c_str() );
+    }
+}
+
+// GET "/hnode2/test/status"
+void
+HNTestDevice::handleGetStatus( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Get Status Request ===" );
+
+    if( sendNotModified( opData, makeETag( m_statusVersion, "" ) ) == true )
+        return;
+
+    HNTD_RESPONSE_BODY_T body = m_responseCache.lookup( "status", m_statusVersion );
+
+    if( !body )
+    {
+        // Create a json status object
+        pjs::Object jsRoot;
+        jsRoot.set( "overallStatus", "OK" );
+
+        if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+            opData->responseSend();
+            return;
+        }
+
+        m_responseCache.store( "status", m_statusVersion, body );
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "status", m_statusVersion );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// GET "/hnode2/test/widgets"
+void
+HNTestDevice::handleGetWidgetList( HNOperationData *opData )
+{
+    HNTD_GET_WIDGET_LIST_PARAMS_T params;
+
+    if( hntdExtractGetWidgetListParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    HNTD_LOG_DEBUG( "=== Get Widget List Request ===" );
+
+    if( params.hasColor || params.hasName || params.hasSort || params.hasLimit || params.hasCursor )
+    {
+        queryWidgetList( opData, params );
+        return;
+    }
+
+    // Sample the version before reading the list, so a concurrent
+    // write can only ever cause the cached copy to look stale.
+    uint64_t version = m_widgetStore.getVersion();
+
+    if( sendNotModified( opData, makeETag( version, "" ) ) == true )
+        return;
+
+    HNTD_RESPONSE_BODY_T body = m_responseCache.lookup( "widgets", version );
+
+    if( !body )
+    {
+        // Create a json root object
+        pjs::Array jsRoot;
+
+        std::vector< HNTD_WIDGET_T > widgetList;
+        m_widgetStore.getWidgetList( widgetList );
+
+        for( std::vector< HNTD_WIDGET_T >::iterator it = widgetList.begin(); it != widgetList.end(); it++ )
+        {
+            pjs::Object wObj;
+            wObj.set( "id", HNTDWidgetStore::formatID( it->id ) );
+            wObj.set( "color", it->color );
+            wObj.set( "name", it->name );
+            jsRoot.add( wObj );
+        }
+
+        if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+            opData->responseSend();
+            return;
+        }
+
+        m_responseCache.store( "widgets", version, body );
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "widgets", version );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// GET "/hnode2/test/widgets/{widgetid}"
+void
+HNTestDevice::handleGetWidgetInfo( HNOperationData *opData )
+{
+    HNTD_GET_WIDGET_INFO_PARAMS_T params;
+
+    if( hntdExtractGetWidgetInfoParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    const std::string &widgetID = params.widgetid;
+
+    HNTD_LOG_DEBUG( "=== Get Widget Info Request (id: %s) ===", widgetID.c_str() );
+
+    HNTD_WIDGET_T widget;
+    if( m_widgetStore.getWidget( widgetID, widget ) != HNTDWS_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_NOT_FOUND );
+        opData->responseSend();
+        return; 
+    }
+
+    uint64_t payloadSize;
+    HNTD_PAYLOAD_SHAPE_T payloadShape;
+    if( getPayloadRequest( params, payloadSize, payloadShape ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    bool synthetic = ( payloadSize > 0 ) && ( m_payloadArena != NULL );
+
+    // A synthetic payload is its own representation of the widget
+    std::string variant;
+    if( synthetic == true )
+        variant = "-" + std::to_string( payloadSize ) + HNTDPayloadArena::getShapeName( payloadShape );
+
+    if( sendNotModified( opData, makeETag( widget.version, variant ) ) == true )
+        return;
+
+    // "w7" and "w007" name the same widget, cache and answer with one form
+    std::string canonicalID = HNTDWidgetStore::formatID( widget.id );
+
+    if( synthetic == true )
+    {
+        sendSyntheticPayload( opData, canonicalID, widget, payloadSize, payloadShape );
+        return;
+    }
+
+    HNTD_RESPONSE_BODY_T body = m_responseCache.lookup( canonicalID, widget.version );
+
+    if( !body )
+    {
+        // Create a json root object
+        pjs::Array jsRoot;
+
+        pjs::Object w1Obj;
+        w1Obj.set( "id", canonicalID );
+        w1Obj.set( "color", widget.color );
+        w1Obj.set( "name", widget.name );
+        jsRoot.add( w1Obj );
+
+        if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+            opData->responseSend();
+            return;
+        }
+
+        m_responseCache.store( canonicalID, widget.version, body );
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, canonicalID, widget.version );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// POST "/hnode2/test/widgets"
+void
+HNTestDevice::handleCreateWidget( HNOperationData *opData )
+{
+    HNTD_WIDGET_FIELDS_T fields;
+    HNTD_WIDGET_T widget;
+
+    HNTD_LOG_DEBUG( "=== Create Widget Request ===" );
+
+    if( parseWidgetFields( opData, fields ) != HNTD_RESULT_SUCCESS )
+        return; 
+
+    m_widgetStore.createWidget( fields, widget );
+
+    // Object was created return info
+    opData->responseSetCreated( HNTDWidgetStore::formatID( widget.id ) );
+    opData->responseSetStatusAndReason( HNR_HTTP_CREATED );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// POST "/hnode2/test/bulk/widgets"
+void
+HNTestDevice::handleBulkCreateWidgets( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Bulk Create Widgets Request ===" );
+
+    // One widget per line, each is created as soon as it is parsed
+    HNTDLineReader reader( opData->requestBody(), HNTD_BULK_MAX_LINE );
+    HNTDRequestDecoder decoder( HNTD_BULK_MAX_LINE );
+
+    pjs::Array jsErrors;
+    uint created = 0;
+    uint failed  = 0;
+
+    HNTDLR_RESULT_T lineResult;
+    while( ( lineResult = reader.next() ) != HNTDLR_RESULT_END )
+    {
+        std::string error;
+
+        if( lineResult == HNTDLR_RESULT_TOO_LONG )
+            error = "line too long";
+        else
+        {
+            const std::string &line = reader.getLine();
+
+            if( line.find_first_not_of( " \t" ) == std::string::npos )
+                continue;
+
+            HNTD_WIDGET_FIELDS_T fields;
+            HNTD_WIDGET_T widget;
+
+            decoder.setInput( line.data(), line.size() );
+
+            if( decoder.decodeWidgetFields( fields ) != HNTDRD_RESULT_SUCCESS )
+                error = decoder.getError();
+            else if( m_widgetStore.createWidget( fields, widget ) != HNTDWS_RESULT_SUCCESS )
+                error = "widget store failure";
+            else
+            {
+                created += 1;
+                continue;
+            }
+        }
+
+        failed += 1;
+
+        if( jsErrors.size() < HNTD_BULK_MAX_ERRORS )
+        {
+            pjs::Object jsError;
+            jsError.set( "line", reader.getLineNumber() );
+            jsError.set( "error", error );
+            jsErrors.add( jsError );
+        }
+    }
+
+    HNTD_LOG_DEBUG( "bulkCreateWidgets: %u created, %u failed", created, failed );
+
+    pjs::Object jsRoot;
+    jsRoot.set( "lines", reader.getLineNumber() );
+    jsRoot.set( "created", created );
+    jsRoot.set( "failed", failed );
+    jsRoot.set( "errors", jsErrors );
+    jsRoot.set( "errorsTruncated", ( failed > jsErrors.size() ) );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// PUT "/hnode2/test/widgets/{widgetid}"
+void
+HNTestDevice::handleUpdateWidget( HNOperationData *opData )
+{
+    HNTD_UPDATE_WIDGET_PARAMS_T params;
+
+    // widgetid parameter is required
+    if( hntdExtractUpdateWidgetParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    const std::string &widgetID = params.widgetid;
+    
+    HNTD_WIDGET_FIELDS_T fields;
+    HNTD_WIDGET_T widget;
+
+    HNTD_LOG_DEBUG( "=== Update Widget Request (id: %s) ===", widgetID.c_str() );
+
+    if( parseWidgetFields( opData, fields ) != HNTD_RESULT_SUCCESS )
+        return; 
+
+    if( m_widgetStore.updateWidget( widgetID, fields, widget ) != HNTDWS_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_NOT_FOUND );
+        opData->responseSend();
+        return; 
+    }
+
+    std::string canonicalID = HNTDWidgetStore::formatID( widget.id );
+
+    m_responseCache.invalidate( canonicalID );
+
+    // Request was successful
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// DELETE "/hnode2/test/widgets/{widgetid}"
+void
+HNTestDevice::handleDeleteWidget( HNOperationData *opData )
+{
+    HNTD_DELETE_WIDGET_PARAMS_T params;
+
+    // widgetid parameter is required
+    if( hntdExtractDeleteWidgetParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return; 
+    }
+
+    const std::string &widgetID = params.widgetid;
+
+    HNTD_LOG_DEBUG( "=== Delete Widget Request (id: %s) ===", widgetID.c_str() );
+
+    uint64_t id;
+
+    if( ( HNTDWidgetStore::parseID( widgetID, id ) == false ) || ( m_widgetStore.deleteWidget( widgetID ) != HNTDWS_RESULT_SUCCESS ) )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_NOT_FOUND );
+        opData->responseSend();
+        return; 
+    }
+
+    std::string canonicalID = HNTDWidgetStore::formatID( id );
+
+    m_responseCache.invalidate( canonicalID );
+
+    // Request was successful
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// Components may be given by table index or name, anything else is
+// taken as an id.  Without either the change is for the root.
+HNTD_RESULT_T
+HNTestDevice::resolveHealthComponent( const HNTD_HEALTH_CHANGE_T &change, std::string &compID )
+{
+    uint32_t index;
+
+    if( change.hasIndex )
+    {
+        if( change.index >= m_healthTable.size() )
+            return HNTD_RESULT_BAD_REQUEST;
+
+        compID = m_healthTable.getID( change.index );
+    }
+    else if( change.hasComponent == false )
+        compID = HNDH_ROOT_COMPID;
+    else if( m_healthTable.findByName( change.component, index ) )
+        compID = m_healthTable.getID( index );
+    else
+        compID = change.component;
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+// Apply one test health change, the caller holds m_healthLock and
+// has started the update cycle.
+HNTD_RESULT_T
+HNTestDevice::applyHealthChange( const std::string &component, const std::string &status, uint errCode )
+{
+    if( status == "OK" )
+    {
+        m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_OK );
+        m_hnodeDev.getHealthRef().clearComponentErrMsg( component );
+        m_hnodeDev.getHealthRef().clearComponentNote( component );
+    }
+    else if( status == "UNKNOWN" )
+    {
+        m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_UNKNOWN );
+        m_hnodeDev.getHealthRef().clearComponentErrMsg( component );
+    }
+    else if( status == "FAILED" )
+    {
+        m_hnodeDev.getHealthRef().setComponentStatus( component, HNDH_CSTAT_FAILED );
+        m_hnodeDev.getHealthRef().setComponentErrMsg( component, errCode, m_errStrCode, errCode );
+    }
+    else if( status == "NOTE" )
+    {
+        m_hnodeDev.getHealthRef().setComponentNote( component, m_noteStrCode );
+    }
+    else
+        return HNTD_RESULT_BAD_REQUEST;
+
+    recordHealthChange( component, status, errCode );
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+// Add an applied change to the transition history.  Only the root and
+// the table's components are kept, others have no index.
+void
+HNTestDevice::recordHealthChange( const std::string &component, const std::string &status, uint errCode )
+{
+    uint32_t index = HNTD_HEALTH_HISTORY_ROOT;
+    HNTD_HH_STATUS_T hhStatus;
+
+    if( ( component != HNDH_ROOT_COMPID ) && ( m_healthTable.findByID( component, index ) == false ) )
+        return;
+
+    if( HNTDHealthHistory::parseStatusName( status, hhStatus ) == false )
+        return;
+
+    m_healthHistory.record( index, hhStatus, ( hhStatus == HNTD_HH_STATUS_FAILED ) ? errCode : 0 );
+}
+
+// PUT "/hnode2/test/health"
+void
+HNTestDevice::handlePutTestHealth( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Put Test Health Request ===" );
+
+    HNTDRequestDecoder decoder( m_maxBodySize );
+    HNTD_HEALTH_CHANGE_T change;
+    std::string compID;
+
+    if( loadRequestBody( opData, decoder ) != HNTD_RESULT_SUCCESS )
+        return;
+
+    if( ( decoder.decodeHealthChange( change ) != HNTDRD_RESULT_SUCCESS )
+        || ( resolveHealthComponent( change, compID ) != HNTD_RESULT_SUCCESS ) )
+    {
+        HNTD_LOG_DEBUG( "putTestHealth: %s", decoder.getError().c_str() );
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    HNTD_RESULT_T result;
+
+    {
+        std::lock_guard< std::mutex > lock( m_healthLock );
+
+        m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
+
+        result = applyHealthChange( compID, change.status, change.errCode );
+        if( result == HNTD_RESULT_SUCCESS )
+            m_changeFeed.publishHealth( compID, change.status, change.errCode );
+
+        m_hnodeDev.getHealthRef().completeUpdateCycle();
+    }
+
+    // A rejected change left the health as it was
+    if( result != HNTD_RESULT_SUCCESS )
+    {
+        HNTD_LOG_DEBUG( "putTestHealth: change rejected, status %s", change.status.c_str() );
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    // Request was successful
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// PUT "/hnode2/test/health/batch"
+void
+HNTestDevice::handlePutTestHealthBatch( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Put Test Health Batch Request ===" );
+
+    HNTDRequestDecoder decoder( m_maxBodySize );
+    std::vector< HNTD_HEALTH_CHANGE_T > changes;
+
+    if( loadRequestBody( opData, decoder ) != HNTD_RESULT_SUCCESS )
+        return;
+
+    if( decoder.decodeHealthBatch( changes ) != HNTDRD_RESULT_SUCCESS )
+    {
+        HNTD_LOG_DEBUG( "putTestHealthBatch: %s", decoder.getError().c_str() );
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    pjs::Array jsResults;
+    uint applied = 0;
+    uint failed  = 0;
+    bool changed = false;
+
+    {
+        // All entries land in a single update cycle
+        std::lock_guard< std::mutex > lock( m_healthLock );
+
+        m_hnodeDev.getHealthRef().startUpdateCycle( time(NULL) );
+
+        for( uint i = 0; i < changes.size(); i++ )
+        {
+            HNTD_HEALTH_CHANGE_T &change = changes[i];
+            std::string compID;
+
+            pjs::Object jsResult;
+            jsResult.set( "entry", i );
+
+            if( change.valid == false )
+            {
+                jsResult.set( "result", "error" );
+                jsResult.set( "error", change.error );
+                failed += 1;
+            }
+            else if( resolveHealthComponent( change, compID ) != HNTD_RESULT_SUCCESS )
+            {
+                jsResult.set( "result", "error" );
+                jsResult.set( "error", "component index out of range" );
+                failed += 1;
+            }
+            else if( applyHealthChange( compID, change.status, change.errCode ) != HNTD_RESULT_SUCCESS )
+            {
+                jsResult.set( "component", compID );
+                jsResult.set( "result", "error" );
+                jsResult.set( "error", "unknown status: " + change.status );
+                failed += 1;
+            }
+            else
+            {
+                jsResult.set( "component", compID );
+                jsResult.set( "result", "ok" );
+                m_changeFeed.publishHealth( compID, change.status, change.errCode );
+                applied += 1;
+            }
+
+            jsResults.add( jsResult );
+        }
+
+        changed = m_hnodeDev.getHealthRef().completeUpdateCycle();
+    }
+
+    HNTD_LOG_DEBUG( "putTestHealthBatch: %u applied, %u failed", applied, failed );
+
+    pjs::Object jsRoot;
+    jsRoot.set( "applied", applied );
+    jsRoot.set( "failed", failed );
+    jsRoot.set( "changed", changed );
+    jsRoot.set( "results", jsResults );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// Transitions are reported by component id, as the device health
+// reports them to the management node.
+void
+HNTestDevice::buildHealthTransition( const HNTD_HEALTH_TRANSITION_T &transition, pjs::Object &jsTransition )
+{
+    jsTransition.set( "seq", transition.seq );
+    jsTransition.set( "time", transition.timeUS );
+
+    if( transition.component == HNTD_HEALTH_HISTORY_ROOT )
+        jsTransition.set( "component", std::string( HNDH_ROOT_COMPID ) );
+    else
+        jsTransition.set( "component", m_healthTable.getID( transition.component ) );
+
+    jsTransition.set( "status", HNTDHealthHistory::getStatusName( transition.status ) );
+
+    if( transition.status == HNTD_HH_STATUS_FAILED )
+        jsTransition.set( "errCode", transition.errCode );
+}
+
+// Per component transition and failure counts, and the status at the
+// end of each bucket, over whole buckets from start.  Without a start
+// the last HNTD_HEALTH_HISTORY_DEFAULT_BUCKETS buckets before end.
+void
+HNTestDevice::sendHealthBuckets( HNOperationData *opData, const HNTD_GET_HEALTH_HISTORY_PARAMS_T &params, uint32_t component )
+{
+    uint64_t bucketUS = params.bucket;
+    uint64_t endUS    = ( params.hasEnd == true ) ? params.end : HNTDHealthHistory::getNowUS();
+    uint64_t startUS  = 0;
+
+    if( params.hasStart == true )
+        startUS = params.start;
+    else if( ( bucketUS > 0 ) && ( bucketUS <= ( endUS / HNTD_HEALTH_HISTORY_DEFAULT_BUCKETS ) ) )
+        startUS = endUS - ( bucketUS * HNTD_HEALTH_HISTORY_DEFAULT_BUCKETS );
+
+    if( ( bucketUS == 0 ) || ( startUS >= endUS ) )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    uint64_t span = endUS - startUS;
+    uint64_t bucketCount = ( span / bucketUS ) + ( ( ( span % bucketUS ) != 0 ) ? 1 : 0 );
+
+    if( bucketCount > HNTD_HEALTH_HISTORY_MAX_BUCKETS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    // Too many components for the buckets asked is refused rather than
+    // counted, a smaller range, fewer buckets or one component fits
+    std::vector< HNTD_HEALTH_BUCKETS_T > components;
+    if( m_healthHistory.downsample( startUS, bucketUS, bucketCount, params.hasComponent, component, HNTD_HEALTH_HISTORY_MAX_CELLS, components ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    pjs::Object jsRoot;
+    pjs::Array  jsComponents;
+
+    for( std::vector< HNTD_HEALTH_BUCKETS_T >::iterator it = components.begin(); it != components.end(); it++ )
+    {
+        pjs::Object jsComponent;
+        pjs::Array  jsTransitions;
+        pjs::Array  jsFailures;
+        pjs::Array  jsStatus;
+
+        for( uint i = 0; i < bucketCount; i++ )
+        {
+            jsTransitions.add( it->transitions[i] );
+            jsFailures.add( it->failures[i] );
+            jsStatus.add( std::string( HNTDHealthHistory::getStatusName( it->status[i] ) ) );
+        }
+
+        if( it->component == HNTD_HEALTH_HISTORY_ROOT )
+            jsComponent.set( "component", std::string( HNDH_ROOT_COMPID ) );
+        else
+            jsComponent.set( "component", m_healthTable.getID( it->component ) );
+
+        jsComponent.set( "transitions", jsTransitions );
+        jsComponent.set( "failures", jsFailures );
+        jsComponent.set( "status", jsStatus );
+
+        jsComponents.add( jsComponent );
+    }
+
+    jsRoot.set( "start", startUS );
+    jsRoot.set( "bucket", bucketUS );
+    jsRoot.set( "buckets", bucketCount );
+    jsRoot.set( "components", jsComponents );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// GET "/hnode2/test/health/history"
+void
+HNTestDevice::handleGetHealthHistory( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Get Health History Request ===" );
+
+    HNTD_GET_HEALTH_HISTORY_PARAMS_T params;
+    uint32_t component = HNTD_HEALTH_HISTORY_ROOT;
+    uint64_t limit     = HNTD_HEALTH_HISTORY_DEFAULT_LIMIT;
+
+    if( hntdExtractGetHealthHistoryParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    // The component filter takes a name or id, like putTestHealth
+    if( ( params.hasComponent == true ) && ( params.component != HNDH_ROOT_COMPID )
+        && ( m_healthTable.findByName( params.component, component ) == false )
+        && ( m_healthTable.findByID( params.component, component ) == false ) )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    if( params.hasBucket == true )
+    {
+        sendHealthBuckets( opData, params, component );
+        return;
+    }
+
+    if( params.hasLimit == true )
+    {
+        if( ( params.limit < 1 ) || ( params.limit > HNTD_HEALTH_HISTORY_MAX_LIMIT ) )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+            opData->responseSend();
+            return;
+        }
+
+        limit = params.limit;
+    }
+
+    std::vector< HNTD_HEALTH_TRANSITION_T > transitions;
+    bool more;
+
+    m_healthHistory.getRange( ( params.hasStart == true ) ? params.start : 0,
+                              ( params.hasEnd == true ) ? params.end : UINT64_MAX,
+                              ( params.hasSince == true ) ? params.since : 0,
+                              params.hasComponent, component, limit, transitions, more );
+
+    uint64_t firstSeq;
+    uint64_t lastSeq;
+    m_healthHistory.getSeqRange( firstSeq, lastSeq );
+
+    pjs::Object jsRoot;
+    pjs::Array  jsTransitions;
+
+    for( std::vector< HNTD_HEALTH_TRANSITION_T >::iterator it = transitions.begin(); it != transitions.end(); it++ )
+    {
+        pjs::Object jsTransition;
+        buildHealthTransition( *it, jsTransition );
+        jsTransitions.add( jsTransition );
+    }
+
+    // A since older than firstSeq asked for transitions that are gone
+    jsRoot.set( "firstSeq", firstSeq );
+    jsRoot.set( "lastSeq", lastSeq );
+    jsRoot.set( "transitions", jsTransitions );
+
+    if( more == true )
+        jsRoot.set( "next", transitions.back().seq + 1 );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// GET "/hnode2/test/metrics"
+void
+HNTestDevice::handleGetMetrics( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Get Metrics Request ===" );
+
+    std::vector< HNTDOpSnapshot > snapshot( HNTD_OPERATION_COUNT );
+    m_metrics->getSnapshot( snapshot );
+
+    // Create a json root object
+    pjs::Object jsRoot;
+    pjs::Object jsOps;
+
+    for( uint i = 0; i < HNTD_OPERATION_COUNT; i++ )
+    {
+        const HNTDOpSnapshot &snap = snapshot[i];
+
+        pjs::Object jsOp;
+        jsOp.set( "requests", snap.requests );
+        jsOp.set( "errors", snap.errors );
+        jsOp.set( "bytesIn", snap.bytesIn );
+        jsOp.set( "bytesOut", snap.bytesOut );
+
+        pjs::Object jsLatency;
+        jsLatency.set( "minUs", snap.latencyNS.getMin() / 1000.0 );
+        jsLatency.set( "meanUs", snap.latencyNS.getMean() / 1000.0 );
+        jsLatency.set( "p50Us", snap.latencyNS.getPercentile( 50 ) / 1000.0 );
+        jsLatency.set( "p90Us", snap.latencyNS.getPercentile( 90 ) / 1000.0 );
+        jsLatency.set( "p99Us", snap.latencyNS.getPercentile( 99 ) / 1000.0 );
+        jsLatency.set( "p999Us", snap.latencyNS.getPercentile( 99.9 ) / 1000.0 );
+        jsLatency.set( "maxUs", snap.latencyNS.getMax() / 1000.0 );
+
+        // Non-empty buckets as [ upper bound in ns, count ] pairs
+        pjs::Array jsBuckets;
+        for( uint b = 0; b < HNTDHistogram::BUCKET_COUNT; b++ )
+        {
+            uint64_t count = snap.latencyNS.getBucketCount( b );
+
+            if( count == 0 )
+                continue;
+
+            pjs::Array jsBucket;
+            jsBucket.add( HNTDHistogram::bucketUpperBound( b ) );
+            jsBucket.add( count );
+            jsBuckets.add( jsBucket );
+        }
+        jsLatency.set( "histogramNS", jsBuckets );
+
+        jsOp.set( "latency", jsLatency );
+        jsOps.set( g_HNTDOperations[i].opID, jsOp );
+    }
+
+    jsRoot.set( "operations", jsOps );
+
+    pjs::Object jsChurn;
+    jsChurn.set( "targetRate", ( m_churnPacer != NULL ) ? m_churnPacer->getTargetRate() / m_fleetSize : 0.0 );
+    jsChurn.set( "achievedRate", ( m_churnPacer != NULL ) ? m_churnPacer->getAchievedRate() / m_fleetSize : 0.0 );
+    jsChurn.set( "transitions", m_churnTransitions.load( std::memory_order_relaxed ) );
+    jsRoot.set( "healthChurn", jsChurn );
+
+    pjs::Object jsFaults;
+    jsFaults.set( "delayed", m_faults->getDelayCount() );
+    jsFaults.set( "errors", m_faults->getErrorCount() );
+    jsFaults.set( "drops", m_faults->getDropCount() );
+    jsFaults.set( "delayedNow", m_delayedNow.load() );
+    jsFaults.set( "delayRejected", m_delayRejects.load() );
+    jsRoot.set( "faults", jsFaults );
+
+    if( m_widgetsPersisted == true )
+    {
+        pjs::Object jsJournal;
+        jsJournal.set( "generation", m_widgetJournal.getGeneration() );
+        jsJournal.set( "logBytes", m_widgetJournal.getLogBytes() );
+        jsJournal.set( "compactions", m_widgetJournal.getCompactCount() );
+        jsRoot.set( "widgetJournal", jsJournal );
+    }
+
+    pjs::Object jsFeed;
+    jsFeed.set( "seq", m_changeFeed.getLastSeq() );
+    jsFeed.set( "resyncs", m_changeFeed.getResyncCount() );
+    jsFeed.set( "clients", m_changeFeed.getClientCount() );
+    jsFeed.set( "rejected", m_changeFeed.getRejectCount() );
+    jsRoot.set( "changeFeed", jsFeed );
+
+    if( m_payloadArena != NULL )
+    {
+        pjs::Object jsPayload;
+        jsPayload.set( "defaultSize", m_payloadSize );
+        jsPayload.set( "defaultShape", HNTDPayloadArena::getShapeName( m_payloadShape ) );
+        jsPayload.set( "arenaBytes", m_payloadArena->getCommittedBytes() );
+        jsRoot.set( "payloads", jsPayload );
+    }
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+HNTD_RESULT_T
+HNTestDevice::applyFaultRules( HNTDRequestDecoder &decoder, std::string &error )
+{
+    std::vector< HNTD_FAULT_RULE_T > rules;
+
+    if( decoder.decodeFaultRules( rules ) != HNTDRD_RESULT_SUCCESS )
+    {
+        error = decoder.getError();
+        return HNTD_RESULT_BAD_REQUEST;
+    }
+
+    if( m_faults->setRules( rules, hntdFindOperation, error ) != HNTDFI_RESULT_SUCCESS )
+        return HNTD_RESULT_BAD_REQUEST;
+
+    return HNTD_RESULT_SUCCESS;
+}
+
+void
+HNTestDevice::buildFaultRules( pjs::Object &jsRoot )
+{
+    std::vector< HNTD_FAULT_RULE_T > rules;
+    m_faults->getRules( rules );
+
+    pjs::Object jsOps;
+
+    for( std::vector< HNTD_FAULT_RULE_T >::iterator it = rules.begin(); it != rules.end(); it++ )
+    {
+        pjs::Object jsRule;
+
+        if( it->latencyDist != HNTD_LATENCY_NONE )
+        {
+            pjs::Object jsLatency;
+            jsLatency.set( "distribution", HNTDFaultInjector::getDistName( it->latencyDist ) );
+
+            switch( it->latencyDist )
+            {
+                case HNTD_LATENCY_FIXED:
+                    jsLatency.set( "ms", it->latencyMeanMS );
+                break;
+
+                case HNTD_LATENCY_UNIFORM:
+                    jsLatency.set( "minMs", it->latencyMinMS );
+                    jsLatency.set( "maxMs", it->latencyMaxMS );
+                break;
+
+                case HNTD_LATENCY_NORMAL:
+                    jsLatency.set( "meanMs", it->latencyMeanMS );
+                    jsLatency.set( "stddevMs", it->latencyStddevMS );
+                break;
+
+                default:
+                    jsLatency.set( "meanMs", it->latencyMeanMS );
+                break;
+            }
+
+            jsRule.set( "latency", jsLatency );
+        }
+
+        jsRule.set( "errorRate", it->errorRate );
+        jsRule.set( "errorStatus", it->errorStatus );
+        jsRule.set( "dropRate", it->dropRate );
+
+        jsOps.set( it->opID, jsRule );
+    }
+
+    jsRoot.set( "operations", jsOps );
+}
+
+// GET "/hnode2/test/faults"
+void
+HNTestDevice::handleGetFaults( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Get Faults Request ===" );
+
+    pjs::Object jsRoot;
+    buildFaultRules( jsRoot );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
+
+// PUT "/hnode2/test/faults"
+void
+HNTestDevice::handlePutFaults( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Put Faults Request ===" );
+
+    HNTDRequestDecoder decoder( m_maxBodySize );
+    std::string error;
+
+    if( loadRequestBody( opData, decoder ) != HNTD_RESULT_SUCCESS )
+        return;
+
+    // The rules replace every rule set before
+    if( applyFaultRules( decoder, error ) != HNTD_RESULT_SUCCESS )
+    {
+        HNTD_LOG_DEBUG( "putFaults: %s", error.c_str() );
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    HNTD_LOG_INFO( "%s: Fault rules updated", m_instanceName.c_str() );
+
+    // Keep the rules across restarts
+    if( m_configPersister != NULL )
+        m_configPersister->requestSave( this );
+
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+    opData->responseSend();
+}
+
+void
+HNTestDevice::buildChangeEvent( const HNTD_CHANGE_EVENT_T &event, pjs::Object &jsEvent )
+{
+    jsEvent.set( "seq", event.seq );
+    jsEvent.set( "type", HNTDChangeFeed::getTypeName( event.type ) );
+
+    if( event.type == HNTD_CHANGE_HEALTH )
+    {
+        // No component means a whole update cycle, reread the health
+        if( event.id.empty() == false )
+        {
+            jsEvent.set( "component", event.id );
+            jsEvent.set( "status", event.status );
+
+            if( event.errCode != 0 )
+                jsEvent.set( "errCode", event.errCode );
+        }
+        return;
+    }
+
+    jsEvent.set( "id", event.id );
+
+    if( event.type != HNTD_CHANGE_WIDGET_DELETED )
+    {
+        jsEvent.set( "color", event.color );
+        jsEvent.set( "name", event.name );
+    }
+}
+
+// Server-sent events from since on, until the client goes away or the
+// device stops.  A comment line every HNTD_CHANGES_KEEPALIVE_MS finds
+// clients that left without closing.
+void
+HNTestDevice::streamChanges( HNOperationData *opData, uint64_t since )
+{
+    opData->responseSetChunkedTransferEncoding( true );
+    opData->responseSetContentType( "text/event-stream" );
+    opData->getResponse().set( "Cache-Control", "no-cache" );
+    opData->responseSetStatusAndReason( HNR_HTTP_OK );
+
+    std::vector< HNTD_CHANGE_EVENT_T > events;
+    uint64_t lastSeq;
+
+    try
+    {
+        std::ostream& ostr = opData->responseSend();
+        ostr.flush();
+
+        while( ostr.good() )
+        {
+            HNTDCF_RESULT_T result = m_changeFeed.read( since, HNTD_CHANGES_MAX_EVENTS, HNTD_CHANGES_KEEPALIVE_MS, events, lastSeq );
+
+            if( result == HNTDCF_RESULT_STOPPED )
+                break;
+
+            if( result == HNTDCF_RESULT_TIMEOUT )
+                ostr << ": keepalive\n\n";
+            else if( result == HNTDCF_RESULT_RESYNC )
+            {
+                since = lastSeq;
+                ostr << "id: " << since << "\nevent: resync\ndata: {\"seq\":" << since << "}\n\n";
+            }
+            else
+            {
+                for( std::vector< HNTD_CHANGE_EVENT_T >::iterator it = events.begin(); it != events.end(); it++ )
+                {
+                    pjs::Object jsEvent;
+                    buildChangeEvent( *it, jsEvent );
+
+                    ostr << "id: " << it->seq << "\nevent: change\ndata: ";
+                    pjs::Stringifier::stringify( jsEvent, ostr );
+                    ostr << "\n\n";
+                }
+
+                since = events.back().seq;
+            }
+
+            ostr.flush();
+        }
+    }
+    catch( Poco::Exception ex )
+    {
+        HNTD_LOG_DEBUG( "streamChanges: %s", ex.displayText().c_str() );
     }
 }
-)";
 
+// GET "/hnode2/test/changes"
+void
+HNTestDevice::handleGetChanges( HNOperationData *opData )
+{
+    HNTD_LOG_DEBUG( "=== Get Changes Request ===" );
+
+    // Without a cursor only changes from now on are returned
+    uint64_t since     = m_changeFeed.getLastSeq();
+    uint64_t waitMS    = HNTD_CHANGES_DEFAULT_WAIT_MS;
+    uint64_t maxEvents = HNTD_CHANGES_MAX_EVENTS;
+
+    Poco::Net::HTTPServerRequest &request = opData->getRequest();
+
+    bool stream = request.has( "Accept" ) && ( request.get( "Accept" ).find( "text/event-stream" ) != std::string::npos );
+
+    HNTD_GET_CHANGES_PARAMS_T params;
+    Poco::UInt64 lastEventID;
+
+    if( hntdExtractGetChangesParams( opData, params ) == false )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+        opData->responseSend();
+        return;
+    }
+
+    // An event stream reconnect resumes after the last event it saw
+    if( stream && request.has( "Last-Event-ID" ) )
+    {
+        if( Poco::NumberParser::tryParseUnsigned64( request.get( "Last-Event-ID" ), lastEventID ) == false )
+        {
+            opData->responseSetStatusAndReason( HNR_HTTP_BAD_REQUEST );
+            opData->responseSend();
+            return;
+        }
+
+        since = lastEventID;
+    }
+
+    if( params.hasSince == true )
+        since = params.since;
+
+    if( params.hasWait == true )
+        waitMS = params.wait;
+
+    if( params.hasMax == true )
+        maxEvents = params.max;
+
+    // Every waiting client ties up a REST worker, so past the limit
+    // they are turned away before the workers run out
+    HNTDChangeFeedClient client( m_changeFeed );
+    if( client.isAdmitted() == false )
+    {
+        opData->getResponse().set( "Retry-After", "1" );
+        opData->getResponse().setStatusAndReason( Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE );
+        opData->responseSend();
+        return;
+    }
+
+    if( stream == true )
+    {
+        streamChanges( opData, since );
+        return;
+    }
+
+    if( waitMS > HNTD_CHANGES_MAX_WAIT_MS )
+        waitMS = HNTD_CHANGES_MAX_WAIT_MS;
+
+    if( ( maxEvents == 0 ) || ( maxEvents > HNTD_CHANGES_MAX_EVENTS ) )
+        maxEvents = HNTD_CHANGES_MAX_EVENTS;
+
+    std::vector< HNTD_CHANGE_EVENT_T > events;
+    uint64_t lastSeq;
+
+    HNTDCF_RESULT_T result = m_changeFeed.read( since, maxEvents, waitMS, events, lastSeq );
+
+    if( result == HNTDCF_RESULT_STOPPED )
+    {
+        opData->getResponse().setStatusAndReason( Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE );
+        opData->responseSend();
+        return;
+    }
+
+    pjs::Object jsRoot;
+    pjs::Array  jsEvents;
+
+    for( std::vector< HNTD_CHANGE_EVENT_T >::iterator it = events.begin(); it != events.end(); it++ )
+    {
+        pjs::Object jsEvent;
+        buildChangeEvent( *it, jsEvent );
+        jsEvents.add( jsEvent );
+    }
+
+    // The cursor for the next request, on a resync after rereading the state
+    jsRoot.set( "seq", events.empty() ? lastSeq : events.back().seq );
+    jsRoot.set( "resync", ( result == HNTDCF_RESULT_RESYNC ) );
+    jsRoot.set( "events", jsEvents );
+
+    HNTD_RESPONSE_BODY_T body;
+    if( renderResponse( jsRoot, body ) != HNTD_RESULT_SUCCESS )
+    {
+        opData->responseSetStatusAndReason( HNR_HTTP_INTERNAL_SERVER_ERROR );
+        opData->responseSend();
+        return;
+    }
+
+    // Render response content
+    sendResponseBody( opData, body, "", 0 );
+
+    // Return to caller
+    opData->responseSend();
+}
@@ -3,15 +3,36 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
+#include <random>
+#include <atomic>
 
-#include "Poco/Util/ServerApplication.h"
-#include "Poco/Util/OptionSet.h"
+#include "Poco/Dynamic/Var.h"
+#include <Poco/JSON/Object.h>
 
 #include <hnode2/HNodeDevice.h>
 #include <hnode2/HNodeConfig.h>
-#include <hnode2/HNEPLoop.h>
 #include <hnode2/HNReqWaitQueue.h>
 
+#include "HNTDWidgetStore.h"
+#include "HNTDResponseCache.h"
+#include "HNTDMetrics.h"
+#include "HNTDConfigPersister.h"
+#include "HNTDChurnPacer.h"
+#include "HNTDHealthTable.h"
+#include "HNTDHealthHistory.h"
+#include "HNTDRequestDecoder.h"
+#include "HNTDWidgetJournal.h"
+#include "HNTDFaultInjector.h"
+#include "HNTDDelayScheduler.h"
+#include "HNTDPayloadArena.h"
+#include "HNTDContentEncoder.h"
+#include "HNTDChangeFeed.h"
+#include "HNTDStartupProfile.h"
+
+// Generated from HNTestRest.json at build time
+#include "HNTDOperations.h"
+
 #define HNODE_TEST_DEVTYPE   "hnode2-test-device"
 
 typedef enum HNTestDeviceResultEnum
@@ -22,42 +43,217 @@ typedef enum HNTestDeviceResultEnum
   HNTD_RESULT_SERVER_ERROR
 }HNTD_RESULT_T;
 
-class HNTestDevice : public Poco::Util::ServerApplication, public HNDEPDispatchInf, public HNDEventNotifyInf, public HNEPLoopCallbacks 
+typedef enum HNTestDeviceChurnModeEnum
 {
-    private:
-        bool _helpRequested   = false;
-        bool _debugLogging    = false;
-        bool _instancePresent = false;
+  HNTD_CHURN_MODE_SEQUENCE,
+  HNTD_CHURN_MODE_RANDOM
+}HNTD_CHURN_MODE_T;
+
+// Per instance settings handed to HNTestDevice::start()
+typedef struct HNTDDeviceSettingsStruct
+{
+    std::string instance;
+    uint        restPort;
+    uint        healthTreeFanout;
+    uint        healthTreeDepth;
+    uint        churnSeed;
+    uint        maxBodySize;
+
+    // Smallest response body that is compressed for a client that accepts it
+    uint        compressMinSize;
+
+    // Events kept for change feed readers
+    uint        changeFeedSize;
+
+    // Change feed long-polls and streams allowed at once
+    uint        changeFeedClients;
+
+    // Requests held for injected latency at once, more get 503
+    uint        maxDelayed;
+
+    // Health transitions kept for history queries, 0 for none
+    uint64_t    healthHistorySize;
+
+    // Widget snapshot and log location, empty to keep widgets in memory only
+    std::string dataDir;
+    uint64_t    widgetCompactSize;
+
+    // Synthetic getWidgetInfo payload when the request does not ask, 0 for none
+    uint64_t             payloadSize;
+    HNTD_PAYLOAD_SHAPE_T payloadShape;
 
-        std::string _instance; 
+    // Shared by every device in the process
+    uint                 fleetSize;
+    HNTDConfigPersister *configPersister;
+    HNTDChurnPacer      *churnPacer;
+    HNTDJournalFlusher  *journalFlusher;
+    HNTDDelayScheduler  *delayScheduler;
+    HNTDPayloadArena    *payloadArena;
+
+    // Startup phase timings, NULL unless profiling
+    HNTDStartupProfile  *startupProfile;
+
+    // No config file and no REST server, requests are only fed to
+    // dispatchEP() by the caller (hntest-microbench)
+    bool                 standalone;
+}HNTD_DEVICE_SETTINGS_T;
+
+// One simulated hnode2 test device.  Several can be hosted by one
+// HNTestDaemon, each with its own instance name, REST port and config.
+class HNTestDevice : public HNDEPDispatchInf, public HNDEventNotifyInf, public HNTDConfigPersistInf, public HNTDWidgetStoreListener
+{
+    private:
         std::string m_instanceName;
 
         HNodeDevice m_hnodeDev;
 
-        HNEPTrigger m_configUpdateTrigger;
+        // Config changes are written behind by the daemon's persister
+        HNTDConfigPersister *m_configPersister;
 
-        HNEPLoop m_testDeviceEvLoop;
+        // Fault rules last read or saved, so putting the same rules
+        // again writes nothing.  Used on the persister thread once the
+        // device is started.  Device section changes from libhnode2 set
+        // m_deviceConfigChanged and are always saved.
+        std::string         m_savedRules;
+        bool                m_savedRulesValid;
+        std::atomic< bool > m_deviceConfigChanged;
 
         // Format string codes
         uint m_errStrCode;
         uint m_noteStrCode;
 
-        // Health component ids
-        std::string m_hc1ID;
-        std::string m_hc2ID;
-        std::string m_hc3ID;
+        // Health components, by index
+        HNTDHealthTable m_healthTable;
 
         // Keep track of health state change simulation
         uint m_healthStateSeq;
+        uint32_t m_seqComp[3];
+
+        // Serializes health update cycles from REST and the churn timer
+        std::mutex m_healthLock;
+
+        // Every health transition the device made, for history queries
+        HNTDHealthHistory m_healthHistory;
+
+        // Scheduled health churn, paced by the daemon for the whole fleet
+        HNTDChurnPacer *m_churnPacer;
+        uint m_fleetSize;
+        std::mt19937 m_churnRandom;
+        std::atomic< uint64_t > m_churnTransitions;
+
+        // Widgets served by the widget endpoints
+        HNTDWidgetStore m_widgetStore;
+
+        // Keeps the widgets across restarts, written behind by the daemon's flusher
+        HNTDWidgetJournal m_widgetJournal;
+        bool              m_widgetsPersisted;
+
+        // Widget and health mutations for change feed readers
+        HNTDChangeFeed m_changeFeed;
 
-        void displayHelp();
+        // Serialized bodies for the read endpoints
+        HNTDResponseCache m_responseCache;
+        uint64_t          m_statusVersion;
+
+        // Prefix of every ETag, unique to this run so that versions
+        // counted by an earlier run never match
+        std::string       m_etagEpoch;
+
+        // Largest request body that will be accepted
+        uint m_maxBodySize;
+
+        // Smallest response body worth compressing
+        uint m_compressMinSize;
+
+        // Per operation request metrics, indexed by HNTD_OPERATION_ID_T
+        HNTDMetrics *m_metrics;
+
+        // Injected faults, indexed by HNTD_OPERATION_ID_T.  Delayed requests
+        // wait on the daemon's shared scheduler, at most m_maxDelayed at once.
+        HNTDFaultInjector  *m_faults;
+        HNTDDelayScheduler *m_delayScheduler;
+        uint                    m_maxDelayed;
+        std::atomic< uint >     m_delayedNow;
+        std::atomic< uint64_t > m_delayRejects;
+
+        // Synthetic payloads are written from the daemon's shared arena
+        HNTDPayloadArena     *m_payloadArena;
+        uint64_t              m_payloadSize;
+        HNTD_PAYLOAD_SHAPE_T  m_payloadShape;
 
         bool configExists();
-        HNTD_RESULT_T initConfig();
+        HNTD_RESULT_T initConfig( HNodeConfig &cfg );
         HNTD_RESULT_T readConfig();
+        HNTD_RESULT_T applyConfig( HNodeConfig &cfg );
         HNTD_RESULT_T updateConfig();
 
+        HNTD_RESULT_T buildHealthComponents( uint fanout, uint depth );
+        void initHealthState();
         void generateNewHealthState();
+        HNTD_RESULT_T resolveHealthComponent( const HNTD_HEALTH_CHANGE_T &change, std::string &compID );
+        HNTD_RESULT_T applyHealthChange( const std::string &component, const std::string &status, uint errCode );
+        void recordHealthChange( const std::string &component, const std::string &status, uint errCode );
+        void generateRandomHealthChange();
+
+        void restoreWidgets( const HNTD_DEVICE_SETTINGS_T &settings );
+
+        HNTD_RESULT_T loadRequestBody( HNOperationData *opData, HNTDRequestDecoder &decoder );
+        HNTD_RESULT_T parseWidgetFields( HNOperationData *opData, HNTD_WIDGET_FIELDS_T &fields );
+
+        HNTD_RESULT_T applyFaultRules( HNTDRequestDecoder &decoder, std::string &error );
+        void buildFaultRules( Poco::JSON::Object &jsRoot );
+        bool injectFaults( uint opIndex, HNOperationData *opData, uint64_t startNS );
+        void dropConnection( HNOperationData *opData );
+
+        HNTD_RESULT_T renderResponse( const Poco::Dynamic::Var &jsRoot, HNTD_RESPONSE_BODY_T &body );
+        HNTD_RESPONSE_BODY_T encodeBody( const HNTD_RESPONSE_BODY_T &body, HNTD_ENCODING_T encoding, const std::string &cacheKey, uint64_t version );
+        void sendResponseBody( HNOperationData *opData, const HNTD_RESPONSE_BODY_T &body, const std::string &cacheKey, uint64_t version );
+
+        std::string makeETag( uint64_t version, const std::string &variant );
+        bool sendNotModified( HNOperationData *opData, const std::string &etag );
+
+        HNTD_RESULT_T getPayloadRequest( const HNTD_GET_WIDGET_INFO_PARAMS_T &params, uint64_t &size, HNTD_PAYLOAD_SHAPE_T &shape );
+        HNTD_RESULT_T getWidgetQuery( const HNTD_GET_WIDGET_LIST_PARAMS_T &params, HNTD_WIDGET_QUERY_T &query );
+        void queryWidgetList( HNOperationData *opData, const HNTD_GET_WIDGET_LIST_PARAMS_T &params );
+        void buildChangeEvent( const HNTD_CHANGE_EVENT_T &event, Poco::JSON::Object &jsEvent );
+        void streamChanges( HNOperationData *opData, uint64_t since );
+        void sendHealthBuckets( HNOperationData *opData, const HNTD_GET_HEALTH_HISTORY_PARAMS_T &params, uint32_t component );
+        void buildHealthTransition( const HNTD_HEALTH_TRANSITION_T &transition, Poco::JSON::Object &jsTransition );
+
+        void sendSyntheticPayload( HNOperationData *opData, const std::string &widgetID, const HNTD_WIDGET_T &widget, uint64_t size, HNTD_PAYLOAD_SHAPE_T shape );
+
+        void registerOperations();
+        void recordMetrics( uint opIndex, HNOperationData *opData, uint64_t startNS );
+
+    public:
+        // REST operation handlers
+        void handleGetStatus( HNOperationData *opData );
+        void handleGetWidgetList( HNOperationData *opData );
+        void handleGetWidgetInfo( HNOperationData *opData );
+        void handleCreateWidget( HNOperationData *opData );
+        void handleUpdateWidget( HNOperationData *opData );
+        void handleDeleteWidget( HNOperationData *opData );
+        void handleBulkCreateWidgets( HNOperationData *opData );
+        void handlePutTestHealth( HNOperationData *opData );
+        void handlePutTestHealthBatch( HNOperationData *opData );
+        void handleGetMetrics( HNOperationData *opData );
+        void handleGetFaults( HNOperationData *opData );
+        void handlePutFaults( HNOperationData *opData );
+        void handleGetChanges( HNOperationData *opData );
+        void handleGetHealthHistory( HNOperationData *opData );
+
+        HNTestDevice();
+        virtual ~HNTestDevice();
+
+        HNTD_RESULT_T start( const HNTD_DEVICE_SETTINGS_T &settings );
+
+        // Release requests that are waiting on the device, before exit
+        void stop();
+
+        const std::string& getInstanceName();
+
+        // One scheduled health transition, called from the event loop
+        void churnStep( HNTD_CHURN_MODE_T mode );
 
     protected:
         // HNDevice REST callback
@@ -66,18 +262,13 @@ class HNTestDevice : public Poco::Util::ServerApplication, public HNDEPDispatchI
         // Notification for hnode device config changes.
         virtual void hndnConfigChange( HNodeDevice *parent );
 
-        // Event loop functions
-        virtual void loopIteration();
-        virtual void timeoutEvent();
-        virtual void fdEvent( int sfd );
-        virtual void fdError( int sfd );
-
-        // Poco funcions
-        void defineOptions( Poco::Util::OptionSet& options );
-        void handleOption( const std::string& name, const std::string& value );
-        int main( const std::vector<std::string>& args );
-
+        // Called on the persister thread to write the config
+        virtual bool persistConfig();
 
+        // Widget changes go to the change feed from here, under the
+        // widget's shard lock, so the feed orders them as they were applied
+        virtual void widgetStored( const HNTD_WIDGET_T &widget, bool created );
+        virtual void widgetDeleted( uint64_t id );
 };
 
 #endif // __HN_TEST_DEVICE_PRIVATE_H__
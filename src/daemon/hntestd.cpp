@@ -1,9 +1,8 @@
-#include "HNTestDevicePrivate.h"
+#include "HNTestDaemonPrivate.h"
 
 int 
 main( int argc, char* argv[] )
 {
-    HNTestDevice swd;    
-    return swd.run( argc, argv );
+    HNTestDaemon daemon;    
+    return daemon.run( argc, argv );
 }
-